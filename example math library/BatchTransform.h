@@ -0,0 +1,195 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <algorithm>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+#include "Matrix4x4.h"
+#include "Simd.h"
+#include "Vector3.h"
+
+//Batch transforms, one matrix applied to a whole array of points or directions.
+//
+//This is what skinning, particle emitters and culling spend their time on. The arrays stay plain
+//packed Vector3's, what those systems already have, so there is nothing to convert first:
+//
+//	TransformPoints(world, local_positions, world_positions, count);
+//	TransformPointsInPlace(world, positions, count, 4);          //on 4 threads
+//	TransformPointsStreaming(world, positions, gpu_buffer, count);
+//
+//Inside, lane_count points at a time (8 with AVX, 4 with SSE) are shuffled apart into a
+//register of x's, one of y's and one of z's, transformed exactly like in Vector3SoA, and
+//shuffled back. Points that don't fill a whole register go through Matrix4x4::TransformPoint.
+//
+//The array is cut into one chunk per thread. Starting threads costs tens of microseconds, so
+//small arrays stay on the calling thread no matter what thread_count says: each thread gets at
+//least min_points_per_thread points. thread_count 0 means one per CPU core. The calling thread
+//does the first chunk itself and returns when all of them are done. On Linux link with -pthread.
+//
+//The Streaming versions write the output with non-temporal stores, which go straight to memory
+//instead of the cache. Use them when the output is big and won't be read again soon by this
+//CPU, like a buffer the GPU reads from: it saves reading the output into the cache first just
+//to overwrite it, and keeps the cache for data that is still needed. For output that is read
+//right after, the normal versions are faster.
+//
+//Directions are only rotated and scaled, not moved. Normals need the inverse transpose of the
+//matrix unless the scale is the same on every axis.
+
+namespace math {
+
+namespace batch_detail {
+
+static constexpr size_t min_points_per_thread = 64 * 1024;
+
+//chunks start on a multiple of this many points, 64 Vector3's are 12 cache lines, so two
+//threads never write the same cache line
+static constexpr size_t chunk_granularity = 64;
+
+//how the work is cut up, body(begin, end) is called once per chunk
+template<typename Func>
+void ForEachChunk(size_t count, unsigned thread_count, Func&& body)
+{
+	if(thread_count == 0){
+		thread_count = std::max(1u, std::thread::hardware_concurrency());
+	}
+	size_t most_useful = std::max<size_t>(1, count / min_points_per_thread);
+	size_t threads = std::min<size_t>(thread_count, most_useful);
+	if(threads == 1){
+		body(size_t(0), count);
+		return;
+	}
+
+	size_t chunk = (count + threads - 1) / threads;
+	chunk = (chunk + chunk_granularity - 1) / chunk_granularity * chunk_granularity;
+	std::vector<std::thread> workers;
+	workers.reserve(threads - 1);
+	for(size_t begin = chunk; begin < count; begin += chunk){
+		size_t end = std::min(count, begin + chunk);
+		try{
+			workers.emplace_back([&body, begin, end]{ body(begin, end); });
+		}
+		catch(std::system_error const&){
+			//out of threads, this chunk is done here instead
+			body(begin, end);
+		}
+	}
+	body(size_t(0), std::min(count, chunk));
+	for(std::thread& worker : workers){
+		worker.join();
+	}
+}
+
+//the matrix, one element per register
+struct MatrixLanes {
+	simd::Lanes m[3][4]; //[row][column], the bottom row isn't needed
+
+	explicit MatrixLanes(Matrix4x4 const& matrix) noexcept
+	{
+		for(int row = 0; row < 3; row++){
+			for(int column = 0; column < 4; column++){
+				m[row][column] = simd::SplatLanes(matrix(row, column));
+			}
+		}
+	}
+};
+
+//transforms in[0, count) to out, the work of one chunk. points adds the translation,
+//streaming uses non-temporal stores
+template<bool points, bool streaming>
+void TransformRange(Matrix4x4 const& matrix, const Vector3* in, Vector3* out, size_t count) noexcept
+{
+	auto TransformOne = [&](size_t i){
+		out[i] = points ? matrix.TransformPoint(in[i]) : matrix.TransformDirection(in[i]);
+	};
+
+	size_t i = 0;
+	if(streaming){
+		//non-temporal stores need aligned addresses, do single points until out gets there
+		const size_t alignment = simd::lane_count * sizeof(float);
+		for(; i < count && reinterpret_cast<uintptr_t>(out + i) % alignment != 0; i++){
+			TransformOne(i);
+		}
+	}
+
+	MatrixLanes m(matrix);
+	for(; i + simd::lane_count <= count; i += simd::lane_count){
+		simd::Lanes x, y, z;
+		simd::LoadLanes3Unaligned(in[i].data_ptr(), x, y, z);
+		//same order of operations as Matrix4x4::TransformPoint, with or without SIMD, so the
+		//single points at the ends of the array don't round any differently
+		simd::Lanes rx = points ? simd::MultiplyAdd(x, m.m[0][0], m.m[0][3]) : x * m.m[0][0];
+		simd::Lanes ry = points ? simd::MultiplyAdd(x, m.m[1][0], m.m[1][3]) : x * m.m[1][0];
+		simd::Lanes rz = points ? simd::MultiplyAdd(x, m.m[2][0], m.m[2][3]) : x * m.m[2][0];
+		rx = simd::MultiplyAdd(z, m.m[0][2], simd::MultiplyAdd(y, m.m[0][1], rx));
+		ry = simd::MultiplyAdd(z, m.m[1][2], simd::MultiplyAdd(y, m.m[1][1], ry));
+		rz = simd::MultiplyAdd(z, m.m[2][2], simd::MultiplyAdd(y, m.m[2][1], rz));
+		if(streaming){
+			simd::StreamLanes3(out[i].data_ptr(), rx, ry, rz);
+		}
+		else{
+			simd::StoreLanes3Unaligned(out[i].data_ptr(), rx, ry, rz);
+		}
+	}
+
+	for(; i < count; i++){
+		TransformOne(i);
+	}
+	if(streaming){
+		//before join() tells the caller this chunk is done
+		simd::StreamFence();
+	}
+}
+
+template<bool points, bool streaming>
+void Transform(Matrix4x4 const& matrix, const Vector3* in, Vector3* out, size_t count, unsigned thread_count)
+{
+	ForEachChunk(count, thread_count, [&](size_t begin, size_t end){
+		TransformRange<points, streaming>(matrix, in + begin, out + begin, end - begin);
+	});
+}
+
+} // namespace batch_detail
+
+/* POINTS */
+
+//out[i] = matrix.TransformPoint(in[i]). in and out may be the same array, but not overlap
+//any other way
+inline void TransformPoints(Matrix4x4 const& matrix, const Vector3* in, Vector3* out, size_t count, unsigned thread_count = 1)
+{
+	batch_detail::Transform<true, false>(matrix, in, out, count, thread_count);
+}
+
+inline void TransformPointsInPlace(Matrix4x4 const& matrix, Vector3* points, size_t count, unsigned thread_count = 1)
+{
+	batch_detail::Transform<true, false>(matrix, points, points, count, thread_count);
+}
+
+//TransformPoints with non-temporal stores, for big outputs that aren't read again soon
+inline void TransformPointsStreaming(Matrix4x4 const& matrix, const Vector3* in, Vector3* out, size_t count, unsigned thread_count = 1)
+{
+	batch_detail::Transform<true, true>(matrix, in, out, count, thread_count);
+}
+
+/* DIRECTIONS */
+
+//out[i] = matrix.TransformDirection(in[i]), same rules as TransformPoints
+inline void TransformDirections(Matrix4x4 const& matrix, const Vector3* in, Vector3* out, size_t count, unsigned thread_count = 1)
+{
+	batch_detail::Transform<false, false>(matrix, in, out, count, thread_count);
+}
+
+inline void TransformDirectionsInPlace(Matrix4x4 const& matrix, Vector3* directions, size_t count, unsigned thread_count = 1)
+{
+	batch_detail::Transform<false, false>(matrix, directions, directions, count, thread_count);
+}
+
+inline void TransformDirectionsStreaming(Matrix4x4 const& matrix, const Vector3* in, Vector3* out, size_t count, unsigned thread_count = 1)
+{
+	batch_detail::Transform<false, true>(matrix, in, out, count, thread_count);
+}
+
+}
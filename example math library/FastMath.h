@@ -0,0 +1,302 @@
+#pragma once
+
+#include <float.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <cmath>
+
+#include "Simd.h"
+#include "Vector3.h"
+
+//Fast math, for hot loops where a result that is a little off is fine.
+//
+//PRECISION
+//
+//Normalizing needs 1 / sqrt(length squared), a square root and a divide, which are the slowest
+//float instructions there are. The CPU also has an estimate of 1 / sqrt that is many times
+//faster, and one Newton-Raphson step gets it almost all the way to full precision. Precision
+//picks between them:
+//
+//	Exact     1 / std::sqrt(x)                        correctly rounded sqrt, then a divide
+//	Refined   the estimate plus one Newton step       within 3e-7 relative error
+//	Estimate  the raw hardware estimate               within 3.7e-4 (1.5 * 2^-12) relative error
+//
+//Without SSE there is no hardware estimate, Estimate is the integer trick plus one Newton step
+//(1.8e-3) and Refined adds a second one (5e-6), which is no faster than Exact there.
+//
+//The estimate treats denormals as 0 and returns inf for them, which the Newton step turns into
+//NaN. So Refined and Estimate clamp x to FLT_MIN first: a vector shorter than about 1e-19 no
+//longer comes out as NaN, but its result is shorter than unit length, where Exact still
+//normalizes it correctly.
+//
+//	Normalize<Precision::Refined>(v);                        //a Vector3
+//	Vector3 n = Normal<Precision::Estimate>(v);
+//	Vector3A n = a.Normal<Precision::Estimate>();            //Vector3A and Vector4 have members
+//	Normalize<Precision::Refined>(directions, directions);   //a whole Vector3SoA
+//
+//Exact is the default everywhere, so nothing changes unless it is asked for. Vector3 doesn't
+//include this file, so code using it alone doesn't pull in the SIMD headers.
+//
+//TRIGONOMETRY AND EXP
+//
+//FastSin, FastCos, FastAtan2 and FastExp are polynomials, found by fitting them to the real
+//function (minimax, the largest error as small as it gets) over a short range, plus a cheap
+//step that maps any input into that range. Unlike std::sin and friends they have no branches
+//and no special cases, so the same code works on whole registers, and loops over arrays of
+//them vectorize. The largest errors, measured against double precision over the whole range:
+//
+//	FastSin, FastCos   |x| <= 100000                     within 1.2e-6 absolute error
+//	FastAtan2          anything but inf and NaN          within 6e-7 radians
+//	FastExp            -87.3 <= x <= 88                  within 3e-7 relative error
+//
+//Bigger angles lose precision in the range reduction, and past about 10^7 the result means
+//nothing. FastExp clamps x to its range, so it never returns inf or a denormal. FastAtan2(0, 0)
+//is 0, and -0 counts as 0 for x but keeps its sign for y, like std::atan2. All of this counts
+//on float math being done in the order it is written, so not with -ffast-math, which lets the
+//compiler reorder it. Each function has a float version for Vector3 style code and a
+//simd::Lanes version for batch kernels:
+//
+//	float s = FastSin(angle);
+//	simd::Lanes s = FastSin(simd::LoadLanes(angles + i));
+//
+//benchmark.cpp ("fastmath") checks all of these bounds and times them against the std
+//functions.
+
+namespace math {
+
+enum class Precision { Exact, Refined, Estimate };
+
+namespace fast_detail {
+
+//the float versions of the simd::Lanes functions, so the code below is written once for both
+
+template<typename T>
+inline T Broadcast(float value) noexcept;
+template<>
+inline float Broadcast<float>(float value) noexcept { return value; }
+template<>
+inline simd::Lanes Broadcast<simd::Lanes>(float value) noexcept { return simd::SplatLanes(value); }
+
+inline float MultiplyAdd(float a, float b, float c) noexcept { return a * b + c; }
+inline float Sqrt(float a) noexcept { return std::sqrt(a); }
+inline float Abs(float a) noexcept { return std::fabs(a); }
+inline float Min(float a, float b) noexcept { return a < b ? a : b; }
+inline float Max(float a, float b) noexcept { return a > b ? a : b; }
+inline bool Less(float a, float b) noexcept { return a < b; }
+inline float Select(bool mask, float if_true, float if_false) noexcept { return mask ? if_true : if_false; }
+inline float CopySign(float magnitude, float sign) noexcept { return std::copysign(magnitude, sign); }
+inline float PowerOfTwo(float n) noexcept
+{
+	uint32_t bits = static_cast<uint32_t>(n + 127.0f) << 23;
+	float result;
+	memcpy(&result, &bits, sizeof(result));
+	return result;
+}
+
+inline float InverseSqrtEstimate(float a) noexcept
+{
+#if MATH_SIMD_SSE
+	return _mm_cvtss_f32(_mm_rsqrt_ss(_mm_set_ss(a)));
+#else
+	return simd::InverseSqrtEstimate(simd::Lanes{a}).v;
+#endif
+}
+
+template<Precision precision, typename T>
+inline T InverseSqrt(T x) noexcept
+{
+	if constexpr(precision == Precision::Exact){
+		return Broadcast<T>(1.0f) / Sqrt(x);
+	}
+	else{
+		x = Max(x, Broadcast<T>(FLT_MIN)); //no denormals, see PRECISION above
+		T y = InverseSqrtEstimate(x);
+		if constexpr(precision == Precision::Refined){
+			//Newton-Raphson for 1 / y^2 - x = 0: y * (1.5 - 0.5 * x * y * y), doubles the correct bits
+			T half_x = x * Broadcast<T>(0.5f);
+			y = y * MultiplyAdd(Broadcast<T>(0.0f) - half_x * y, y, Broadcast<T>(1.5f));
+		}
+		return y;
+	}
+}
+
+//pi in three parts, the first two short enough that k * part is exact for k up to 2^15, so
+//x - k * pi doesn't lose the digits that matter (Cody and Waite)
+static constexpr float pi_a = 3.140625f;
+static constexpr float pi_b = 9.67502593994140625e-4f;
+static constexpr float pi_c = 1.509957990978376432e-7f;
+
+//sin(r) for |r| <= pi / 2, an odd polynomial so it is exactly 0 at 0
+template<typename T>
+inline T SinPolynomial(T r) noexcept
+{
+	T r2 = r * r;
+	T p = MultiplyAdd(Broadcast<T>(2.590488535e-6f), r2, Broadcast<T>(-1.980089778e-4f));
+	p = MultiplyAdd(p, r2, Broadcast<T>(8.332899824e-3f));
+	p = MultiplyAdd(p, r2, Broadcast<T>(-1.666664763e-1f));
+	p = MultiplyAdd(p, r2, Broadcast<T>(9.999999766e-1f));
+	return p * r;
+}
+
+//x - half_turns * pi
+template<typename T>
+inline T ReduceByPi(T x, T half_turns) noexcept
+{
+	T r = MultiplyAdd(half_turns, Broadcast<T>(-pi_a), x);
+	r = MultiplyAdd(half_turns, Broadcast<T>(-pi_b), r);
+	return MultiplyAdd(half_turns, Broadcast<T>(-pi_c), r);
+}
+
+//the whole number nearest to a, while |a| < 2^22. Adding 1.5 * 2^23 leaves no bits for the
+//fraction, so the add rounds, and subtracting it again gives the rounded number back. Unlike
+//floor it has no branches and no conversion to int, so it is cheap in registers and loops over
+//it vectorize
+template<typename T>
+inline T Round(T a) noexcept
+{
+	T magic = Broadcast<T>(12582912.0f);
+	return (a + magic) - magic;
+}
+
+//1 when k is even, -1 when it is odd
+template<typename T>
+inline T EvenOddSign(T k) noexcept
+{
+	T odd = Abs(k - Round(k * Broadcast<T>(0.5f)) * Broadcast<T>(2.0f)); //0 or 1
+	return MultiplyAdd(odd, Broadcast<T>(-2.0f), Broadcast<T>(1.0f));
+}
+
+template<typename T>
+inline T Sin(T x) noexcept
+{
+	//x = k * pi + r with |r| <= pi / 2, and sin(x) = sin(r) with the sign flipped for odd k
+	T k = Round(x * Broadcast<T>(0.318309886f));
+	return SinPolynomial(ReduceByPi(x, k)) * EvenOddSign(k);
+}
+
+template<typename T>
+inline T Cos(T x) noexcept
+{
+	//x = (k + 0.5) * pi + r, and cos(x) = sin(r) with the sign flipped for even k
+	T k = Round(MultiplyAdd(x, Broadcast<T>(0.318309886f), Broadcast<T>(-0.5f)));
+	T r = ReduceByPi(x, k + Broadcast<T>(0.5f));
+	return Broadcast<T>(0.0f) - SinPolynomial(r) * EvenOddSign(k);
+}
+
+template<typename T>
+inline T Atan2(T y, T x) noexcept
+{
+	//atan of the smaller over the bigger, so the polynomial only has to cover 0 to 1, then
+	//turned into the right octant
+	T ax = Abs(x);
+	T ay = Abs(y);
+	T big = Max(ax, ay);
+	T zero = Broadcast<T>(0.0f);
+	T a = Select(Less(zero, big), Min(ax, ay) / big, zero);
+	T a2 = a * a;
+	T p = MultiplyAdd(Broadcast<T>(6.811792828e-3f), a2, Broadcast<T>(-3.360421945e-2f));
+	p = MultiplyAdd(p, a2, Broadcast<T>(7.962367159e-2f));
+	p = MultiplyAdd(p, a2, Broadcast<T>(-1.323334210e-1f));
+	p = MultiplyAdd(p, a2, Broadcast<T>(1.980781559e-1f));
+	p = MultiplyAdd(p, a2, Broadcast<T>(-3.331736806e-1f));
+	p = MultiplyAdd(p, a2, Broadcast<T>(9.999961116e-1f));
+	T angle = p * a;
+	angle = Select(Less(ax, ay), Broadcast<T>(1.570796327f) - angle, angle);
+	angle = Select(Less(x, zero), Broadcast<T>(3.141592654f) - angle, angle);
+	return CopySign(angle, y);
+}
+
+template<typename T>
+inline T Exp(T x) noexcept
+{
+	//e^x = 2^n * e^f, with n the whole number nearest to x / ln 2 and |f| <= ln 2 / 2
+	x = Min(Max(x, Broadcast<T>(-87.3f)), Broadcast<T>(88.0f));
+	T n = Round(x * Broadcast<T>(1.442695041f));
+	//ln 2 in two parts, like pi above
+	T f = MultiplyAdd(n, Broadcast<T>(-0.693359375f), x);
+	f = MultiplyAdd(n, Broadcast<T>(2.12194440e-4f), f);
+	T p = MultiplyAdd(Broadcast<T>(8.297654957e-3f), f, Broadcast<T>(4.191538199e-2f));
+	p = MultiplyAdd(p, f, Broadcast<T>(1.666757473e-1f));
+	p = MultiplyAdd(p, f, Broadcast<T>(4.999889485e-1f));
+	p = MultiplyAdd(p, f, Broadcast<T>(9.999996920e-1f));
+	p = MultiplyAdd(p, f, Broadcast<T>(1.000000072f));
+	return p * PowerOfTwo(n);
+}
+
+} // namespace fast_detail
+
+/* PRECISION */
+
+template<Precision precision = Precision::Exact>
+inline float InverseSqrt(float x) noexcept { return fast_detail::InverseSqrt<precision>(x); }
+template<Precision precision = Precision::Exact>
+inline simd::Lanes InverseSqrt(simd::Lanes x) noexcept { return fast_detail::InverseSqrt<precision>(x); }
+
+//1 / sqrt(squared_length), or 0 where squared_length is 0, for normalizing in batch kernels
+template<Precision precision = Precision::Exact>
+inline simd::Lanes InverseLengthOrZero(simd::Lanes squared_length) noexcept
+{
+	if constexpr(precision == Precision::Exact){
+		return simd::InverseLengthOrZero(squared_length);
+	}
+	else{
+		simd::Lanes zero = simd::SplatLanes(0.0f);
+		return simd::Select(simd::Less(zero, squared_length), InverseSqrt<precision>(squared_length), zero);
+	}
+}
+
+//Vector3's Normalize() and Normal() with a Precision, a zero vector is left as it is
+template<Precision precision = Precision::Exact>
+inline Vector3 Normal(Vector3 const& v) noexcept
+{
+	if constexpr(precision == Precision::Exact){
+		return v.Normal();
+	}
+	else{
+		float squared = v.MagnitudeSquared();
+		return squared > 0 ? v * InverseSqrt<precision>(squared) : v;
+	}
+}
+template<Precision precision = Precision::Exact>
+inline void Normalize(Vector3& v) noexcept { v = Normal<precision>(v); }
+
+#if MATH_SIMD_SSE
+namespace simd {
+
+//the same for a single __m128, as used by Vector3A and Vector4: value / sqrt(squared_length),
+//or 0 where squared_length is 0
+template<Precision precision>
+inline __m128 DivideByLength(__m128 value, __m128 squared_length) noexcept
+{
+	if constexpr(precision == Precision::Exact){
+		return DivideByLength(value, squared_length);
+	}
+	else{
+		__m128 clamped = _mm_max_ps(squared_length, _mm_set1_ps(FLT_MIN)); //no denormals
+		__m128 y = _mm_rsqrt_ps(clamped);
+		if constexpr(precision == Precision::Refined){
+			__m128 half_x = _mm_mul_ps(clamped, _mm_set1_ps(0.5f));
+			y = _mm_mul_ps(y, MultiplyAdd(_mm_sub_ps(_mm_setzero_ps(), _mm_mul_ps(half_x, y)), y, _mm_set1_ps(1.5f)));
+		}
+		__m128 non_zero = _mm_cmpgt_ps(squared_length, _mm_setzero_ps());
+		return _mm_and_ps(_mm_mul_ps(value, y), non_zero);
+	}
+}
+
+} // namespace simd
+#endif
+
+/* TRIGONOMETRY AND EXP */
+
+inline float FastSin(float x) noexcept { return fast_detail::Sin(x); }
+inline float FastCos(float x) noexcept { return fast_detail::Cos(x); }
+inline float FastAtan2(float y, float x) noexcept { return fast_detail::Atan2(y, x); }
+inline float FastExp(float x) noexcept { return fast_detail::Exp(x); }
+
+inline simd::Lanes FastSin(simd::Lanes x) noexcept { return fast_detail::Sin(x); }
+inline simd::Lanes FastCos(simd::Lanes x) noexcept { return fast_detail::Cos(x); }
+inline simd::Lanes FastAtan2(simd::Lanes y, simd::Lanes x) noexcept { return fast_detail::Atan2(y, x); }
+inline simd::Lanes FastExp(simd::Lanes x) noexcept { return fast_detail::Exp(x); }
+
+}
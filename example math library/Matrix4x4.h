@@ -0,0 +1,355 @@
+#pragma once
+
+#include <cmath>
+#include <iostream>
+#include <string>
+
+#include "Quaternion.h"
+#include "Simd.h"
+#include "Vector3.h"
+#include "Vector3A.h"
+#include "Vector4.h"
+
+//Matrix4x4, a 4x4 float matrix for transforms, stored column-major like OpenGL and Vulkan expect.
+//
+//Column-major means the 16 floats are the first column, then the second, and so on. For a
+//transform the first three columns are where the x, y and z axes end up (rotation and scale),
+//and the fourth is the translation:
+//
+//	| Xx Yx Zx Tx |     columns[0] = X axis
+//	| Xy Yy Zy Ty |     columns[1] = Y axis
+//	| Xz Yz Zz Tz |     columns[2] = Z axis
+//	| 0  0  0  1  |     columns[3] = translation
+//
+//Points are column vectors multiplied on the right, so A * B * v applies B first, then A:
+//
+//	Matrix4x4 world = Matrix4x4::TRS(position, rotation, scale);
+//	Matrix4x4 world_to_local = world.InverseAffine();
+//	Vector3 p = world.TransformPoint(local_point);
+//	glUniformMatrix4fv(location, 1, GL_FALSE, world.data_ptr());
+//
+//Each column is a Vector4, so a matrix times a vector is four multiply-adds of whole columns,
+//and a matrix times a matrix is that four times. See Simd.h for which instructions get used.
+
+namespace math {
+
+class alignas(16) Matrix4x4
+{
+	public:
+
+	//the identity, so a default matrix is a transform that does nothing
+	Vector4 columns[4] = {
+		Vector4(1, 0, 0, 0),
+		Vector4(0, 1, 0, 0),
+		Vector4(0, 0, 1, 0),
+		Vector4(0, 0, 0, 1),
+	};
+
+	/* CONSTRUCTION */
+
+	constexpr Matrix4x4() noexcept = default;
+	constexpr explicit Matrix4x4(Vector4 const& c0, Vector4 const& c1, Vector4 const& c2, Vector4 const& c3) noexcept
+		: columns{c0, c1, c2, c3} {}
+
+	static constexpr Matrix4x4 Identity() noexcept { return Matrix4x4(); }
+
+	static constexpr Matrix4x4 Translation(Vector3 const& t) noexcept
+	{
+		Matrix4x4 m;
+		m.columns[3] = Vector4(t, 1.0f);
+		return m;
+	}
+
+	static constexpr Matrix4x4 Scale(Vector3 const& s) noexcept
+	{
+		return Matrix4x4(Vector4(s.x, 0, 0, 0), Vector4(0, s.y, 0, 0), Vector4(0, 0, s.z, 0), Vector4(0, 0, 0, 1));
+	}
+
+	//q has to be unit length
+	static constexpr Matrix4x4 Rotation(Quaternion const& q) noexcept
+	{
+		float xx = q.x * q.x, yy = q.y * q.y, zz = q.z * q.z;
+		float xy = q.x * q.y, xz = q.x * q.z, yz = q.y * q.z;
+		float wx = q.w * q.x, wy = q.w * q.y, wz = q.w * q.z;
+		return Matrix4x4(
+			Vector4(1 - 2 * (yy + zz), 2 * (xy + wz), 2 * (xz - wy), 0),
+			Vector4(2 * (xy - wz), 1 - 2 * (xx + zz), 2 * (yz + wx), 0),
+			Vector4(2 * (xz + wy), 2 * (yz - wx), 1 - 2 * (xx + yy), 0),
+			Vector4(0, 0, 0, 1));
+	}
+
+	//Translation(t) * Rotation(r) * Scale(s) without the two matrix multiplies: scale first,
+	//then rotate, then move. The columns of Rotation(r) times the scale
+	static constexpr Matrix4x4 TRS(Vector3 const& t, Quaternion const& r, Vector3 const& s) noexcept
+	{
+		float xx = r.x * r.x, yy = r.y * r.y, zz = r.z * r.z;
+		float xy = r.x * r.y, xz = r.x * r.z, yz = r.y * r.z;
+		float wx = r.w * r.x, wy = r.w * r.y, wz = r.w * r.z;
+		return Matrix4x4(
+			Vector4((1 - 2 * (yy + zz)) * s.x, 2 * (xy + wz) * s.x, 2 * (xz - wy) * s.x, 0),
+			Vector4(2 * (xy - wz) * s.y, (1 - 2 * (xx + zz)) * s.y, 2 * (yz + wx) * s.y, 0),
+			Vector4(2 * (xz + wy) * s.z, 2 * (yz - wx) * s.z, (1 - 2 * (xx + yy)) * s.z, 0),
+			Vector4(t, 1.0f));
+	}
+
+	//the other way around, splits an affine transform back into TRS. Returns false if an axis
+	//is scaled to zero, there is no rotation to find then. A mirrored matrix comes out with a
+	//negative x scale. Shear can't be represented and is lost.
+	bool Decompose(Vector3& t, Quaternion& r, Vector3& s) const noexcept
+	{
+		Vector3A x_axis = columns[0].ToVector3A();
+		Vector3A y_axis = columns[1].ToVector3A();
+		Vector3A z_axis = columns[2].ToVector3A();
+		t = columns[3].ToVector3();
+		s = Vector3(x_axis.Magnitude(), y_axis.Magnitude(), z_axis.Magnitude());
+		if(s.x == 0 || s.y == 0 || s.z == 0){
+			return false;
+		}
+		if(x_axis.Cross(y_axis).Dot(z_axis) < 0){
+			s.x = -s.x;
+		}
+		r = Quaternion::FromBasis((x_axis / s.x).ToVector3(), (y_axis / s.y).ToVector3(), (z_axis / s.z).ToVector3()).Normal();
+		return true;
+	}
+
+	/* ACCESS */
+
+	//m(row, column), columns[column] underneath
+	float& operator()(int row, int column) noexcept { return columns[column].data_ptr()[row]; }
+	float operator()(int row, int column) const noexcept { return columns[column].data_ptr()[row]; }
+
+	/* OPERATOR OVERLOADING */
+
+	Vector4 operator*(Vector4 const& v) const noexcept
+	{
+#if MATH_SIMD_SSE
+		return Vector4FromM128(Transform(_mm_load_ps(v.data_ptr())));
+#else
+		return columns[0] * v.x + columns[1] * v.y + columns[2] * v.z + columns[3] * v.w;
+#endif
+	}
+
+	//right is applied first
+	Matrix4x4 operator*(Matrix4x4 const& right) const noexcept
+	{
+		//each column of the result is this matrix times that column of right
+#if MATH_SIMD_SSE
+		return FromM128(Transform(right.Load(0)), Transform(right.Load(1)), Transform(right.Load(2)), Transform(right.Load(3)));
+#else
+		Matrix4x4 result;
+		for(int c = 0; c < 4; c++){
+			result.columns[c] = *this * right.columns[c];
+		}
+		return result;
+#endif
+	}
+	Matrix4x4& operator*=(Matrix4x4 const& right) noexcept { return *this = *this * right; }
+
+	bool operator==(Matrix4x4 const& right) const noexcept
+	{
+		return columns[0] == right.columns[0] && columns[1] == right.columns[1] &&
+		       columns[2] == right.columns[2] && columns[3] == right.columns[3];
+	}
+	bool operator!=(Matrix4x4 const& right) const noexcept { return !(*this == right); }
+
+	/* TRANSFORMING */
+
+	//w = 1, moved by the translation. Assumes an affine matrix (bottom row 0 0 0 1), a
+	//projection would need a divide by w after
+	Vector3A TransformPoint(Vector3A const& p) const noexcept
+	{
+#if MATH_SIMD_SSE
+		return Vector3AFromM128(TransformXYZ(_mm_load_ps(p.data_ptr()), Load(3)));
+#else
+		//the translation goes in first, the same order as TransformXYZ and the batch transforms
+		return (columns[0] * p.x + columns[3] + columns[1] * p.y + columns[2] * p.z).ToVector3A();
+#endif
+	}
+
+	//w = 0, only rotated and scaled
+	Vector3A TransformDirection(Vector3A const& d) const noexcept
+	{
+#if MATH_SIMD_SSE
+		return Vector3AFromM128(TransformXYZ(_mm_load_ps(d.data_ptr()), _mm_setzero_ps()));
+#else
+		return (columns[0] * d.x + columns[1] * d.y + columns[2] * d.z).ToVector3A();
+#endif
+	}
+
+	Vector3 TransformPoint(Vector3 const& p) const noexcept
+	{
+#if MATH_SIMD_SSE
+		Vector3 result;
+		simd::Store3(result.data_ptr(), TransformXYZ(simd::Load3(p.data_ptr()), Load(3)));
+		return result;
+#else
+		return TransformPoint(Vector3A(p)).ToVector3();
+#endif
+	}
+	Vector3 TransformDirection(Vector3 const& d) const noexcept
+	{
+#if MATH_SIMD_SSE
+		Vector3 result;
+		simd::Store3(result.data_ptr(), TransformXYZ(simd::Load3(d.data_ptr()), _mm_setzero_ps()));
+		return result;
+#else
+		return TransformDirection(Vector3A(d)).ToVector3();
+#endif
+	}
+
+	/* INVERSES */
+
+	Matrix4x4 Transposed() const noexcept
+	{
+#if MATH_SIMD_SSE
+		__m128 c0 = Load(0), c1 = Load(1), c2 = Load(2), c3 = Load(3);
+		_MM_TRANSPOSE4_PS(c0, c1, c2, c3);
+		return FromM128(c0, c1, c2, c3);
+#else
+		Matrix4x4 result;
+		for(int r = 0; r < 4; r++){
+			for(int c = 0; c < 4; c++){
+				result(r, c) = (*this)(c, r);
+			}
+		}
+		return result;
+#endif
+	}
+
+	//the inverse of an affine matrix (bottom row 0 0 0 1), any rotation, scale and shear.
+	//Much cheaper than a general 4x4 inverse. The matrix has to be invertible, no zero scale.
+	Matrix4x4 InverseAffine() const noexcept
+	{
+		//the rows of the inverse of the 3x3 part are the cross products of its columns
+		//divided by the determinant
+#if MATH_SIMD_SSE
+		__m128 c0 = Load(0), c1 = Load(1), c2 = Load(2);
+		__m128 row0 = simd::Cross3(c1, c2);
+		__m128 row1 = simd::Cross3(c2, c0);
+		__m128 row2 = simd::Cross3(c0, c1);
+		__m128 inverse_determinant = _mm_div_ps(_mm_set1_ps(1.0f), simd::Dot3(c0, row0));
+		return FromInverseRows(_mm_mul_ps(row0, inverse_determinant), _mm_mul_ps(row1, inverse_determinant),
+		                       _mm_mul_ps(row2, inverse_determinant), Load(3));
+#else
+		Vector3A c0 = columns[0].ToVector3A();
+		Vector3A c1 = columns[1].ToVector3A();
+		Vector3A c2 = columns[2].ToVector3A();
+		Vector3A row0 = c1.Cross(c2);
+		Vector3A row1 = c2.Cross(c0);
+		Vector3A row2 = c0.Cross(c1);
+		float inverse_determinant = 1.0f / c0.Dot(row0);
+		row0 *= inverse_determinant;
+		row1 *= inverse_determinant;
+		row2 *= inverse_determinant;
+
+		//translation undoes the old one, rotated and scaled by the inverse
+		Vector3A t = columns[3].ToVector3A();
+		return Matrix4x4(Vector4(row0, -row0.Dot(t)), Vector4(row1, -row1.Dot(t)),
+		                 Vector4(row2, -row2.Dot(t)), Vector4(0, 0, 0, 1)).Transposed();
+#endif
+	}
+
+	//the inverse of a rotation plus translation, no scale. The cheapest inverse there is: the
+	//rotation part is just transposed
+	Matrix4x4 InverseRigid() const noexcept
+	{
+#if MATH_SIMD_SSE
+		//the rows of the inverse are the columns
+		return FromInverseRows(Load(0), Load(1), Load(2), Load(3));
+#else
+		Matrix4x4 result = Matrix4x4(columns[0], columns[1], columns[2], Vector4(0, 0, 0, 1)).Transposed();
+		Vector3A t = result.TransformDirection(columns[3].ToVector3A());
+		result.columns[3] = Vector4(-t, 1.0f);
+		return result;
+#endif
+	}
+
+	/* UTILITY FUNCTIONS */
+
+	//all 16 floats, column by column. What OpenGL calls column-major, pass GL_FALSE for transpose
+	constexpr float* data_ptr() noexcept { return columns[0].data_ptr(); }
+	constexpr const float* data_ptr() const noexcept { return columns[0].data_ptr(); }
+
+	//printed row by row, the way it is written on paper
+	friend std::ostream& operator<<(std::ostream &strm, const Matrix4x4 &m) {
+		for(int r = 0; r < 4; r++){
+			strm << "[" << m(r, 0) << ", " << m(r, 1) << ", " << m(r, 2) << ", " << m(r, 3) << "]";
+			if(r < 3) strm << "\n";
+		}
+		return strm;
+	}
+
+	std::string to_string() const {
+		std::string out;
+		for(int r = 0; r < 4; r++){
+			out += std::string("[") + std::to_string((*this)(r, 0)) + "," + std::to_string((*this)(r, 1)) + "," +
+			       std::to_string((*this)(r, 2)) + "," + std::to_string((*this)(r, 3)) + "]";
+		}
+		return out;
+	}
+
+	private:
+
+#if MATH_SIMD_SSE
+	__m128 Load(int column) const noexcept { return _mm_load_ps(columns[column].data_ptr()); }
+
+	//the columns times the lanes of v, added up
+	__m128 Transform(__m128 v) const noexcept
+	{
+		__m128 result = _mm_mul_ps(Load(0), simd::Splat<0>(v));
+		result = simd::MultiplyAdd(Load(1), simd::Splat<1>(v), result);
+		result = simd::MultiplyAdd(Load(2), simd::Splat<2>(v), result);
+		return simd::MultiplyAdd(Load(3), simd::Splat<3>(v), result);
+	}
+
+	//the first three columns times x, y and z of v, added to start. w of v is ignored
+	__m128 TransformXYZ(__m128 v, __m128 start) const noexcept
+	{
+		__m128 result = simd::MultiplyAdd(Load(0), simd::Splat<0>(v), start);
+		result = simd::MultiplyAdd(Load(1), simd::Splat<1>(v), result);
+		return simd::MultiplyAdd(Load(2), simd::Splat<2>(v), result);
+	}
+
+	static Vector4 Vector4FromM128(__m128 v) noexcept
+	{
+		Vector4 result;
+		_mm_store_ps(result.data_ptr(), v);
+		return result;
+	}
+	static Vector3A Vector3AFromM128(__m128 v) noexcept
+	{
+		Vector3A result;
+		_mm_store_ps(result.data_ptr(), v);
+		return result;
+	}
+	//the affine matrix with these rows for its 3x3 part, and a translation that undoes t after
+	//it. w of the rows has to be 0
+	static Matrix4x4 FromInverseRows(__m128 row0, __m128 row1, __m128 row2, __m128 t) noexcept
+	{
+		__m128 c3 = _mm_set_ps(1, 0, 0, 0);
+		_MM_TRANSPOSE4_PS(row0, row1, row2, c3);
+		//the new translation is -(inverse 3x3 * t)
+		__m128 moved = _mm_mul_ps(row0, simd::Splat<0>(t));
+		moved = simd::MultiplyAdd(row1, simd::Splat<1>(t), moved);
+		moved = simd::MultiplyAdd(row2, simd::Splat<2>(t), moved);
+		return FromM128(row0, row1, row2, _mm_sub_ps(c3, moved));
+	}
+	static Matrix4x4 FromM128(__m128 c0, __m128 c1, __m128 c2, __m128 c3) noexcept
+	{
+		Matrix4x4 result;
+		_mm_store_ps(result.columns[0].data_ptr(), c0);
+		_mm_store_ps(result.columns[1].data_ptr(), c1);
+		_mm_store_ps(result.columns[2].data_ptr(), c2);
+		_mm_store_ps(result.columns[3].data_ptr(), c3);
+		return result;
+	}
+#endif
+};
+
+static_assert(sizeof(Matrix4x4) == 64, "Matrix4x4 must be exactly 16 floats");
+
+//free standing functions
+
+inline Matrix4x4 Transpose(Matrix4x4 const& m) noexcept { return m.Transposed(); }
+
+}
@@ -0,0 +1,239 @@
+#pragma once
+
+#include <cmath>
+#include <iostream>
+#include <string>
+
+#include "Simd.h"
+#include "Vector3.h"
+#include "Vector3A.h"
+
+//Quaternion, a rotation stored as four numbers.
+//
+//A rotation of angle radians around a unit axis is (axis * sin(angle / 2), cos(angle / 2)).
+//Compared to a 3x3 rotation matrix it is 4 floats instead of 9, two of them combine with one
+//multiply (16 multiplies instead of 27), they don't drift away from being a rotation as easily,
+//and they blend smoothly with Slerp/Nlerp, which is what animation needs.
+//
+//	Quaternion turn = Quaternion::FromAxisAngle(VECTOR3_UP, 0.5f);
+//	orientation = turn * orientation;          //turn after the current orientation
+//	Vector3 facing = orientation.Rotate(VECTOR3_FORWARD);
+//
+//a * b rotates by b first and then by a, same order as matrices. Only unit length quaternions
+//are rotations, Normalize() every now and then after many multiplies.
+
+namespace math {
+
+class alignas(16) Quaternion
+{
+	public:
+
+	//the identity, no rotation
+	float x = 0;
+	float y = 0;
+	float z = 0;
+	float w = 1;
+
+	/* CONSTRUCTION */
+
+	constexpr Quaternion() noexcept = default;
+	constexpr explicit Quaternion(float x, float y, float z, float w) noexcept : x(x), y(y), z(z), w(w) {}
+
+	static constexpr Quaternion Identity() noexcept { return Quaternion(); }
+
+	//axis has to be unit length
+	static Quaternion FromAxisAngle(Vector3 const& axis, float radians) noexcept
+	{
+		float half = radians * 0.5f;
+		float s = std::sin(half);
+		return Quaternion(axis.x * s, axis.y * s, axis.z * s, std::cos(half));
+	}
+
+	//the rotation that turns the x, y and z axes into these. They have to be unit length and at
+	//right angles to each other, like the columns of a rotation matrix
+	static Quaternion FromBasis(Vector3 const& x_axis, Vector3 const& y_axis, Vector3 const& z_axis) noexcept
+	{
+		//m(row, column), the axes are the columns
+		float m00 = x_axis.x, m10 = x_axis.y, m20 = x_axis.z;
+		float m01 = y_axis.x, m11 = y_axis.y, m21 = y_axis.z;
+		float m02 = z_axis.x, m12 = z_axis.y, m22 = z_axis.z;
+
+		//the largest of w, x, y, z is worked out first, dividing by the others when they are
+		//close to zero would lose precision
+		float trace = m00 + m11 + m22;
+		if(trace > 0){
+			float s = std::sqrt(trace + 1.0f) * 2.0f; //4w
+			return Quaternion((m21 - m12) / s, (m02 - m20) / s, (m10 - m01) / s, 0.25f * s);
+		}
+		if(m00 > m11 && m00 > m22){
+			float s = std::sqrt(1.0f + m00 - m11 - m22) * 2.0f; //4x
+			return Quaternion(0.25f * s, (m01 + m10) / s, (m02 + m20) / s, (m21 - m12) / s);
+		}
+		if(m11 > m22){
+			float s = std::sqrt(1.0f + m11 - m00 - m22) * 2.0f; //4y
+			return Quaternion((m01 + m10) / s, 0.25f * s, (m12 + m21) / s, (m02 - m20) / s);
+		}
+		float s = std::sqrt(1.0f + m22 - m00 - m11) * 2.0f; //4z
+		return Quaternion((m02 + m20) / s, (m12 + m21) / s, 0.25f * s, (m10 - m01) / s);
+	}
+
+	/* OPERATOR OVERLOADING */
+
+	//combines two rotations, right happens first
+	Quaternion operator*(Quaternion const& right) const noexcept
+	{
+#if MATH_SIMD_SSE
+		//the Hamilton product as four multiply-adds of right, shuffled and with some signs flipped:
+		//	w * (rx,  ry,  rz,  rw)
+		//	x * (rw, -rz,  ry, -rx)
+		//	y * (rz,  rw, -rx, -ry)
+		//	z * (-ry, rx,  rw, -rz)
+		__m128 l = Load();
+		__m128 r = right.Load();
+		__m128 wzyx = _mm_xor_ps(_mm_shuffle_ps(r, r, _MM_SHUFFLE(0, 1, 2, 3)), _mm_set_ps(-0.0f, 0.0f, -0.0f, 0.0f));
+		__m128 zwxy = _mm_xor_ps(_mm_shuffle_ps(r, r, _MM_SHUFFLE(1, 0, 3, 2)), _mm_set_ps(-0.0f, -0.0f, 0.0f, 0.0f));
+		__m128 yxwz = _mm_xor_ps(_mm_shuffle_ps(r, r, _MM_SHUFFLE(2, 3, 0, 1)), _mm_set_ps(-0.0f, 0.0f, 0.0f, -0.0f));
+		__m128 result = _mm_mul_ps(simd::Splat<3>(l), r);
+		result = simd::MultiplyAdd(simd::Splat<0>(l), wzyx, result);
+		result = simd::MultiplyAdd(simd::Splat<1>(l), zwxy, result);
+		result = simd::MultiplyAdd(simd::Splat<2>(l), yxwz, result);
+		return Quaternion(result);
+#else
+		return Quaternion(w * right.x + x * right.w + y * right.z - z * right.y,
+		                  w * right.y - x * right.z + y * right.w + z * right.x,
+		                  w * right.z + x * right.y - y * right.x + z * right.w,
+		                  w * right.w - x * right.x - y * right.y - z * right.z);
+#endif
+	}
+	Quaternion& operator*=(Quaternion const& right) noexcept { return *this = *this * right; }
+
+	//q and -q are the same rotation but compare different
+	constexpr bool operator==(Quaternion const& right) const noexcept { return x == right.x && y == right.y && z == right.z && w == right.w; }
+	constexpr bool operator!=(Quaternion const& right) const noexcept { return !(*this == right); }
+
+	/* COMMON OPERATIONS */
+
+	constexpr float Dot(Quaternion const& right) const noexcept { return x * right.x + y * right.y + z * right.z + w * right.w; }
+	float Magnitude() const noexcept { return std::sqrt(Dot(*this)); }
+
+	void Normalize() noexcept { *this = Normal(); }
+	Quaternion Normal() const noexcept
+	{
+#if MATH_SIMD_SSE
+		__m128 q = Load();
+		return Quaternion(simd::DivideByLength(q, simd::Dot4(q, q)));
+#else
+		float length = Magnitude();
+		return length > 0 ? Quaternion(x / length, y / length, z / length, w / length) : *this;
+#endif
+	}
+
+	//the opposite rotation, for unit quaternions the same as Inverse() and cheaper
+	constexpr Quaternion Conjugate() const noexcept { return Quaternion(-x, -y, -z, w); }
+	constexpr Quaternion Inverse() const noexcept
+	{
+		float squared = Dot(*this);
+		return Quaternion(-x / squared, -y / squared, -z / squared, w / squared);
+	}
+
+	//v rotated, assumes unit length
+	Vector3A Rotate(Vector3A const& v) const noexcept
+	{
+#if MATH_SIMD_SSE
+		Vector3A result;
+		_mm_store_ps(result.data_ptr(), Rotate(_mm_load_ps(v.data_ptr())));
+		return result;
+#else
+		//v + 2w(q x v) + 2 q x (q x v), rearranged to two cross products
+		Vector3A axis(x, y, z);
+		Vector3A t = axis.Cross(v) * 2.0f;
+		return v + t * w + axis.Cross(t);
+#endif
+	}
+	Vector3 Rotate(Vector3 const& v) const noexcept
+	{
+#if MATH_SIMD_SSE
+		Vector3 result;
+		simd::Store3(result.data_ptr(), Rotate(simd::Load3(v.data_ptr())));
+		return result;
+#else
+		return Rotate(Vector3A(v)).ToVector3();
+#endif
+	}
+
+	//blends at a constant angular speed along the shortest way around
+	Quaternion Slerp(Quaternion const& to, float t) const noexcept
+	{
+		float cosine = Dot(to);
+		Quaternion end = to;
+		if(cosine < 0){
+			//q and -q are the same rotation, going to -to is the shorter way
+			cosine = -cosine;
+			end = Quaternion(-to.x, -to.y, -to.z, -to.w);
+		}
+		if(cosine > 0.9995f){
+			//almost the same rotation, sin(angle) is close to 0 and a straight line is just as good
+			return Blend(end, 1.0f - t, t).Normal();
+		}
+		float angle = std::acos(cosine);
+		float inverse_sine = 1.0f / std::sin(angle);
+		return Blend(end, std::sin((1.0f - t) * angle) * inverse_sine, std::sin(t * angle) * inverse_sine);
+	}
+
+	//a straight line between the two, normalized. Not constant speed but much cheaper than Slerp
+	//and close enough for small steps, like blending animation frames
+	Quaternion Nlerp(Quaternion const& to, float t) const noexcept
+	{
+		float sign = Dot(to) < 0 ? -1.0f : 1.0f; //the shorter way around
+		return Blend(to, 1.0f - t, t * sign).Normal();
+	}
+
+	/* UTILITY FUNCTIONS */
+
+	constexpr float* data_ptr() noexcept { return &x; }
+	constexpr const float* data_ptr() const noexcept { return &x; }
+
+	friend std::ostream& operator<<(std::ostream &strm, const Quaternion &q) {
+		return strm << "[" << q.x << ", " << q.y << ", " << q.z << ", " << q.w << "]";
+	}
+
+	std::string to_string() const {
+		return std::string("[") + std::to_string(x) + ","+ std::to_string(y) + ","+ std::to_string(z) + ","+ std::to_string(w) + "]";
+	}
+
+	private:
+
+	//this * a + to * b
+	Quaternion Blend(Quaternion const& to, float a, float b) const noexcept
+	{
+#if MATH_SIMD_SSE
+		return Quaternion(simd::MultiplyAdd(Load(), _mm_set1_ps(a), _mm_mul_ps(to.Load(), _mm_set1_ps(b))));
+#else
+		return Quaternion(x * a + to.x * b, y * a + to.y * b, z * a + to.z * b, w * a + to.w * b);
+#endif
+	}
+
+#if MATH_SIMD_SSE
+	explicit Quaternion(__m128 v) noexcept { _mm_store_ps(&x, v); }
+	__m128 Load() const noexcept { return _mm_load_ps(&x); }
+
+	//same as the scalar Rotate. Cross3 only looks at x, y and z, so q itself is the axis
+	__m128 Rotate(__m128 v) const noexcept
+	{
+		__m128 q = Load();
+		__m128 t = simd::Cross3(q, v);
+		t = _mm_add_ps(t, t);
+		return _mm_add_ps(simd::MultiplyAdd(t, simd::Splat<3>(q), v), simd::Cross3(q, t));
+	}
+#endif
+};
+
+static_assert(sizeof(Quaternion) == 16 && alignof(Quaternion) == 16, "Quaternion must fill exactly one SSE register");
+
+//free standing functions
+
+constexpr float Dot(Quaternion const& left, Quaternion const& right) noexcept { return left.Dot(right); }
+inline Quaternion Slerp(Quaternion const& from, Quaternion const& to, float t) noexcept { return from.Slerp(to, t); }
+inline Quaternion Nlerp(Quaternion const& from, Quaternion const& to, float t) noexcept { return from.Nlerp(to, t); }
+
+}
@@ -0,0 +1,472 @@
+#pragma once
+
+//Picks the instruction set for the SIMD backed types (Vector4, Vector3A, Quaternion, Matrix4x4)
+//and holds the helpers they share.
+//
+//SIMD (single instruction, multiple data) instructions work on 4 floats at once. A Vector4 fits
+//in one 128 bit SSE register, so a + b is one instruction instead of four.
+//
+//Every x86-64 CPU has SSE2, so that is the baseline. Newer instructions are only used when the
+//compiler is told it can (-msse4.1, -mavx, -march=native or /arch:AVX on MSVC):
+//	SSE4.1 - a single instruction dot product
+//	AVX    - 8 floats at a time for the batch code in Vector3SoA.h and BatchTransform.h
+//	FMA    - multiply and add in one step, used by Lerp and the batch code
+//Building with AVX turns on SSE4.1 too, and every SSE instruction gets the shorter AVX encoding.
+//The wider 8 float AVX registers don't help a single 4 float vector, only batches.
+//
+//Anything else (ARM, or MATH_NO_SIMD defined before including) gets the plain scalar code, which
+//is also handy to check the SIMD code against.
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <cmath>
+
+#if !defined(MATH_NO_SIMD) && (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#define MATH_SIMD_SSE 1
+#else
+#define MATH_SIMD_SSE 0
+#endif
+
+#if MATH_SIMD_SSE && (defined(__SSE4_1__) || defined(__AVX__))
+#define MATH_SIMD_SSE4 1
+#else
+#define MATH_SIMD_SSE4 0
+#endif
+
+#if MATH_SIMD_SSE && defined(__AVX__)
+#define MATH_SIMD_AVX 1
+#else
+#define MATH_SIMD_AVX 0
+#endif
+
+#if MATH_SIMD_SSE && (defined(__FMA__) || (defined(_MSC_VER) && defined(__AVX2__)))
+#define MATH_SIMD_FMA 1
+#else
+#define MATH_SIMD_FMA 0
+#endif
+
+#if MATH_SIMD_SSE
+#include <emmintrin.h>
+#endif
+#if MATH_SIMD_SSE4
+#include <smmintrin.h>
+#endif
+#if MATH_SIMD_AVX || MATH_SIMD_FMA
+#include <immintrin.h>
+#endif
+
+namespace math {
+namespace simd {
+
+#if MATH_SIMD_SSE
+
+//x*x + y*y + z*z in every lane, w is ignored
+inline __m128 Dot3(__m128 left, __m128 right) noexcept
+{
+#if MATH_SIMD_SSE4
+	return _mm_dp_ps(left, right, 0x7F);
+#else
+	__m128 product = _mm_mul_ps(left, right);
+	__m128 x = _mm_shuffle_ps(product, product, _MM_SHUFFLE(0, 0, 0, 0));
+	__m128 y = _mm_shuffle_ps(product, product, _MM_SHUFFLE(1, 1, 1, 1));
+	__m128 z = _mm_shuffle_ps(product, product, _MM_SHUFFLE(2, 2, 2, 2));
+	return _mm_add_ps(_mm_add_ps(x, y), z);
+#endif
+}
+
+//all four lanes multiplied and added, the sum in every lane
+inline __m128 Dot4(__m128 left, __m128 right) noexcept
+{
+#if MATH_SIMD_SSE4
+	return _mm_dp_ps(left, right, 0xFF);
+#else
+	__m128 product = _mm_mul_ps(left, right);
+	__m128 swapped = _mm_shuffle_ps(product, product, _MM_SHUFFLE(2, 3, 0, 1)); //y x w z
+	__m128 pairs = _mm_add_ps(product, swapped); //x+y x+y z+w z+w
+	swapped = _mm_shuffle_ps(pairs, pairs, _MM_SHUFFLE(1, 0, 3, 2)); //z+w z+w x+y x+y
+	return _mm_add_ps(pairs, swapped);
+#endif
+}
+
+//the cross product of the xyz parts, w comes out 0
+inline __m128 Cross3(__m128 left, __m128 right) noexcept
+{
+	//(l * r.yzx - l.yzx * r).yzx is the textbook formula with one less shuffle
+	__m128 left_yzx = _mm_shuffle_ps(left, left, _MM_SHUFFLE(3, 0, 2, 1));
+	__m128 right_yzx = _mm_shuffle_ps(right, right, _MM_SHUFFLE(3, 0, 2, 1));
+	__m128 c = _mm_sub_ps(_mm_mul_ps(left, right_yzx), _mm_mul_ps(left_yzx, right));
+	return _mm_shuffle_ps(c, c, _MM_SHUFFLE(3, 0, 2, 1));
+}
+
+//value divided by the square root of squared_length, or zero where squared_length is zero,
+//so normalizing a zero vector doesn't turn it into NaN's
+inline __m128 DivideByLength(__m128 value, __m128 squared_length) noexcept
+{
+	__m128 normalized = _mm_div_ps(value, _mm_sqrt_ps(squared_length));
+	__m128 non_zero = _mm_cmpgt_ps(squared_length, _mm_setzero_ps());
+	return _mm_and_ps(normalized, non_zero);
+}
+
+//a * b + c
+inline __m128 MultiplyAdd(__m128 a, __m128 b, __m128 c) noexcept
+{
+#if MATH_SIMD_FMA
+	return _mm_fmadd_ps(a, b, c);
+#else
+	return _mm_add_ps(_mm_mul_ps(a, b), c);
+#endif
+}
+
+//lane of v copied into all four lanes
+template<int lane>
+inline __m128 Splat(__m128 v) noexcept
+{
+	return _mm_shuffle_ps(v, v, _MM_SHUFFLE(lane, lane, lane, lane));
+}
+
+//from + (to - from) * t
+inline __m128 Lerp(__m128 from, __m128 to, __m128 t) noexcept
+{
+	return MultiplyAdd(_mm_sub_ps(to, from), t, from);
+}
+
+//3 packed floats, like a Vector3, into x, y and z with w = 0. Copying them into a Vector3A
+//first and loading that is slower than it looks: the CPU can't hand three small stores to one
+//16 byte load and waits for them to reach the cache
+inline __m128 Load3(const float* p) noexcept
+{
+	//the 64 bit integer load is the one that doesn't assume 8 byte alignment, a Vector3 only has 4
+	__m128 xy = _mm_castsi128_ps(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(p)));
+	return _mm_movelh_ps(xy, _mm_load_ss(p + 2));
+}
+
+//x, y and z back out to 3 packed floats, w is dropped
+inline void Store3(float* p, __m128 v) noexcept
+{
+	_mm_storel_epi64(reinterpret_cast<__m128i*>(p), _mm_castps_si128(v));
+	_mm_store_ss(p + 2, _mm_movehl_ps(v, v));
+}
+
+#endif
+
+/* LANES */
+
+//Lanes is as many floats as the widest register holds: 8 with AVX, 4 with SSE, 1 without either.
+//Batch code written with Lanes and the functions below compiles to whichever one is there, so
+//each kernel is only written once. Loads and stores of whole Lanes want lane_count * 4 byte
+//alignment unless they say Unaligned.
+
+#if MATH_SIMD_AVX
+
+static constexpr size_t lane_count = 8;
+struct Lanes { __m256 v; };
+
+inline Lanes LoadLanes(const float* p) noexcept { return {_mm256_load_ps(p)}; }
+inline Lanes LoadLanesUnaligned(const float* p) noexcept { return {_mm256_loadu_ps(p)}; }
+inline void StoreLanes(float* p, Lanes a) noexcept { _mm256_store_ps(p, a.v); }
+inline void StoreLanesUnaligned(float* p, Lanes a) noexcept { _mm256_storeu_ps(p, a.v); }
+inline Lanes SplatLanes(float value) noexcept { return {_mm256_set1_ps(value)}; }
+
+inline Lanes operator+(Lanes a, Lanes b) noexcept { return {_mm256_add_ps(a.v, b.v)}; }
+inline Lanes operator-(Lanes a, Lanes b) noexcept { return {_mm256_sub_ps(a.v, b.v)}; }
+inline Lanes operator*(Lanes a, Lanes b) noexcept { return {_mm256_mul_ps(a.v, b.v)}; }
+inline Lanes operator/(Lanes a, Lanes b) noexcept { return {_mm256_div_ps(a.v, b.v)}; }
+inline Lanes Sqrt(Lanes a) noexcept { return {_mm256_sqrt_ps(a.v)}; }
+
+//a * b + c
+inline Lanes MultiplyAdd(Lanes a, Lanes b, Lanes c) noexcept
+{
+#if MATH_SIMD_FMA
+	return {_mm256_fmadd_ps(a.v, b.v, c.v)};
+#else
+	return {_mm256_add_ps(_mm256_mul_ps(a.v, b.v), c.v)};
+#endif
+}
+
+//1 / sqrt(squared_length), or 0 where squared_length is 0
+inline Lanes InverseLengthOrZero(Lanes squared_length) noexcept
+{
+	__m256 inverse = _mm256_div_ps(_mm256_set1_ps(1.0f), _mm256_sqrt_ps(squared_length.v));
+	__m256 non_zero = _mm256_cmp_ps(squared_length.v, _mm256_setzero_ps(), _CMP_GT_OQ);
+	return {_mm256_and_ps(inverse, non_zero)};
+}
+
+inline Lanes Abs(Lanes a) noexcept { return {_mm256_andnot_ps(_mm256_set1_ps(-0.0f), a.v)}; }
+inline Lanes Min(Lanes a, Lanes b) noexcept { return {_mm256_min_ps(a.v, b.v)}; }
+inline Lanes Max(Lanes a, Lanes b) noexcept { return {_mm256_max_ps(a.v, b.v)}; }
+
+//a mask, all bits set in the lanes where a < b, for Select
+inline Lanes Less(Lanes a, Lanes b) noexcept { return {_mm256_cmp_ps(a.v, b.v, _CMP_LT_OQ)}; }
+//if_true where mask is set, if_false everywhere else
+inline Lanes Select(Lanes mask, Lanes if_true, Lanes if_false) noexcept { return {_mm256_blendv_ps(if_false.v, if_true.v, mask.v)}; }
+
+//magnitude with the sign of sign
+inline Lanes CopySign(Lanes magnitude, Lanes sign) noexcept
+{
+	__m256 sign_bit = _mm256_set1_ps(-0.0f);
+	return {_mm256_or_ps(_mm256_andnot_ps(sign_bit, magnitude.v), _mm256_and_ps(sign_bit, sign.v))};
+}
+
+//2^n for whole numbers n from -126 to 127, by writing n + 127 straight into the exponent bits.
+//(n + 127) * 2^23 is that bit pattern as a number, small enough to convert to an int exactly
+inline Lanes PowerOfTwo(Lanes n) noexcept
+{
+	__m256 bits = _mm256_mul_ps(_mm256_add_ps(n.v, _mm256_set1_ps(127.0f)), _mm256_set1_ps(8388608.0f));
+	return {_mm256_castsi256_ps(_mm256_cvtps_epi32(bits))};
+}
+
+//about 1 / sqrt(a), the hardware estimate, within 1.5 * 2^-12 relative error
+inline Lanes InverseSqrtEstimate(Lanes a) noexcept { return {_mm256_rsqrt_ps(a.v)}; }
+
+//lane_count packed Vector3's (x y z x y z ...) split into all their x's, y's and z's. Each
+//128 bit half does the same shuffles as the SSE version below, on 4 points each: points 0-3 go
+//in the low halves and 4-7 in the high ones
+inline void LoadLanes3Unaligned(const float* p, Lanes& x, Lanes& y, Lanes& z) noexcept
+{
+	__m256 l0 = _mm256_loadu_ps(p), l1 = _mm256_loadu_ps(p + 8), l2 = _mm256_loadu_ps(p + 16);
+	__m256 a = _mm256_permute2f128_ps(l0, l1, 0x30); //x0 y0 z0 x1 | x4 y4 z4 x5
+	__m256 b = _mm256_permute2f128_ps(l0, l2, 0x21); //y1 z1 x2 y2 | y5 z5 x6 y6
+	__m256 c = _mm256_permute2f128_ps(l1, l2, 0x30); //z2 x3 y3 z3 | z6 x7 y7 z7
+	__m256 bc = _mm256_shuffle_ps(b, c, _MM_SHUFFLE(2, 1, 3, 2)); //x2 y2 x3 y3
+	__m256 ab = _mm256_shuffle_ps(a, b, _MM_SHUFFLE(1, 0, 2, 1)); //y0 z0 y1 z1
+	x.v = _mm256_shuffle_ps(a, bc, _MM_SHUFFLE(2, 0, 3, 0));
+	y.v = _mm256_shuffle_ps(ab, bc, _MM_SHUFFLE(3, 1, 2, 0));
+	z.v = _mm256_shuffle_ps(ab, c, _MM_SHUFFLE(3, 0, 3, 1));
+}
+
+//the other way around, back to lane_count packed Vector3's
+inline void PackLanes3(Lanes x, Lanes y, Lanes z, __m256& l0, __m256& l1, __m256& l2) noexcept
+{
+	__m256 xy = _mm256_unpacklo_ps(x.v, y.v);                                //x0 y0 x1 y1
+	__m256 zx = _mm256_shuffle_ps(z.v, x.v, _MM_SHUFFLE(1, 1, 0, 0));        //z0 z0 x1 x1
+	__m256 a = _mm256_shuffle_ps(xy, zx, _MM_SHUFFLE(2, 0, 1, 0));            //x0 y0 z0 x1
+	__m256 yz = _mm256_shuffle_ps(y.v, z.v, _MM_SHUFFLE(2, 1, 2, 1));        //y1 y2 z1 z2
+	__m256 xy2 = _mm256_shuffle_ps(x.v, y.v, _MM_SHUFFLE(2, 2, 2, 2));       //x2 x2 y2 y2
+	__m256 b = _mm256_shuffle_ps(yz, xy2, _MM_SHUFFLE(2, 0, 2, 0));           //y1 z1 x2 y2
+	__m256 zx3 = _mm256_shuffle_ps(z.v, x.v, _MM_SHUFFLE(3, 3, 2, 2));       //z2 z2 x3 x3
+	__m256 yz3 = _mm256_shuffle_ps(y.v, z.v, _MM_SHUFFLE(3, 3, 3, 3));       //y3 y3 z3 z3
+	__m256 c = _mm256_shuffle_ps(zx3, yz3, _MM_SHUFFLE(2, 0, 2, 0));         //z2 x3 y3 z3
+	l0 = _mm256_permute2f128_ps(a, b, 0x20);
+	l1 = _mm256_permute2f128_ps(c, a, 0x30);
+	l2 = _mm256_permute2f128_ps(b, c, 0x31);
+}
+
+inline void StoreLanes3Unaligned(float* p, Lanes x, Lanes y, Lanes z) noexcept
+{
+	__m256 l0, l1, l2;
+	PackLanes3(x, y, z, l0, l1, l2);
+	_mm256_storeu_ps(p, l0);
+	_mm256_storeu_ps(p + 8, l1);
+	_mm256_storeu_ps(p + 16, l2);
+}
+
+//same as StoreLanes3Unaligned, but with non-temporal stores that go around the cache (see
+//StreamFence). p has to be lane_count * 4 byte aligned
+inline void StreamLanes3(float* p, Lanes x, Lanes y, Lanes z) noexcept
+{
+	__m256 l0, l1, l2;
+	PackLanes3(x, y, z, l0, l1, l2);
+	_mm256_stream_ps(p, l0);
+	_mm256_stream_ps(p + 8, l1);
+	_mm256_stream_ps(p + 16, l2);
+}
+
+#elif MATH_SIMD_SSE
+
+static constexpr size_t lane_count = 4;
+struct Lanes { __m128 v; };
+
+inline Lanes LoadLanes(const float* p) noexcept { return {_mm_load_ps(p)}; }
+inline Lanes LoadLanesUnaligned(const float* p) noexcept { return {_mm_loadu_ps(p)}; }
+inline void StoreLanes(float* p, Lanes a) noexcept { _mm_store_ps(p, a.v); }
+inline void StoreLanesUnaligned(float* p, Lanes a) noexcept { _mm_storeu_ps(p, a.v); }
+inline Lanes SplatLanes(float value) noexcept { return {_mm_set1_ps(value)}; }
+
+inline Lanes operator+(Lanes a, Lanes b) noexcept { return {_mm_add_ps(a.v, b.v)}; }
+inline Lanes operator-(Lanes a, Lanes b) noexcept { return {_mm_sub_ps(a.v, b.v)}; }
+inline Lanes operator*(Lanes a, Lanes b) noexcept { return {_mm_mul_ps(a.v, b.v)}; }
+inline Lanes operator/(Lanes a, Lanes b) noexcept { return {_mm_div_ps(a.v, b.v)}; }
+inline Lanes Sqrt(Lanes a) noexcept { return {_mm_sqrt_ps(a.v)}; }
+
+inline Lanes MultiplyAdd(Lanes a, Lanes b, Lanes c) noexcept
+{
+#if MATH_SIMD_FMA
+	return {_mm_fmadd_ps(a.v, b.v, c.v)};
+#else
+	return {_mm_add_ps(_mm_mul_ps(a.v, b.v), c.v)};
+#endif
+}
+
+inline Lanes InverseLengthOrZero(Lanes squared_length) noexcept
+{
+	__m128 inverse = _mm_div_ps(_mm_set1_ps(1.0f), _mm_sqrt_ps(squared_length.v));
+	__m128 non_zero = _mm_cmpgt_ps(squared_length.v, _mm_setzero_ps());
+	return {_mm_and_ps(inverse, non_zero)};
+}
+
+inline Lanes Abs(Lanes a) noexcept { return {_mm_andnot_ps(_mm_set1_ps(-0.0f), a.v)}; }
+inline Lanes Min(Lanes a, Lanes b) noexcept { return {_mm_min_ps(a.v, b.v)}; }
+inline Lanes Max(Lanes a, Lanes b) noexcept { return {_mm_max_ps(a.v, b.v)}; }
+
+//a mask, all bits set in the lanes where a < b, for Select
+inline Lanes Less(Lanes a, Lanes b) noexcept { return {_mm_cmplt_ps(a.v, b.v)}; }
+//if_true where mask is set, if_false everywhere else
+inline Lanes Select(Lanes mask, Lanes if_true, Lanes if_false) noexcept
+{
+#if MATH_SIMD_SSE4
+	return {_mm_blendv_ps(if_false.v, if_true.v, mask.v)};
+#else
+	return {_mm_or_ps(_mm_and_ps(mask.v, if_true.v), _mm_andnot_ps(mask.v, if_false.v))};
+#endif
+}
+
+//magnitude with the sign of sign
+inline Lanes CopySign(Lanes magnitude, Lanes sign) noexcept
+{
+	__m128 sign_bit = _mm_set1_ps(-0.0f);
+	return {_mm_or_ps(_mm_andnot_ps(sign_bit, magnitude.v), _mm_and_ps(sign_bit, sign.v))};
+}
+
+//2^n for whole numbers n from -126 to 127, by writing n + 127 straight into the exponent bits.
+//(n + 127) * 2^23 is that bit pattern as a number, small enough to convert to an int exactly
+inline Lanes PowerOfTwo(Lanes n) noexcept
+{
+	__m128 bits = _mm_mul_ps(_mm_add_ps(n.v, _mm_set1_ps(127.0f)), _mm_set1_ps(8388608.0f));
+	return {_mm_castsi128_ps(_mm_cvtps_epi32(bits))};
+}
+
+//about 1 / sqrt(a), the hardware estimate, within 1.5 * 2^-12 relative error
+inline Lanes InverseSqrtEstimate(Lanes a) noexcept { return {_mm_rsqrt_ps(a.v)}; }
+
+//lane_count packed Vector3's (x y z x y z ...) split into all their x's, y's and z's
+inline void LoadLanes3Unaligned(const float* p, Lanes& x, Lanes& y, Lanes& z) noexcept
+{
+	__m128 a = _mm_loadu_ps(p);     //x0 y0 z0 x1
+	__m128 b = _mm_loadu_ps(p + 4); //y1 z1 x2 y2
+	__m128 c = _mm_loadu_ps(p + 8); //z2 x3 y3 z3
+	__m128 bc = _mm_shuffle_ps(b, c, _MM_SHUFFLE(2, 1, 3, 2)); //x2 y2 x3 y3
+	__m128 ab = _mm_shuffle_ps(a, b, _MM_SHUFFLE(1, 0, 2, 1)); //y0 z0 y1 z1
+	x.v = _mm_shuffle_ps(a, bc, _MM_SHUFFLE(2, 0, 3, 0));
+	y.v = _mm_shuffle_ps(ab, bc, _MM_SHUFFLE(3, 1, 2, 0));
+	z.v = _mm_shuffle_ps(ab, c, _MM_SHUFFLE(3, 0, 3, 1));
+}
+
+//the other way around, back to lane_count packed Vector3's
+inline void PackLanes3(Lanes x, Lanes y, Lanes z, __m128& a, __m128& b, __m128& c) noexcept
+{
+	__m128 xy = _mm_unpacklo_ps(x.v, y.v);                                //x0 y0 x1 y1
+	__m128 zx = _mm_shuffle_ps(z.v, x.v, _MM_SHUFFLE(1, 1, 0, 0));        //z0 z0 x1 x1
+	a = _mm_shuffle_ps(xy, zx, _MM_SHUFFLE(2, 0, 1, 0));                   //x0 y0 z0 x1
+	__m128 yz = _mm_shuffle_ps(y.v, z.v, _MM_SHUFFLE(2, 1, 2, 1));        //y1 y2 z1 z2
+	__m128 xy2 = _mm_shuffle_ps(x.v, y.v, _MM_SHUFFLE(2, 2, 2, 2));       //x2 x2 y2 y2
+	b = _mm_shuffle_ps(yz, xy2, _MM_SHUFFLE(2, 0, 2, 0));                  //y1 z1 x2 y2
+	__m128 zx3 = _mm_shuffle_ps(z.v, x.v, _MM_SHUFFLE(3, 3, 2, 2));       //z2 z2 x3 x3
+	__m128 yz3 = _mm_shuffle_ps(y.v, z.v, _MM_SHUFFLE(3, 3, 3, 3));       //y3 y3 z3 z3
+	c = _mm_shuffle_ps(zx3, yz3, _MM_SHUFFLE(2, 0, 2, 0));                 //z2 x3 y3 z3
+}
+
+inline void StoreLanes3Unaligned(float* p, Lanes x, Lanes y, Lanes z) noexcept
+{
+	__m128 a, b, c;
+	PackLanes3(x, y, z, a, b, c);
+	_mm_storeu_ps(p, a);
+	_mm_storeu_ps(p + 4, b);
+	_mm_storeu_ps(p + 8, c);
+}
+
+//same as StoreLanes3Unaligned, but with non-temporal stores that go around the cache (see
+//StreamFence). p has to be lane_count * 4 byte aligned
+inline void StreamLanes3(float* p, Lanes x, Lanes y, Lanes z) noexcept
+{
+	__m128 a, b, c;
+	PackLanes3(x, y, z, a, b, c);
+	_mm_stream_ps(p, a);
+	_mm_stream_ps(p + 4, b);
+	_mm_stream_ps(p + 8, c);
+}
+
+#else
+
+static constexpr size_t lane_count = 1;
+struct Lanes { float v; };
+
+inline Lanes LoadLanes(const float* p) noexcept { return {*p}; }
+inline Lanes LoadLanesUnaligned(const float* p) noexcept { return {*p}; }
+inline void StoreLanes(float* p, Lanes a) noexcept { *p = a.v; }
+inline void StoreLanesUnaligned(float* p, Lanes a) noexcept { *p = a.v; }
+inline Lanes SplatLanes(float value) noexcept { return {value}; }
+
+inline Lanes operator+(Lanes a, Lanes b) noexcept { return {a.v + b.v}; }
+inline Lanes operator-(Lanes a, Lanes b) noexcept { return {a.v - b.v}; }
+inline Lanes operator*(Lanes a, Lanes b) noexcept { return {a.v * b.v}; }
+inline Lanes operator/(Lanes a, Lanes b) noexcept { return {a.v / b.v}; }
+inline Lanes Sqrt(Lanes a) noexcept { return {std::sqrt(a.v)}; }
+
+inline Lanes MultiplyAdd(Lanes a, Lanes b, Lanes c) noexcept { return {a.v * b.v + c.v}; }
+
+inline Lanes InverseLengthOrZero(Lanes squared_length) noexcept
+{
+	return {squared_length.v > 0 ? 1.0f / std::sqrt(squared_length.v) : 0.0f};
+}
+
+inline Lanes Abs(Lanes a) noexcept { return {std::fabs(a.v)}; }
+inline Lanes Min(Lanes a, Lanes b) noexcept { return {a.v < b.v ? a.v : b.v}; }
+inline Lanes Max(Lanes a, Lanes b) noexcept { return {a.v > b.v ? a.v : b.v}; }
+
+//with one lane the mask is just a bool
+inline bool Less(Lanes a, Lanes b) noexcept { return a.v < b.v; }
+inline Lanes Select(bool mask, Lanes if_true, Lanes if_false) noexcept { return mask ? if_true : if_false; }
+
+inline Lanes CopySign(Lanes magnitude, Lanes sign) noexcept { return {std::copysign(magnitude.v, sign.v)}; }
+
+//2^n for whole numbers n from -126 to 127, n + 127 written straight into the exponent bits
+inline Lanes PowerOfTwo(Lanes n) noexcept
+{
+	uint32_t bits = static_cast<uint32_t>(n.v + 127.0f) << 23;
+	float result;
+	memcpy(&result, &bits, sizeof(result));
+	return {result};
+}
+
+//about 1 / sqrt(a). Without the hardware estimate it is the well known integer trick plus one
+//Newton-Raphson step, within 1.8e-3 relative error
+inline Lanes InverseSqrtEstimate(Lanes a) noexcept
+{
+	uint32_t bits;
+	memcpy(&bits, &a.v, sizeof(bits));
+	bits = 0x5F375A86 - (bits >> 1);
+	float y;
+	memcpy(&y, &bits, sizeof(y));
+	return {y * (1.5f - 0.5f * a.v * y * y)};
+}
+
+inline void LoadLanes3Unaligned(const float* p, Lanes& x, Lanes& y, Lanes& z) noexcept
+{
+	x.v = p[0];
+	y.v = p[1];
+	z.v = p[2];
+}
+inline void StoreLanes3Unaligned(float* p, Lanes x, Lanes y, Lanes z) noexcept
+{
+	p[0] = x.v;
+	p[1] = y.v;
+	p[2] = z.v;
+}
+//nothing to go around the cache with, plain stores
+inline void StreamLanes3(float* p, Lanes x, Lanes y, Lanes z) noexcept { StoreLanes3Unaligned(p, x, y, z); }
+
+#endif
+
+//non-temporal stores are not ordered with other stores. Call this after the last one, before
+//another thread is told the data is ready
+inline void StreamFence() noexcept
+{
+#if MATH_SIMD_SSE
+	_mm_sfence();
+#endif
+}
+
+} // namespace simd
+} // namespace math
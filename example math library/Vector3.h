@@ -1,88 +1,181 @@
 #pragma once
 //VERY IMPORTANT! #pragma once  GOES AT THE TOP OF EVERY .h/.hpp FILE!
-//it is a header guard, and will keep many strange compiler errors at bay 
+//it is a header guard, and will keep many strange compiler errors at bay
 
+#include <cmath>
 #include <iostream>
 #include <string>
 
 //Example Vector3 class for reference
 
+//Everything is defined right here in the header. Functions defined inside the class body are
+//implicitly inline, so every file that includes this can inline them into its own loops. With
+//the definitions hidden away in a .cpp file, each a + b would be a function call unless the
+//linker does link time optimization.
+
+//constexpr means it can run at compile time, so Vector3's can be used in constants and
+//static_asserts. noexcept promises nothing throws, which lets the compiler skip exception
+//bookkeeping. The functions built on std::sqrt can't be constexpr, the standard library
+//doesn't make sqrt constexpr (yet).
+
 namespace math {
 
 class Vector3
-{ 
+{
 	//all variables & functions following this will be public
-	//private works the same way 
+	//private works the same way
 	public:
 
 	//default values, otherwise the value is undefined (ie whatever the memory had beforehand}
-	float x = 0; 
+	float x = 0;
 	float y = 0;
 	float z = 0;
-	
+
 	/* CONSTRUCTION */
 
-	//default constructor (ctor)
-	Vector3(); 
-	
+	//default constructor (ctor), = default uses the default values above
+	constexpr Vector3() noexcept = default;
+
 	//ctor with arguments
-	explicit Vector3(float x, float y, float z);
+	constexpr explicit Vector3(float x, float y, float z) noexcept : x(x), y(y), z(z) {}
 
 	/* OPERATOR OVERLOADING */
 
 	//operator overloading enables very convenient access in user code.
 	//Ex: vecA = vecB + vecC; compare to a java: vecA = vecB.Add(vecC);
 
-	Vector3 operator-(); //unary minus
+	//operators that don't change the vector are const, so they work on const vectors and temporaries.
+	//the order matters for - and /, it is always this (the left side) minus/divided by right.
 
-	Vector3 operator+(Vector3 const & right); //binary addition
-	Vector3& operator+=(Vector3 const & right); //addition assignment
-	
-	Vector3 operator-(Vector3 const & right); //binary negation
-	Vector3& operator-=(Vector3 const & right); //negation assignment
+	constexpr Vector3 operator-() const noexcept { return Vector3(-x, -y, -z); } //unary minus
 
-	Vector3 operator*(Vector3 const & right);
-	Vector3& operator*=(Vector3 const & right);
+	constexpr Vector3 operator+(Vector3 const& right) const noexcept { return Vector3(x + right.x, y + right.y, z + right.z); } //binary addition
+	constexpr Vector3& operator+=(Vector3 const& right) noexcept //addition assignment
+	{
+		x += right.x;
+		y += right.y;
+		z += right.z;
+		return *this; //returns a reference, *this returns the reference to itself
+	}
+
+	constexpr Vector3 operator-(Vector3 const& right) const noexcept { return Vector3(x - right.x, y - right.y, z - right.z); } //binary subtraction
+	constexpr Vector3& operator-=(Vector3 const& right) noexcept //subtraction assignment
+	{
+		x -= right.x;
+		y -= right.y;
+		z -= right.z;
+		return *this;
+	}
+
+	//component wise, (a.x * b.x, a.y * b.y, a.z * b.z). Not to be confused with Dot or Cross
+	constexpr Vector3 operator*(Vector3 const& right) const noexcept { return Vector3(x * right.x, y * right.y, z * right.z); }
+	constexpr Vector3& operator*=(Vector3 const& right) noexcept
+	{
+		x *= right.x;
+		y *= right.y;
+		z *= right.z;
+		return *this;
+	}
+
+	constexpr Vector3 operator/(Vector3 const& right) const noexcept { return Vector3(x / right.x, y / right.y, z / right.z); }
+	constexpr Vector3& operator/=(Vector3 const& right) noexcept
+	{
+		x /= right.x;
+		y /= right.y;
+		z /= right.z;
+		return *this;
+	}
+
+	//scaling by a single number
+	constexpr Vector3 operator*(float scale) const noexcept { return Vector3(x * scale, y * scale, z * scale); }
+	constexpr Vector3& operator*=(float scale) noexcept
+	{
+		x *= scale;
+		y *= scale;
+		z *= scale;
+		return *this;
+	}
 
-	Vector3 operator/(Vector3 const & right); 
-	Vector3& operator/=(Vector3 const & right);
+	constexpr Vector3 operator/(float scale) const noexcept { return Vector3(x / scale, y / scale, z / scale); }
+	constexpr Vector3& operator/=(float scale) noexcept
+	{
+		x /= scale;
+		y /= scale;
+		z /= scale;
+		return *this;
+	}
 
 	/* EQUALITY COMPARISON */
 
-	bool operator==(Vector3 const& right);
-	bool operator!=(Vector3 const& right);
+	//exact comparison, floats that went through different math rarely compare equal
+	constexpr bool operator==(Vector3 const& right) const noexcept { return x == right.x && y == right.y && z == right.z; }
+	constexpr bool operator!=(Vector3 const& right) const noexcept { return !(*this == right); } // no need to rewrite
 
 	/* COMMON OPERATIONS */
 
-	//gets the magnitude
-	float Magnitude() const;
-	
-	//mutates the class
-	void Normalize();
+	//gets the magnitude (length)
+	float Magnitude() const noexcept { return std::sqrt(MagnitudeSquared()); }
+
+	//the magnitude without the square root. Enough for comparing lengths, and much cheaper
+	constexpr float MagnitudeSquared() const noexcept { return x * x + y * y + z * z; }
+
+	//mutates the class. A zero vector has no direction and is left as it is.
+	//FastMath.h has versions that trade a little precision for speed
+	void Normalize() noexcept
+	{
+		float length = Magnitude();
+		if(length > 0){
+			*this /= length;
+		}
+	}
 
 	//returns a Vector3 that is the normal, but doesn't change the original one
-	Vector3 Normal() const;
+	Vector3 Normal() const noexcept
+	{
+		Vector3 normal = *this;
+		normal.Normalize();
+		return normal;
+	}
 
 	// member functions
-	float Dot(Vector3 const& right);
-	Vector3 Cross(Vector3 const& right);
+	constexpr float Dot(Vector3 const& right) const noexcept { return x * right.x + y * right.y + z * right.z; }
+	constexpr Vector3 Cross(Vector3 const& right) const noexcept
+	{
+		return Vector3(y * right.z - z * right.y,
+		               z * right.x - x * right.z,
+		               x * right.y - y * right.x);
+	}
 
 	//extra fun stuff
-	Vector3 Lerp(Vector3& left, float val);
-	Vector3 Projection(Vector3& left, Vector3& right);
-	Vector3 Perpendicular(Vector3& left, Vector3& right);
-	
+
+	//t = 0 gives this, t = 1 gives to, anything in between a straight line between them
+	constexpr Vector3 Lerp(Vector3 const& to, float t) const noexcept { return *this + (to - *this) * t; }
+
+	//the part of this that points along onto. Zero if onto is a zero vector
+	constexpr Vector3 Projection(Vector3 const& onto) const noexcept
+	{
+		float onto_squared = onto.MagnitudeSquared();
+		if(onto_squared == 0){
+			return Vector3{};
+		}
+		return onto * (Dot(onto) / onto_squared);
+	}
+
+	//the part of this at a right angle to onto, so Projection(onto) + Perpendicular(onto) == *this
+	constexpr Vector3 Perpendicular(Vector3 const& onto) const noexcept { return *this - Projection(onto); }
+
 	/* UTILITY FUNCTIONS */
 
 	//return address of first element. useful for uploading to GPU
-	float* data_ptr();
+	constexpr float* data_ptr() noexcept { return &x; }
+	constexpr const float* data_ptr() const noexcept { return &x; }
 
 	//this is what a idiomatic to_string looks like.
 	friend std::ostream& operator<<(std::ostream &strm, const Vector3 &v) {
 		return strm << "[" << v.x << ", " << v.y << ", " << v.z << "]";
 	}
 
-	std::string to_string(){
+	std::string to_string() const {
 		return std::string("[") + std::to_string(x) + ","+ std::to_string(y) + ","+ std::to_string(z) + "]";
 	}
 
@@ -90,22 +183,31 @@ class Vector3
 	private:
 };
 
-//free standing functions
+//data_ptr() hands out x as if it was an array of 3 floats, which only works without padding
+static_assert(sizeof(Vector3) == 3 * sizeof(float), "Vector3 must be exactly x, y, z");
+
+//free standing functions, same as the members but read better in formulas
+
+//so 2.0f * v works as well as v * 2.0f
+constexpr Vector3 operator*(float scale, Vector3 const& v) noexcept { return v * scale; }
+
+constexpr float Dot(Vector3 const& left, Vector3 const& right) noexcept { return left.Dot(right); }
+constexpr Vector3 Cross(Vector3 const& left, Vector3 const& right) noexcept { return left.Cross(right); }
 
-float Dot(Vector3& left, Vector3& right);
-Vector3 Cross(Vector3& left, Vector3& right);
+inline float Distance(Vector3 const& left, Vector3 const& right) noexcept { return (right - left).Magnitude(); }
 
-Vector3 Lerp(Vector3& left, float val);
-Vector3 Projection(Vector3& left, Vector3& right);
-Vector3 Perpendicular(Vector3& left, Vector3& right);
+constexpr Vector3 Lerp(Vector3 const& from, Vector3 const& to, float t) noexcept { return from.Lerp(to, t); }
+constexpr Vector3 Projection(Vector3 const& v, Vector3 const& onto) noexcept { return v.Projection(onto); }
+constexpr Vector3 Perpendicular(Vector3 const& v, Vector3 const& onto) noexcept { return v.Perpendicular(onto); }
 
 
 //assuming right handed Y-up axis
-static const Vector3 VECTOR3_UP{0.0f, 1.0f, 0.0f};
-static const Vector3 VECTOR3_DOWN{0.0f, -1.0f, 0.0f};
-static const Vector3 VECTOR3_RIGHT{1.0f, 0.0f, 0.0f};
-static const Vector3 VECTOR3_LEFT{-1.0f, 1.0f, 0.0f};
-static const Vector3 VECTOR3_FORWARD{0.0f, 0.0f, 1.0f};
-static const Vector3 VECTOR3_BACKWARD{0.0f, 0.0f, -1.0f};
-
-}
\ No newline at end of file
+//inline constexpr: one shared copy no matter how many files include this, and usable at compile time
+inline constexpr Vector3 VECTOR3_UP{0.0f, 1.0f, 0.0f};
+inline constexpr Vector3 VECTOR3_DOWN{0.0f, -1.0f, 0.0f};
+inline constexpr Vector3 VECTOR3_RIGHT{1.0f, 0.0f, 0.0f};
+inline constexpr Vector3 VECTOR3_LEFT{-1.0f, 0.0f, 0.0f};
+inline constexpr Vector3 VECTOR3_FORWARD{0.0f, 0.0f, 1.0f};
+inline constexpr Vector3 VECTOR3_BACKWARD{0.0f, 0.0f, -1.0f};
+
+}
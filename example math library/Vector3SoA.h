@@ -0,0 +1,559 @@
+#pragma once
+
+#include <stddef.h>
+#include <string.h>
+
+#include <cassert>
+#include <new>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+
+#include "FastMath.h"
+#include "Simd.h"
+#include "Vector3.h"
+
+//Vector3SoA, a whole array of Vector3's stored as a structure of arrays (SoA).
+//
+//std::vector<Vector3> is an array of structures (AoS): x y z x y z x y z ... To add two of them
+//with SIMD, the x's, y's and z's have to be shuffled apart first, and a Dot or Cross mixes
+//components across lanes, which SIMD is bad at. Vector3SoA keeps every x in one array, every y
+//in another and every z in a third:
+//
+//	x x x x x x x x ...
+//	y y y y y y y y ...
+//	z z z z z z z z ...
+//
+//Now lane i of a register is simply element i. Eight Dot products (with AVX) are three
+//multiplies and two adds, exactly like a single scalar one, with no shuffling at all.
+//
+//The arrays are aligned to 64 bytes and their length is rounded up to a multiple of 16, so the
+//kernels below can work on whole registers all the way to the end without a scalar loop for
+//the leftovers. The padding is zero to begin with. Kernels that write a Vector3SoA write the
+//padding too, so it holds whatever the math made of it, never read it.
+//
+//	Vector3SoA positions(particles.data(), particles.size()); //from an array of Vector3's
+//	Vector3SoA velocities(particles.size());
+//	...
+//	MultiplyAdd(velocities, dt, positions, positions);       //positions += velocities * dt
+//	positions.ToAoS(particles.data());                       //and back
+//
+//Each kernel does two registers per loop iteration (16 elements with AVX, 8 with SSE), which
+//gives the CPU two independent chains of work to overlap. Inputs and outputs may be the same
+//container. Outputs are resized to match the inputs, which only allocates when the size changes.
+//Kernels taking two arrays return false and leave out alone when their sizes differ, in release
+//builds too, as the shorter one would be read past its end otherwise.
+//
+//The same + - * / as Vector3 work on whole arrays too, mixed with floats and single Vector3's:
+//
+//	positions += velocities * dt;
+//	Vector3SoA c = a * b - a / b + Vector3(0, 1, 0);
+//
+//Calling a kernel per operator would go over all the arrays once per operator and need a
+//temporary array for each step in between. Instead the operators build a small expression
+//object (see EXPRESSIONS at the end of this file) and nothing is worked out until it is assigned
+//to a Vector3SoA. Then every element goes through the whole expression in one pass, straight
+//from the inputs to the output, and a * b + c becomes a MultiplyAdd. Don't keep an expression in
+//an auto variable, it only points at its arrays and doesn't keep them alive. Assigning an
+//expression that mixes arrays of different sizes throws std::length_error, in every build.
+
+namespace math {
+
+class Vector3SoA;
+
+namespace soa_detail {
+
+//everything the operators below build derives from this
+struct ExpressionBase {};
+
+template<typename T>
+using EnableIfExpression = std::enable_if_t<std::is_base_of<ExpressionBase, T>::value>;
+
+} // namespace soa_detail
+
+class Vector3SoA
+{
+	public:
+
+	//every array is padded to a multiple of this many floats
+	static constexpr size_t padding = 16;
+	static constexpr size_t alignment = 64; //a cache line, also enough for AVX-512
+
+	/* CONSTRUCTION */
+
+	Vector3SoA() noexcept = default;
+
+	//count zero vectors
+	explicit Vector3SoA(size_t count) { Resize(count); }
+
+	Vector3SoA(const Vector3* aos, size_t count) { FromAoS(aos, count); }
+
+	Vector3SoA(Vector3SoA const& other) { *this = other; }
+	Vector3SoA& operator=(Vector3SoA const& other)
+	{
+		if(this != &other){
+			Resize(other.count);
+			for(int axis = 0; axis < 3 && padded_count > 0; axis++){
+				memcpy(data + axis * capacity, other.data + axis * other.capacity, padded_count * sizeof(float));
+			}
+		}
+		return *this;
+	}
+
+	Vector3SoA(Vector3SoA&& other) noexcept { Swap(other); }
+	Vector3SoA& operator=(Vector3SoA&& other) noexcept
+	{
+		Swap(other);
+		return *this;
+	}
+
+	~Vector3SoA() { Free(); }
+
+	/* EXPRESSIONS */
+
+	//worked out in one pass, resizing to the size of the expression. The expression may use
+	//this same container, every element is read before it is written. Throws std::length_error
+	//if the arrays in it aren't all the same size, leaving this container as it was.
+	template<typename Expression, typename = soa_detail::EnableIfExpression<Expression>>
+	Vector3SoA(Expression const& expression) { *this = expression; }
+	template<typename Expression, typename = soa_detail::EnableIfExpression<Expression>>
+	Vector3SoA& operator=(Expression const& expression);
+
+	//another Vector3SoA, an expression, a Vector3 or a float
+	template<typename Operand>
+	Vector3SoA& operator+=(Operand const& right) { return *this = *this + right; }
+	template<typename Operand>
+	Vector3SoA& operator-=(Operand const& right) { return *this = *this - right; }
+	template<typename Operand>
+	Vector3SoA& operator*=(Operand const& right) { return *this = *this * right; }
+	template<typename Operand>
+	Vector3SoA& operator/=(Operand const& right) { return *this = *this / right; }
+
+	/* SIZE */
+
+	//keeps the first count vectors, new ones are zero. Only allocates when growing past
+	//what it had room for before.
+	void Resize(size_t new_count)
+	{
+		size_t new_padded = (new_count + padding - 1) / padding * padding;
+		if(new_padded > capacity){
+			float* new_data = (float*)::operator new(3 * new_padded * sizeof(float), std::align_val_t(alignment));
+			for(int axis = 0; axis < 3 && count > 0; axis++){
+				memcpy(new_data + axis * new_padded, data + axis * capacity, count * sizeof(float));
+			}
+			Free();
+			data = new_data;
+			capacity = new_padded;
+		}
+		if(new_count > count){
+			//the new elements and the padding after them
+			for(int axis = 0; axis < 3; axis++){
+				memset(data + axis * capacity + count, 0, (new_padded - count) * sizeof(float));
+			}
+		}
+		count = new_count;
+		padded_count = new_padded;
+	}
+
+	size_t Size() const noexcept { return count; }
+	//Size() rounded up to the padding, how far the arrays really go
+	size_t PaddedSize() const noexcept { return padded_count; }
+
+	/* ACCESS */
+
+	float* X() noexcept { return data; }
+	float* Y() noexcept { return data + capacity; }
+	float* Z() noexcept { return data + 2 * capacity; }
+	const float* X() const noexcept { return data; }
+	const float* Y() const noexcept { return data + capacity; }
+	const float* Z() const noexcept { return data + 2 * capacity; }
+
+	//one element at a time, handy but slow. Use the kernels for whole arrays
+	Vector3 Get(size_t index) const noexcept { return Vector3(X()[index], Y()[index], Z()[index]); }
+	void Set(size_t index, Vector3 const& v) noexcept
+	{
+		X()[index] = v.x;
+		Y()[index] = v.y;
+		Z()[index] = v.z;
+	}
+
+	/* CONVERSION */
+
+	//copies count Vector3's in, resizing to count
+	void FromAoS(const Vector3* aos, size_t new_count)
+	{
+		Resize(new_count);
+		float* x = X();
+		float* y = Y();
+		float* z = Z();
+		for(size_t i = 0; i < new_count; i++){
+			x[i] = aos[i].x;
+			y[i] = aos[i].y;
+			z[i] = aos[i].z;
+		}
+	}
+
+	//copies Size() Vector3's out
+	void ToAoS(Vector3* aos) const noexcept
+	{
+		const float* x = X();
+		const float* y = Y();
+		const float* z = Z();
+		for(size_t i = 0; i < count; i++){
+			aos[i] = Vector3(x[i], y[i], z[i]);
+		}
+	}
+
+	private:
+
+	void Free() noexcept
+	{
+		if(data != nullptr){
+			::operator delete(data, std::align_val_t(alignment));
+		}
+		data = nullptr;
+		capacity = 0;
+	}
+
+	void Swap(Vector3SoA& other) noexcept
+	{
+		std::swap(data, other.data);
+		std::swap(count, other.count);
+		std::swap(padded_count, other.padded_count);
+		std::swap(capacity, other.capacity);
+	}
+
+	float* data = nullptr; //x, then y, then z, each capacity long
+	size_t count = 0;
+	size_t padded_count = 0;
+	size_t capacity = 0; //how many floats each array has room for, a multiple of padding
+};
+
+namespace soa_detail {
+
+//floats handled by one loop iteration, two registers worth
+static constexpr size_t block = 2 * simd::lane_count;
+static_assert(Vector3SoA::padding % block == 0, "a whole block has to fit in the padding");
+static_assert(Vector3SoA::alignment % (simd::lane_count * sizeof(float)) == 0, "aligned loads need aligned arrays");
+
+//calls body(i) for every register's worth of elements up to padded_count, two per iteration
+template<typename Func>
+inline void ForEachBlock(size_t padded_count, Func&& body)
+{
+	for(size_t i = 0; i < padded_count; i += block){
+		body(i);
+		body(i + simd::lane_count);
+	}
+}
+
+//for kernels that write one float per element to a plain array, which has no padding. Whole
+//blocks go straight to out, the last partial one goes through a buffer on the stack.
+template<typename Func>
+inline void ForEachBlockToFloats(size_t count, float* out, Func&& body)
+{
+	size_t whole = count / block * block;
+	for(size_t i = 0; i < whole; i += block){
+		simd::StoreLanesUnaligned(out + i, body(i));
+		simd::StoreLanesUnaligned(out + i + simd::lane_count, body(i + simd::lane_count));
+	}
+	if(whole < count){
+		alignas(64) float rest[block];
+		simd::StoreLanes(rest, body(whole));
+		simd::StoreLanes(rest + simd::lane_count, body(whole + simd::lane_count));
+		memcpy(out + whole, rest, (count - whole) * sizeof(float));
+	}
+}
+
+} // namespace soa_detail
+
+/* BATCH KERNELS */
+
+//out = a + b
+inline bool Add(Vector3SoA const& a, Vector3SoA const& b, Vector3SoA& out)
+{
+	if(a.Size() != b.Size()) return false;
+	out.Resize(a.Size());
+	const float *ax = a.X(), *ay = a.Y(), *az = a.Z();
+	const float *bx = b.X(), *by = b.Y(), *bz = b.Z();
+	float *ox = out.X(), *oy = out.Y(), *oz = out.Z();
+	soa_detail::ForEachBlock(a.PaddedSize(), [&](size_t i){
+		simd::StoreLanes(ox + i, simd::LoadLanes(ax + i) + simd::LoadLanes(bx + i));
+		simd::StoreLanes(oy + i, simd::LoadLanes(ay + i) + simd::LoadLanes(by + i));
+		simd::StoreLanes(oz + i, simd::LoadLanes(az + i) + simd::LoadLanes(bz + i));
+	});
+	return true;
+}
+
+//out = a - b
+inline bool Subtract(Vector3SoA const& a, Vector3SoA const& b, Vector3SoA& out)
+{
+	if(a.Size() != b.Size()) return false;
+	out.Resize(a.Size());
+	const float *ax = a.X(), *ay = a.Y(), *az = a.Z();
+	const float *bx = b.X(), *by = b.Y(), *bz = b.Z();
+	float *ox = out.X(), *oy = out.Y(), *oz = out.Z();
+	soa_detail::ForEachBlock(a.PaddedSize(), [&](size_t i){
+		simd::StoreLanes(ox + i, simd::LoadLanes(ax + i) - simd::LoadLanes(bx + i));
+		simd::StoreLanes(oy + i, simd::LoadLanes(ay + i) - simd::LoadLanes(by + i));
+		simd::StoreLanes(oz + i, simd::LoadLanes(az + i) - simd::LoadLanes(bz + i));
+	});
+	return true;
+}
+
+//out = a * scale
+inline void Scale(Vector3SoA const& a, float scale, Vector3SoA& out)
+{
+	out.Resize(a.Size());
+	const float *ax = a.X(), *ay = a.Y(), *az = a.Z();
+	float *ox = out.X(), *oy = out.Y(), *oz = out.Z();
+	simd::Lanes s = simd::SplatLanes(scale);
+	soa_detail::ForEachBlock(a.PaddedSize(), [&](size_t i){
+		simd::StoreLanes(ox + i, simd::LoadLanes(ax + i) * s);
+		simd::StoreLanes(oy + i, simd::LoadLanes(ay + i) * s);
+		simd::StoreLanes(oz + i, simd::LoadLanes(az + i) * s);
+	});
+}
+
+//out = a * scale + b, the usual position += velocity * dt. One FMA instruction per component
+//when the CPU has it.
+inline bool MultiplyAdd(Vector3SoA const& a, float scale, Vector3SoA const& b, Vector3SoA& out)
+{
+	if(a.Size() != b.Size()) return false;
+	out.Resize(a.Size());
+	const float *ax = a.X(), *ay = a.Y(), *az = a.Z();
+	const float *bx = b.X(), *by = b.Y(), *bz = b.Z();
+	float *ox = out.X(), *oy = out.Y(), *oz = out.Z();
+	simd::Lanes s = simd::SplatLanes(scale);
+	soa_detail::ForEachBlock(a.PaddedSize(), [&](size_t i){
+		simd::StoreLanes(ox + i, simd::MultiplyAdd(simd::LoadLanes(ax + i), s, simd::LoadLanes(bx + i)));
+		simd::StoreLanes(oy + i, simd::MultiplyAdd(simd::LoadLanes(ay + i), s, simd::LoadLanes(by + i)));
+		simd::StoreLanes(oz + i, simd::MultiplyAdd(simd::LoadLanes(az + i), s, simd::LoadLanes(bz + i)));
+	});
+	return true;
+}
+
+//out[i] = Dot(a[i], b[i]), out has room for a.Size() floats
+inline bool Dot(Vector3SoA const& a, Vector3SoA const& b, float* out)
+{
+	if(a.Size() != b.Size()) return false;
+	const float *ax = a.X(), *ay = a.Y(), *az = a.Z();
+	const float *bx = b.X(), *by = b.Y(), *bz = b.Z();
+	soa_detail::ForEachBlockToFloats(a.Size(), out, [&](size_t i){
+		simd::Lanes d = simd::LoadLanes(ax + i) * simd::LoadLanes(bx + i);
+		d = simd::MultiplyAdd(simd::LoadLanes(ay + i), simd::LoadLanes(by + i), d);
+		return simd::MultiplyAdd(simd::LoadLanes(az + i), simd::LoadLanes(bz + i), d);
+	});
+	return true;
+}
+
+//out = Cross(a, b)
+inline bool Cross(Vector3SoA const& a, Vector3SoA const& b, Vector3SoA& out)
+{
+	if(a.Size() != b.Size()) return false;
+	out.Resize(a.Size());
+	const float *ax = a.X(), *ay = a.Y(), *az = a.Z();
+	const float *bx = b.X(), *by = b.Y(), *bz = b.Z();
+	float *ox = out.X(), *oy = out.Y(), *oz = out.Z();
+	soa_detail::ForEachBlock(a.PaddedSize(), [&](size_t i){
+		//everything is loaded before anything is stored, so out can be a or b
+		simd::Lanes lx = simd::LoadLanes(ax + i), ly = simd::LoadLanes(ay + i), lz = simd::LoadLanes(az + i);
+		simd::Lanes rx = simd::LoadLanes(bx + i), ry = simd::LoadLanes(by + i), rz = simd::LoadLanes(bz + i);
+		simd::StoreLanes(ox + i, ly * rz - lz * ry);
+		simd::StoreLanes(oy + i, lz * rx - lx * rz);
+		simd::StoreLanes(oz + i, lx * ry - ly * rx);
+	});
+	return true;
+}
+
+//out[i] = a[i].Magnitude(), out has room for a.Size() floats
+inline void Length(Vector3SoA const& a, float* out)
+{
+	const float *ax = a.X(), *ay = a.Y(), *az = a.Z();
+	soa_detail::ForEachBlockToFloats(a.Size(), out, [&](size_t i){
+		simd::Lanes x = simd::LoadLanes(ax + i), y = simd::LoadLanes(ay + i), z = simd::LoadLanes(az + i);
+		return simd::Sqrt(simd::MultiplyAdd(z, z, simd::MultiplyAdd(y, y, x * x)));
+	});
+}
+
+//out = a.Normal() for every element, zero vectors stay zero. See FastMath.h for the precision
+template<Precision precision = Precision::Exact>
+inline void Normalize(Vector3SoA const& a, Vector3SoA& out)
+{
+	out.Resize(a.Size());
+	const float *ax = a.X(), *ay = a.Y(), *az = a.Z();
+	float *ox = out.X(), *oy = out.Y(), *oz = out.Z();
+	soa_detail::ForEachBlock(a.PaddedSize(), [&](size_t i){
+		simd::Lanes x = simd::LoadLanes(ax + i), y = simd::LoadLanes(ay + i), z = simd::LoadLanes(az + i);
+		simd::Lanes inverse = InverseLengthOrZero<precision>(simd::MultiplyAdd(z, z, simd::MultiplyAdd(y, y, x * x)));
+		simd::StoreLanes(ox + i, x * inverse);
+		simd::StoreLanes(oy + i, y * inverse);
+		simd::StoreLanes(oz + i, z * inverse);
+	});
+}
+
+//out = Lerp(a, b, t) for every element
+inline bool Lerp(Vector3SoA const& a, Vector3SoA const& b, float t, Vector3SoA& out)
+{
+	if(a.Size() != b.Size()) return false;
+	out.Resize(a.Size());
+	const float *ax = a.X(), *ay = a.Y(), *az = a.Z();
+	const float *bx = b.X(), *by = b.Y(), *bz = b.Z();
+	float *ox = out.X(), *oy = out.Y(), *oz = out.Z();
+	simd::Lanes s = simd::SplatLanes(t);
+	soa_detail::ForEachBlock(a.PaddedSize(), [&](size_t i){
+		simd::Lanes x = simd::LoadLanes(ax + i), y = simd::LoadLanes(ay + i), z = simd::LoadLanes(az + i);
+		simd::StoreLanes(ox + i, simd::MultiplyAdd(simd::LoadLanes(bx + i) - x, s, x));
+		simd::StoreLanes(oy + i, simd::MultiplyAdd(simd::LoadLanes(by + i) - y, s, y));
+		simd::StoreLanes(oz + i, simd::MultiplyAdd(simd::LoadLanes(bz + i) - z, s, z));
+	});
+	return true;
+}
+
+/* EXPRESSIONS */
+
+namespace soa_detail {
+
+//one register's worth of elements, x, y and z
+struct Lanes3 {
+	simd::Lanes x, y, z;
+};
+
+//the Size() of a single float or Vector3, which goes with an array of any size
+static constexpr size_t any_size = size_t(-1);
+//the Size() of an expression with arrays of different sizes somewhere in it
+static constexpr size_t mismatched_size = size_t(-2);
+
+//a Vector3SoA used in an expression. Only points at the arrays
+struct Array : ExpressionBase {
+	const float *x, *y, *z;
+	size_t count;
+
+	explicit Array(Vector3SoA const& v) noexcept : x(v.X()), y(v.Y()), z(v.Z()), count(v.Size()) {}
+	size_t Size() const noexcept { return count; }
+	Lanes3 Evaluate(size_t i) const noexcept { return {simd::LoadLanes(x + i), simd::LoadLanes(y + i), simd::LoadLanes(z + i)}; }
+};
+
+//a float or a Vector3, the same for every element
+struct Broadcast : ExpressionBase {
+	Lanes3 value;
+
+	explicit Broadcast(float s) noexcept : value{simd::SplatLanes(s), simd::SplatLanes(s), simd::SplatLanes(s)} {}
+	explicit Broadcast(Vector3 const& v) noexcept : value{simd::SplatLanes(v.x), simd::SplatLanes(v.y), simd::SplatLanes(v.z)} {}
+	size_t Size() const noexcept { return any_size; }
+	Lanes3 Evaluate(size_t) const noexcept { return value; }
+};
+
+struct AddOp { static simd::Lanes Apply(simd::Lanes a, simd::Lanes b) noexcept { return a + b; } };
+struct SubtractOp { static simd::Lanes Apply(simd::Lanes a, simd::Lanes b) noexcept { return a - b; } };
+struct MultiplyOp { static simd::Lanes Apply(simd::Lanes a, simd::Lanes b) noexcept { return a * b; } };
+struct DivideOp { static simd::Lanes Apply(simd::Lanes a, simd::Lanes b) noexcept { return a / b; } };
+
+template<typename Op, typename Left, typename Right>
+struct Binary;
+
+template<typename T>
+struct IsMultiply : std::false_type {};
+template<typename Left, typename Right>
+struct IsMultiply<Binary<MultiplyOp, Left, Right>> : std::true_type {};
+
+//left op right, component by component
+template<typename Op, typename Left, typename Right>
+struct Binary : ExpressionBase {
+	Left left;
+	Right right;
+
+	Binary(Left const& left, Right const& right) noexcept : left(left), right(right) {}
+
+	//checked once the whole expression is assigned, a mismatch deeper down carries up from there
+	size_t Size() const noexcept
+	{
+		size_t l = left.Size(), r = right.Size();
+		if(l == any_size) return r;
+		if(r == any_size) return l;
+		return l == r ? l : mismatched_size;
+	}
+
+	Lanes3 Evaluate(size_t i) const noexcept
+	{
+		//a * b + c and c + a * b, one FMA instead of a multiply and an add
+		if constexpr(std::is_same<Op, AddOp>::value && IsMultiply<Left>::value){
+			return Fused(left.left.Evaluate(i), left.right.Evaluate(i), right.Evaluate(i));
+		}
+		else if constexpr(std::is_same<Op, AddOp>::value && IsMultiply<Right>::value){
+			return Fused(right.left.Evaluate(i), right.right.Evaluate(i), left.Evaluate(i));
+		}
+		else{
+			Lanes3 a = left.Evaluate(i);
+			Lanes3 b = right.Evaluate(i);
+			return {Op::Apply(a.x, b.x), Op::Apply(a.y, b.y), Op::Apply(a.z, b.z)};
+		}
+	}
+
+	private:
+
+	static Lanes3 Fused(Lanes3 const& a, Lanes3 const& b, Lanes3 const& c) noexcept
+	{
+		return {simd::MultiplyAdd(a.x, b.x, c.x), simd::MultiplyAdd(a.y, b.y, c.y), simd::MultiplyAdd(a.z, b.z, c.z)};
+	}
+};
+
+//what each kind of operand turns into inside an expression
+inline Array ToExpression(Vector3SoA const& v) noexcept { return Array(v); }
+inline Broadcast ToExpression(float s) noexcept { return Broadcast(s); }
+inline Broadcast ToExpression(Vector3 const& v) noexcept { return Broadcast(v); }
+template<typename Expression, typename = EnableIfExpression<Expression>>
+inline Expression const& ToExpression(Expression const& e) noexcept { return e; }
+
+template<typename T>
+static constexpr bool is_array = std::is_same<T, Vector3SoA>::value || std::is_base_of<ExpressionBase, T>::value;
+template<typename T>
+static constexpr bool is_operand = is_array<T> || std::is_arithmetic<T>::value || std::is_same<T, Vector3>::value;
+
+//the operators only exist when at least one side is an array, so they never get in the way of
+//the ones for Vector3 and floats
+template<typename Left, typename Right>
+using EnableIfOperands = std::enable_if_t<(is_array<Left> || is_array<Right>) && is_operand<Left> && is_operand<Right>>;
+
+template<typename Op, typename Left, typename Right>
+inline auto Combine(Left const& left, Right const& right) noexcept
+{
+	using LeftExpression = std::decay_t<decltype(ToExpression(left))>;
+	using RightExpression = std::decay_t<decltype(ToExpression(right))>;
+	return Binary<Op, LeftExpression, RightExpression>(ToExpression(left), ToExpression(right));
+}
+
+} // namespace soa_detail
+
+template<typename Left, typename Right, typename = soa_detail::EnableIfOperands<Left, Right>>
+inline auto operator+(Left const& left, Right const& right) noexcept { return soa_detail::Combine<soa_detail::AddOp>(left, right); }
+template<typename Left, typename Right, typename = soa_detail::EnableIfOperands<Left, Right>>
+inline auto operator-(Left const& left, Right const& right) noexcept { return soa_detail::Combine<soa_detail::SubtractOp>(left, right); }
+template<typename Left, typename Right, typename = soa_detail::EnableIfOperands<Left, Right>>
+inline auto operator*(Left const& left, Right const& right) noexcept { return soa_detail::Combine<soa_detail::MultiplyOp>(left, right); }
+template<typename Left, typename Right, typename = soa_detail::EnableIfOperands<Left, Right>>
+inline auto operator/(Left const& left, Right const& right) noexcept { return soa_detail::Combine<soa_detail::DivideOp>(left, right); }
+
+//unary minus, times -1 flips the sign exactly
+template<typename Operand, typename = soa_detail::EnableIfOperands<Operand, Operand>>
+inline auto operator-(Operand const& operand) noexcept { return operand * -1.0f; }
+
+template<typename Expression, typename>
+inline Vector3SoA& Vector3SoA::operator=(Expression const& expression)
+{
+	size_t size = expression.Size();
+	assert(size != soa_detail::any_size); //the operators always have an array on one side
+	if(size == soa_detail::mismatched_size){
+		throw std::length_error("Vector3SoA expression mixes arrays of different sizes");
+	}
+	Resize(size);
+	float *ox = X(), *oy = Y(), *oz = Z();
+	soa_detail::ForEachBlock(PaddedSize(), [&](size_t i){
+		soa_detail::Lanes3 v = expression.Evaluate(i);
+		simd::StoreLanes(ox + i, v.x);
+		simd::StoreLanes(oy + i, v.y);
+		simd::StoreLanes(oz + i, v.z);
+	});
+	return *this;
+}
+
+}
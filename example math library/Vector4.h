@@ -0,0 +1,207 @@
+#pragma once
+
+#include <cmath>
+#include <iostream>
+#include <string>
+
+#include "FastMath.h"
+#include "Simd.h"
+#include "Vector3.h"
+#include "Vector3A.h"
+
+//Vector4, four floats aligned to 16 bytes so the whole thing fits in one SSE register.
+//
+//Used for homogeneous coordinates (w = 1 for a point, w = 0 for a direction), colors (RGBA), and
+//anything else that naturally comes in fours. Every operation works on all four components,
+//see Simd.h for which instructions get used.
+//
+//	Vector4 point(position, 1.0f);  //from a Vector3
+//	Vector3 moved = (point + offset).ToVector3();
+
+namespace math {
+
+class alignas(16) Vector4
+{
+	public:
+
+	float x = 0;
+	float y = 0;
+	float z = 0;
+	float w = 0;
+
+	/* CONSTRUCTION */
+
+	constexpr Vector4() noexcept = default;
+	constexpr explicit Vector4(float x, float y, float z, float w) noexcept : x(x), y(y), z(z), w(w) {}
+
+	/* CONVERSION */
+
+	constexpr explicit Vector4(Vector3 const& v, float w) noexcept : x(v.x), y(v.y), z(v.z), w(w) {}
+	constexpr explicit Vector4(Vector3A const& v, float w) noexcept : x(v.x), y(v.y), z(v.z), w(w) {}
+
+	//drops w
+	constexpr Vector3 ToVector3() const noexcept { return Vector3(x, y, z); }
+	constexpr Vector3A ToVector3A() const noexcept { return Vector3A(x, y, z); }
+
+	/* OPERATOR OVERLOADING */
+
+	//each one has an SSE version and the plain scalar one, picked when compiling
+
+	Vector4 operator-() const noexcept
+	{
+#if MATH_SIMD_SSE
+		return Vector4(_mm_sub_ps(_mm_setzero_ps(), Load()));
+#else
+		return Vector4(-x, -y, -z, -w);
+#endif
+	}
+
+	Vector4 operator+(Vector4 const& right) const noexcept
+	{
+#if MATH_SIMD_SSE
+		return Vector4(_mm_add_ps(Load(), right.Load()));
+#else
+		return Vector4(x + right.x, y + right.y, z + right.z, w + right.w);
+#endif
+	}
+	Vector4 operator-(Vector4 const& right) const noexcept
+	{
+#if MATH_SIMD_SSE
+		return Vector4(_mm_sub_ps(Load(), right.Load()));
+#else
+		return Vector4(x - right.x, y - right.y, z - right.z, w - right.w);
+#endif
+	}
+	//component wise, like Vector3
+	Vector4 operator*(Vector4 const& right) const noexcept
+	{
+#if MATH_SIMD_SSE
+		return Vector4(_mm_mul_ps(Load(), right.Load()));
+#else
+		return Vector4(x * right.x, y * right.y, z * right.z, w * right.w);
+#endif
+	}
+	Vector4 operator/(Vector4 const& right) const noexcept
+	{
+#if MATH_SIMD_SSE
+		return Vector4(_mm_div_ps(Load(), right.Load()));
+#else
+		return Vector4(x / right.x, y / right.y, z / right.z, w / right.w);
+#endif
+	}
+
+	Vector4 operator*(float scale) const noexcept
+	{
+#if MATH_SIMD_SSE
+		return Vector4(_mm_mul_ps(Load(), _mm_set1_ps(scale)));
+#else
+		return Vector4(x * scale, y * scale, z * scale, w * scale);
+#endif
+	}
+	Vector4 operator/(float scale) const noexcept
+	{
+#if MATH_SIMD_SSE
+		return Vector4(_mm_div_ps(Load(), _mm_set1_ps(scale)));
+#else
+		return Vector4(x / scale, y / scale, z / scale, w / scale);
+#endif
+	}
+
+	//the assignment versions are written in terms of the ones above
+	Vector4& operator+=(Vector4 const& right) noexcept { return *this = *this + right; }
+	Vector4& operator-=(Vector4 const& right) noexcept { return *this = *this - right; }
+	Vector4& operator*=(Vector4 const& right) noexcept { return *this = *this * right; }
+	Vector4& operator/=(Vector4 const& right) noexcept { return *this = *this / right; }
+	Vector4& operator*=(float scale) noexcept { return *this = *this * scale; }
+	Vector4& operator/=(float scale) noexcept { return *this = *this / scale; }
+
+	/* EQUALITY COMPARISON */
+
+	bool operator==(Vector4 const& right) const noexcept
+	{
+#if MATH_SIMD_SSE
+		//one bit per lane that compared equal
+		return _mm_movemask_ps(_mm_cmpeq_ps(Load(), right.Load())) == 0xF;
+#else
+		return x == right.x && y == right.y && z == right.z && w == right.w;
+#endif
+	}
+	bool operator!=(Vector4 const& right) const noexcept { return !(*this == right); }
+
+	/* COMMON OPERATIONS */
+
+	float Dot(Vector4 const& right) const noexcept
+	{
+#if MATH_SIMD_SSE
+		return _mm_cvtss_f32(simd::Dot4(Load(), right.Load()));
+#else
+		return x * right.x + y * right.y + z * right.z + w * right.w;
+#endif
+	}
+
+	float MagnitudeSquared() const noexcept { return Dot(*this); }
+	float Magnitude() const noexcept { return std::sqrt(MagnitudeSquared()); }
+
+	//a zero vector is left as it is. See FastMath.h for the precision
+	template<Precision precision = Precision::Exact>
+	void Normalize() noexcept { *this = Normal<precision>(); }
+	template<Precision precision = Precision::Exact>
+	Vector4 Normal() const noexcept
+	{
+#if MATH_SIMD_SSE
+		__m128 v = Load();
+		return Vector4(simd::DivideByLength<precision>(v, simd::Dot4(v, v)));
+#else
+		float squared = MagnitudeSquared();
+		if constexpr(precision == Precision::Exact){
+			return squared > 0 ? *this / std::sqrt(squared) : *this;
+		}
+		else{
+			return squared > 0 ? *this * InverseSqrt<precision>(squared) : *this;
+		}
+#endif
+	}
+
+	Vector4 Lerp(Vector4 const& to, float t) const noexcept
+	{
+#if MATH_SIMD_SSE
+		return Vector4(simd::Lerp(Load(), to.Load(), _mm_set1_ps(t)));
+#else
+		return *this + (to - *this) * t;
+#endif
+	}
+
+	/* UTILITY FUNCTIONS */
+
+	//return address of first element. useful for uploading to GPU
+	constexpr float* data_ptr() noexcept { return &x; }
+	constexpr const float* data_ptr() const noexcept { return &x; }
+
+	friend std::ostream& operator<<(std::ostream &strm, const Vector4 &v) {
+		return strm << "[" << v.x << ", " << v.y << ", " << v.z << ", " << v.w << "]";
+	}
+
+	std::string to_string() const {
+		return std::string("[") + std::to_string(x) + ","+ std::to_string(y) + ","+ std::to_string(z) + ","+ std::to_string(w) + "]";
+	}
+
+	private:
+
+#if MATH_SIMD_SSE
+	//alignas(16) above is what makes the aligned load and store safe
+	explicit Vector4(__m128 v) noexcept { _mm_store_ps(&x, v); }
+	__m128 Load() const noexcept { return _mm_load_ps(&x); }
+#endif
+};
+
+static_assert(sizeof(Vector4) == 16 && alignof(Vector4) == 16, "Vector4 must fill exactly one SSE register");
+
+//free standing functions
+
+inline Vector4 operator*(float scale, Vector4 const& v) noexcept { return v * scale; }
+
+inline float Dot(Vector4 const& left, Vector4 const& right) noexcept { return left.Dot(right); }
+inline float Distance(Vector4 const& left, Vector4 const& right) noexcept { return (right - left).Magnitude(); }
+inline Vector4 Lerp(Vector4 const& from, Vector4 const& to, float t) noexcept { return from.Lerp(to, t); }
+
+}
@@ -0,0 +1,646 @@
+/*
+    -- Math Benchmarks --
+
+    Measures the SIMD backed math types against straightforward scalar code, the kind anyone
+    would write first. Build with optimizations on, otherwise the numbers say nothing, and try
+    it with and without -march=native to see what AVX and FMA add:
+
+        g++ -O2 -std=c++17 -pthread benchmark.cpp -o benchmark
+        g++ -O2 -std=c++17 -pthread -march=native benchmark.cpp -o benchmark
+        ./benchmark            //everything
+        ./benchmark matrix     //just one workload
+
+    Workloads:
+        matrix     - Matrix4x4 multiply, transforming points, affine and rigid inverses, TRS
+        quaternion - Quaternion multiply, rotating vectors, slerp and nlerp
+        expression - a long expression over whole arrays: a plain Vector3 loop, one Vector3SoA
+                     kernel per operator, and the same written as a Vector3SoA expression
+        batch      - transforming arrays of points and directions by one matrix: a scalar loop
+                     against TransformPoints and friends, on 1 and on all threads, in place
+                     and with streaming stores. One op is one point, so Mops/s is million points/s
+        fastmath   - FastSin, FastCos, FastAtan2 and FastExp against the std functions, and
+                     normalizing at every Precision. First it measures the largest errors and
+                     checks them against the ones FastMath.h promises, the exit code is 1 if
+                     any is over
+
+    Most tests run over an array small enough to stay in the cache, so they measure the math
+    and not memory, and report nanoseconds per operation and millions of operations per second.
+
+    Don't be surprised when the scalar "transform point" wins: one matrix over a whole array of
+    points is a loop the compiler vectorizes by itself, 4 or 8 points at a time, while
+    TransformPoint does one point per call. The SIMD types pay off for one-off math on single
+    objects. For big arrays of points keep them in a Vector3SoA.
+*/
+
+#include <stdio.h>
+#include <string.h>
+
+#include <chrono>
+#include <cmath>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "BatchTransform.h"
+#include "FastMath.h"
+#include "Matrix4x4.h"
+#include "Quaternion.h"
+#include "Vector3.h"
+#include "Vector3SoA.h"
+
+using namespace math;
+
+/* HELPERS */
+
+using Clock = std::chrono::steady_clock;
+
+double SecondsSince(Clock::time_point start){
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+void Report(const char* name, size_t total_ops, double seconds){
+    printf("  %-28s %8.2f ns/op  %9.2f Mops/s\n", name, seconds * 1e9 / total_ops, total_ops / seconds / 1e6);
+}
+
+// Runs work() once and returns the wall time
+template<typename Func>
+double Time(Func&& work){
+    Clock::time_point start = Clock::now();
+    work();
+    return SecondsSince(start);
+}
+
+//keeps the compiler from throwing away results we never read
+volatile float sink;
+void DoNotOptimize(float value){
+    sink = value;
+}
+
+const size_t batch = 1024; //items per pass, a few tens of KB
+const size_t passes = 4096;
+
+std::mt19937 rng(1);
+float Random(float low, float high){
+    return std::uniform_real_distribution<float>(low, high)(rng);
+}
+Vector3 RandomVector3(){
+    return Vector3(Random(-10, 10), Random(-10, 10), Random(-10, 10));
+}
+Quaternion RandomRotation(){
+    Vector3 axis = Vector3(Random(-1, 1), Random(-1, 1), Random(-1, 1)).Normal();
+    if(axis == Vector3{}) axis = VECTOR3_UP;
+    return Quaternion::FromAxisAngle(axis, Random(-3.14f, 3.14f));
+}
+
+/* SCALAR REFERENCE */
+
+// What a first version of the math would look like: plain arrays and loops, no SIMD
+namespace scalar {
+
+struct Matrix {
+    float m[16]; //column-major like Matrix4x4, m[column * 4 + row]
+};
+
+Matrix FromMatrix4x4(Matrix4x4 const& source){
+    Matrix result;
+    memcpy(result.m, source.data_ptr(), sizeof(result.m));
+    return result;
+}
+
+Matrix Multiply(Matrix const& a, Matrix const& b){
+    Matrix result;
+    for(int column = 0; column < 4; column++){
+        for(int row = 0; row < 4; row++){
+            float sum = 0;
+            for(int k = 0; k < 4; k++){
+                sum += a.m[k * 4 + row] * b.m[column * 4 + k];
+            }
+            result.m[column * 4 + row] = sum;
+        }
+    }
+    return result;
+}
+
+Vector3 TransformPoint(Matrix const& a, Vector3 const& p){
+    return Vector3(a.m[0] * p.x + a.m[4] * p.y + a.m[8] * p.z + a.m[12],
+                   a.m[1] * p.x + a.m[5] * p.y + a.m[9] * p.z + a.m[13],
+                   a.m[2] * p.x + a.m[6] * p.y + a.m[10] * p.z + a.m[14]);
+}
+
+// The usual general 4x4 inverse by cofactors, what gets used when nobody knows the matrix is affine
+Matrix Inverse(Matrix const& a){
+    const float* m = a.m;
+    float inv[16];
+    inv[0] = m[5] * m[10] * m[15] - m[5] * m[11] * m[14] - m[9] * m[6] * m[15] + m[9] * m[7] * m[14] + m[13] * m[6] * m[11] - m[13] * m[7] * m[10];
+    inv[4] = -m[4] * m[10] * m[15] + m[4] * m[11] * m[14] + m[8] * m[6] * m[15] - m[8] * m[7] * m[14] - m[12] * m[6] * m[11] + m[12] * m[7] * m[10];
+    inv[8] = m[4] * m[9] * m[15] - m[4] * m[11] * m[13] - m[8] * m[5] * m[15] + m[8] * m[7] * m[13] + m[12] * m[5] * m[11] - m[12] * m[7] * m[9];
+    inv[12] = -m[4] * m[9] * m[14] + m[4] * m[10] * m[13] + m[8] * m[5] * m[14] - m[8] * m[6] * m[13] - m[12] * m[5] * m[10] + m[12] * m[6] * m[9];
+    inv[1] = -m[1] * m[10] * m[15] + m[1] * m[11] * m[14] + m[9] * m[2] * m[15] - m[9] * m[3] * m[14] - m[13] * m[2] * m[11] + m[13] * m[3] * m[10];
+    inv[5] = m[0] * m[10] * m[15] - m[0] * m[11] * m[14] - m[8] * m[2] * m[15] + m[8] * m[3] * m[14] + m[12] * m[2] * m[11] - m[12] * m[3] * m[10];
+    inv[9] = -m[0] * m[9] * m[15] + m[0] * m[11] * m[13] + m[8] * m[1] * m[15] - m[8] * m[3] * m[13] - m[12] * m[1] * m[11] + m[12] * m[3] * m[9];
+    inv[13] = m[0] * m[9] * m[14] - m[0] * m[10] * m[13] - m[8] * m[1] * m[14] + m[8] * m[2] * m[13] + m[12] * m[1] * m[10] - m[12] * m[2] * m[9];
+    inv[2] = m[1] * m[6] * m[15] - m[1] * m[7] * m[14] - m[5] * m[2] * m[15] + m[5] * m[3] * m[14] + m[13] * m[2] * m[7] - m[13] * m[3] * m[6];
+    inv[6] = -m[0] * m[6] * m[15] + m[0] * m[7] * m[14] + m[4] * m[2] * m[15] - m[4] * m[3] * m[14] - m[12] * m[2] * m[7] + m[12] * m[3] * m[6];
+    inv[10] = m[0] * m[5] * m[15] - m[0] * m[7] * m[13] - m[4] * m[1] * m[15] + m[4] * m[3] * m[13] + m[12] * m[1] * m[7] - m[12] * m[3] * m[5];
+    inv[14] = -m[0] * m[5] * m[14] + m[0] * m[6] * m[13] + m[4] * m[1] * m[14] - m[4] * m[2] * m[13] - m[12] * m[1] * m[6] + m[12] * m[2] * m[5];
+    inv[3] = -m[1] * m[6] * m[11] + m[1] * m[7] * m[10] + m[5] * m[2] * m[11] - m[5] * m[3] * m[10] - m[9] * m[2] * m[7] + m[9] * m[3] * m[6];
+    inv[7] = m[0] * m[6] * m[11] - m[0] * m[7] * m[10] - m[4] * m[2] * m[11] + m[4] * m[3] * m[10] + m[8] * m[2] * m[7] - m[8] * m[3] * m[6];
+    inv[11] = -m[0] * m[5] * m[11] + m[0] * m[7] * m[9] + m[4] * m[1] * m[11] - m[4] * m[3] * m[9] - m[8] * m[1] * m[7] + m[8] * m[3] * m[5];
+    inv[15] = m[0] * m[5] * m[10] - m[0] * m[6] * m[9] - m[4] * m[1] * m[10] + m[4] * m[2] * m[9] + m[8] * m[1] * m[6] - m[8] * m[2] * m[5];
+    float determinant = m[0] * inv[0] + m[1] * inv[4] + m[2] * inv[8] + m[3] * inv[12];
+    Matrix result;
+    for(int i = 0; i < 16; i++){
+        result.m[i] = inv[i] / determinant;
+    }
+    return result;
+}
+
+struct Quat {
+    float x, y, z, w;
+};
+
+Quat Multiply(Quat const& a, Quat const& b){
+    return Quat{a.w * b.x + a.x * b.w + a.y * b.z - a.z * b.y,
+                a.w * b.y - a.x * b.z + a.y * b.w + a.z * b.x,
+                a.w * b.z + a.x * b.y - a.y * b.x + a.z * b.w,
+                a.w * b.w - a.x * b.x - a.y * b.y - a.z * b.z};
+}
+
+// q * (v, 0) * conjugate(q), written out the long way
+Vector3 Rotate(Quat const& q, Vector3 const& v){
+    Quat p{v.x, v.y, v.z, 0};
+    Quat conjugate{-q.x, -q.y, -q.z, q.w};
+    Quat r = Multiply(Multiply(q, p), conjugate);
+    return Vector3(r.x, r.y, r.z);
+}
+
+Quat Slerp(Quat const& a, Quat b, float t){
+    float cosine = a.x * b.x + a.y * b.y + a.z * b.z + a.w * b.w;
+    if(cosine < 0){
+        cosine = -cosine;
+        b = Quat{-b.x, -b.y, -b.z, -b.w};
+    }
+    float wa = 1.0f - t, wb = t;
+    if(cosine < 0.9995f){
+        float angle = std::acos(cosine);
+        wa = std::sin((1.0f - t) * angle) / std::sin(angle);
+        wb = std::sin(t * angle) / std::sin(angle);
+    }
+    Quat r{a.x * wa + b.x * wb, a.y * wa + b.y * wb, a.z * wa + b.z * wb, a.w * wa + b.w * wb};
+    float length = std::sqrt(r.x * r.x + r.y * r.y + r.z * r.z + r.w * r.w);
+    return Quat{r.x / length, r.y / length, r.z / length, r.w / length};
+}
+
+} // namespace scalar
+
+/* MATRICES */
+
+void BenchmarkMatrix(){
+    printf("Matrix4x4, %zu matrices, %zu passes\n", batch, passes);
+    size_t total_ops = batch * passes;
+
+    std::vector<Matrix4x4> a(batch), b(batch), out(batch);
+    std::vector<scalar::Matrix> sa(batch), sb(batch), sout(batch);
+    std::vector<Vector3> translations(batch), scales(batch), points(batch), moved(batch);
+    std::vector<Quaternion> rotations(batch);
+    for(size_t i = 0; i < batch; i++){
+        translations[i] = RandomVector3();
+        rotations[i] = RandomRotation();
+        scales[i] = Vector3(Random(0.5f, 2), Random(0.5f, 2), Random(0.5f, 2));
+        points[i] = RandomVector3();
+        a[i] = Matrix4x4::TRS(translations[i], rotations[i], scales[i]);
+        b[i] = Matrix4x4::TRS(RandomVector3(), RandomRotation(), Vector3(1, 1, 1));
+        sa[i] = scalar::FromMatrix4x4(a[i]);
+        sb[i] = scalar::FromMatrix4x4(b[i]);
+    }
+
+    double seconds = Time([&]{
+        for(size_t pass = 0; pass < passes; pass++){
+            for(size_t i = 0; i < batch; i++) sout[i] = scalar::Multiply(sa[i], sb[i]);
+            DoNotOptimize(sout[pass % batch].m[pass % 16]);
+        }
+    });
+    Report("matrix * matrix, scalar", total_ops, seconds);
+    seconds = Time([&]{
+        for(size_t pass = 0; pass < passes; pass++){
+            for(size_t i = 0; i < batch; i++) out[i] = a[i] * b[i];
+            DoNotOptimize(out[pass % batch].data_ptr()[pass % 16]);
+        }
+    });
+    Report("matrix * matrix, Matrix4x4", total_ops, seconds);
+
+    seconds = Time([&]{
+        for(size_t pass = 0; pass < passes; pass++){
+            for(size_t i = 0; i < batch; i++) moved[i] = scalar::TransformPoint(sa[pass % batch], points[i]);
+            DoNotOptimize(moved[pass % batch].x);
+        }
+    });
+    Report("transform point, scalar", total_ops, seconds);
+    seconds = Time([&]{
+        for(size_t pass = 0; pass < passes; pass++){
+            Matrix4x4 const& m = a[pass % batch];
+            for(size_t i = 0; i < batch; i++) moved[i] = m.TransformPoint(points[i]);
+            DoNotOptimize(moved[pass % batch].x);
+        }
+    });
+    Report("transform point, Matrix4x4", total_ops, seconds);
+
+    seconds = Time([&]{
+        for(size_t pass = 0; pass < passes; pass++){
+            for(size_t i = 0; i < batch; i++) sout[i] = scalar::Inverse(sa[i]);
+            DoNotOptimize(sout[pass % batch].m[pass % 16]);
+        }
+    });
+    Report("general inverse, scalar", total_ops, seconds);
+    seconds = Time([&]{
+        for(size_t pass = 0; pass < passes; pass++){
+            for(size_t i = 0; i < batch; i++) out[i] = a[i].InverseAffine();
+            DoNotOptimize(out[pass % batch].data_ptr()[pass % 16]);
+        }
+    });
+    Report("InverseAffine", total_ops, seconds);
+    seconds = Time([&]{
+        for(size_t pass = 0; pass < passes; pass++){
+            for(size_t i = 0; i < batch; i++) out[i] = b[i].InverseRigid();
+            DoNotOptimize(out[pass % batch].data_ptr()[pass % 16]);
+        }
+    });
+    Report("InverseRigid", total_ops, seconds);
+
+    seconds = Time([&]{
+        for(size_t pass = 0; pass < passes; pass++){
+            for(size_t i = 0; i < batch; i++){
+                out[i] = Matrix4x4::Translation(translations[i]) * Matrix4x4::Rotation(rotations[i]) * Matrix4x4::Scale(scales[i]);
+            }
+            DoNotOptimize(out[pass % batch].data_ptr()[pass % 16]);
+        }
+    });
+    Report("T * R * S multiplied out", total_ops, seconds);
+    seconds = Time([&]{
+        for(size_t pass = 0; pass < passes; pass++){
+            for(size_t i = 0; i < batch; i++) out[i] = Matrix4x4::TRS(translations[i], rotations[i], scales[i]);
+            DoNotOptimize(out[pass % batch].data_ptr()[pass % 16]);
+        }
+    });
+    Report("TRS", total_ops, seconds);
+    seconds = Time([&]{
+        Vector3 t, s;
+        Quaternion r;
+        for(size_t pass = 0; pass < passes; pass++){
+            for(size_t i = 0; i < batch; i++) a[i].Decompose(t, r, s);
+            DoNotOptimize(r.w + t.x + s.y);
+        }
+    });
+    Report("Decompose", total_ops, seconds);
+}
+
+/* QUATERNIONS */
+
+void BenchmarkQuaternion(){
+    printf("Quaternion, %zu rotations, %zu passes\n", batch, passes);
+    size_t total_ops = batch * passes;
+
+    std::vector<Quaternion> a(batch), b(batch), out(batch);
+    std::vector<scalar::Quat> sa(batch), sb(batch), sout(batch);
+    std::vector<Vector3> vectors(batch), rotated(batch);
+    for(size_t i = 0; i < batch; i++){
+        a[i] = RandomRotation();
+        b[i] = RandomRotation();
+        sa[i] = scalar::Quat{a[i].x, a[i].y, a[i].z, a[i].w};
+        sb[i] = scalar::Quat{b[i].x, b[i].y, b[i].z, b[i].w};
+        vectors[i] = RandomVector3();
+    }
+
+    double seconds = Time([&]{
+        for(size_t pass = 0; pass < passes; pass++){
+            for(size_t i = 0; i < batch; i++) sout[i] = scalar::Multiply(sa[i], sb[i]);
+            DoNotOptimize(sout[pass % batch].w);
+        }
+    });
+    Report("multiply, scalar", total_ops, seconds);
+    seconds = Time([&]{
+        for(size_t pass = 0; pass < passes; pass++){
+            for(size_t i = 0; i < batch; i++) out[i] = a[i] * b[i];
+            DoNotOptimize(out[pass % batch].w);
+        }
+    });
+    Report("multiply, Quaternion", total_ops, seconds);
+
+    seconds = Time([&]{
+        for(size_t pass = 0; pass < passes; pass++){
+            scalar::Quat const& q = sa[pass % batch];
+            for(size_t i = 0; i < batch; i++) rotated[i] = scalar::Rotate(q, vectors[i]);
+            DoNotOptimize(rotated[pass % batch].x);
+        }
+    });
+    Report("rotate vector, q * v * q'", total_ops, seconds);
+    seconds = Time([&]{
+        for(size_t pass = 0; pass < passes; pass++){
+            Quaternion const& q = a[pass % batch];
+            for(size_t i = 0; i < batch; i++) rotated[i] = q.Rotate(vectors[i]);
+            DoNotOptimize(rotated[pass % batch].x);
+        }
+    });
+    Report("rotate vector, Quaternion", total_ops, seconds);
+
+    float t = 0.3f;
+    seconds = Time([&]{
+        for(size_t pass = 0; pass < passes; pass++){
+            for(size_t i = 0; i < batch; i++) sout[i] = scalar::Slerp(sa[i], sb[i], t);
+            DoNotOptimize(sout[pass % batch].w);
+        }
+    });
+    Report("slerp, scalar", total_ops, seconds);
+    seconds = Time([&]{
+        for(size_t pass = 0; pass < passes; pass++){
+            for(size_t i = 0; i < batch; i++) out[i] = Slerp(a[i], b[i], t);
+            DoNotOptimize(out[pass % batch].w);
+        }
+    });
+    Report("Slerp", total_ops, seconds);
+    seconds = Time([&]{
+        for(size_t pass = 0; pass < passes; pass++){
+            for(size_t i = 0; i < batch; i++) out[i] = Nlerp(a[i], b[i], t);
+            DoNotOptimize(out[pass % batch].w);
+        }
+    });
+    Report("Nlerp", total_ops, seconds);
+}
+
+/* EXPRESSIONS */
+
+// out = (a + b) * 0.5 - c + d * dt, on arrays that fit in the cache and on ones much bigger
+void BenchmarkExpression(size_t count, size_t repeats){
+    printf("Expression, %zu vectors, %zu passes\n", count, repeats);
+    size_t total_ops = count * repeats;
+    const float dt = 0.016f;
+
+    std::vector<Vector3> a(count), b(count), c(count), d(count), out(count);
+    for(size_t i = 0; i < count; i++){
+        a[i] = RandomVector3();
+        b[i] = RandomVector3();
+        c[i] = RandomVector3();
+        d[i] = RandomVector3();
+    }
+    Vector3SoA sa(a.data(), count), sb(b.data(), count), sc(c.data(), count), sd(d.data(), count);
+    Vector3SoA sout(count), temporary(count);
+
+    double seconds = Time([&]{
+        for(size_t pass = 0; pass < repeats; pass++){
+            for(size_t i = 0; i < count; i++) out[i] = (a[i] + b[i]) * 0.5f - c[i] + d[i] * dt;
+            DoNotOptimize(out[pass % count].x);
+        }
+    });
+    Report("Vector3 loop", total_ops, seconds);
+
+    //what the kernels alone allow, every step goes over all the arrays again
+    seconds = Time([&]{
+        for(size_t pass = 0; pass < repeats; pass++){
+            Add(sa, sb, temporary);
+            Scale(temporary, 0.5f, temporary);
+            Subtract(temporary, sc, temporary);
+            MultiplyAdd(sd, dt, temporary, sout);
+            DoNotOptimize(sout.X()[pass % count]);
+        }
+    });
+    Report("Vector3SoA, kernel per step", total_ops, seconds);
+
+    seconds = Time([&]{
+        for(size_t pass = 0; pass < repeats; pass++){
+            sout = (sa + sb) * 0.5f - sc + sd * dt;
+            DoNotOptimize(sout.X()[pass % count]);
+        }
+    });
+    Report("Vector3SoA expression", total_ops, seconds);
+
+    //a longer one, the kernels don't have a component wise multiply or divide for it
+    seconds = Time([&]{
+        for(size_t pass = 0; pass < repeats; pass++){
+            for(size_t i = 0; i < count; i++) out[i] = a[i] * b[i] - a[i] / b[i] + c[i] * d[i] + VECTOR3_UP;
+            DoNotOptimize(out[pass % count].x);
+        }
+    });
+    Report("long, Vector3 loop", total_ops, seconds);
+    seconds = Time([&]{
+        for(size_t pass = 0; pass < repeats; pass++){
+            sout = sa * sb - sa / sb + sc * sd + VECTOR3_UP;
+            DoNotOptimize(sout.X()[pass % count]);
+        }
+    });
+    Report("long, Vector3SoA expression", total_ops, seconds);
+}
+
+/* BATCH TRANSFORMS */
+
+void BenchmarkBatch(size_t count, size_t repeats){
+    unsigned cores = std::max(1u, std::thread::hardware_concurrency());
+    printf("Batch transform, %zu points, %zu passes, %u threads\n", count, repeats, cores);
+    size_t total_ops = count * repeats;
+
+    Matrix4x4 m = Matrix4x4::TRS(RandomVector3(), RandomRotation(), Vector3(1, 2, 3));
+    scalar::Matrix sm = scalar::FromMatrix4x4(m);
+    std::vector<Vector3> in(count), out(count);
+    for(Vector3& p : in) p = RandomVector3();
+
+    //every variant is handed the same work: read in, write out
+    auto Run = [&](const char* name, auto&& transform){
+        double seconds = Time([&]{
+            for(size_t pass = 0; pass < repeats; pass++){
+                transform();
+                DoNotOptimize(out[pass % count].x);
+            }
+        });
+        Report(name, total_ops, seconds);
+    };
+
+    Run("scalar loop", [&]{
+        scalar::Matrix local = sm; //a copy the stores to out can't alias, so the compiler may vectorize
+        for(size_t i = 0; i < count; i++) out[i] = scalar::TransformPoint(local, in[i]);
+    });
+    Run("Matrix4x4::TransformPoint", [&]{ for(size_t i = 0; i < count; i++) out[i] = m.TransformPoint(in[i]); });
+    Run("TransformPoints, 1 thread", [&]{ TransformPoints(m, in.data(), out.data(), count); });
+    Run("TransformPoints, all", [&]{ TransformPoints(m, in.data(), out.data(), count, cores); });
+    Run("TransformDirections, all", [&]{ TransformDirections(m, in.data(), out.data(), count, cores); });
+    Run("streaming, 1 thread", [&]{ TransformPointsStreaming(m, in.data(), out.data(), count); });
+    Run("streaming, all", [&]{ TransformPointsStreaming(m, in.data(), out.data(), count, cores); });
+    //moves the points further every pass, which is fine for timing
+    Run("in place, all", [&]{ TransformDirectionsInPlace(m, out.data(), count, cores); });
+}
+
+/* FAST MATH */
+
+//largest error over a dense sweep of the range, against the double precision std function
+template<typename Fast, typename Exact>
+double LargestError(float low, float high, size_t steps, bool relative, Fast&& fast, Exact&& exact){
+    double largest = 0;
+    for(size_t i = 0; i <= steps; i++){
+        float x = low + (high - low) * (float(i) / steps);
+        double expected = exact(x);
+        double error = std::fabs(fast(x) - expected);
+        largest = std::max(largest, relative ? error / std::fabs(expected) : error);
+    }
+    return largest;
+}
+
+//the same for simd::Lanes, lane_count inputs at a time
+template<typename Fast, typename Exact>
+double LargestErrorLanes(float low, float high, size_t steps, bool relative, Fast&& fast, Exact&& exact){
+    float in[simd::lane_count], out[simd::lane_count];
+    double largest = 0;
+    for(size_t i = 0; i <= steps; i += simd::lane_count){
+        for(size_t lane = 0; lane < simd::lane_count; lane++){
+            in[lane] = low + (high - low) * (float(std::min(i + lane, steps)) / steps);
+        }
+        simd::StoreLanesUnaligned(out, fast(simd::LoadLanesUnaligned(in)));
+        for(size_t lane = 0; lane < simd::lane_count; lane++){
+            double expected = exact(in[lane]);
+            double error = std::fabs(out[lane] - expected);
+            largest = std::max(largest, relative ? error / std::fabs(expected) : error);
+        }
+    }
+    return largest;
+}
+
+//prints the error and says whether it is within the documented bound
+bool CheckError(const char* name, double error, double bound){
+    bool ok = error <= bound;
+    printf("  %-28s %10.3g   bound %8.3g  %s\n", name, error, bound, ok ? "ok" : "OVER");
+    return ok;
+}
+
+bool BenchmarkFastMath(){
+    printf("Fast math, largest errors\n");
+    const size_t steps = 1 << 22;
+    bool ok = true;
+#if MATH_SIMD_SSE
+    const double refined_bound = 3e-7, estimate_bound = 3.7e-4;
+#else
+    const double refined_bound = 5e-6, estimate_bound = 1.8e-3;
+#endif
+    auto exact_inverse_sqrt = [](float x){ return 1 / std::sqrt(double(x)); };
+    ok &= CheckError("InverseSqrt Refined", LargestError(1e-6f, 1e6f, steps, true,
+        [](float x){ return InverseSqrt<Precision::Refined>(x); }, exact_inverse_sqrt), refined_bound);
+    ok &= CheckError("InverseSqrt Refined, small", LargestError(1e-30f, 1e-20f, steps, true,
+        [](float x){ return InverseSqrt<Precision::Refined>(x); }, exact_inverse_sqrt), refined_bound);
+    ok &= CheckError("InverseSqrt Estimate", LargestError(1e-6f, 1e6f, steps, true,
+        [](float x){ return InverseSqrt<Precision::Estimate>(x); }, exact_inverse_sqrt), estimate_bound);
+    //denormals are clamped to FLT_MIN, counts the results that still came out inf or NaN
+    double not_finite = 0;
+    for(float x = FLT_MIN; x > 0; x /= 2){
+        not_finite += !std::isfinite(InverseSqrt<Precision::Refined>(x)) + !std::isfinite(InverseSqrt<Precision::Estimate>(x));
+        float lanes[simd::lane_count];
+        simd::StoreLanesUnaligned(lanes, InverseSqrt<Precision::Refined>(simd::SplatLanes(x)));
+        not_finite += !std::isfinite(lanes[0]);
+    }
+    ok &= CheckError("InverseSqrt, denormals", not_finite, 0);
+
+    auto exact_sin = [](float x){ return std::sin(double(x)); };
+    auto exact_cos = [](float x){ return std::cos(double(x)); };
+    ok &= CheckError("FastSin, |x| <= 4", LargestError(-4, 4, steps, false, [](float x){ return FastSin(x); }, exact_sin), 1.2e-6);
+    ok &= CheckError("FastSin, |x| <= 100000", LargestError(-1e5f, 1e5f, steps, false, [](float x){ return FastSin(x); }, exact_sin), 1.2e-6);
+    ok &= CheckError("FastCos, |x| <= 100000", LargestError(-1e5f, 1e5f, steps, false, [](float x){ return FastCos(x); }, exact_cos), 1.2e-6);
+    ok &= CheckError("FastSin, Lanes", LargestErrorLanes(-1e5f, 1e5f, steps, false, [](simd::Lanes x){ return FastSin(x); }, exact_sin), 1.2e-6);
+    ok &= CheckError("FastCos, Lanes", LargestErrorLanes(-1e5f, 1e5f, steps, false, [](simd::Lanes x){ return FastCos(x); }, exact_cos), 1.2e-6);
+
+    //around the circle, at a few distances from the origin
+    double atan_error = 0;
+    for(float radius : {1e-3f, 1.0f, 1e4f}){
+        atan_error = std::max(atan_error, LargestError(-3.2f, 3.2f, steps / 4, false,
+            [radius](float a){ return FastAtan2(radius * std::sin(a), radius * std::cos(a)); },
+            [radius](float a){ return std::atan2(double(radius * std::sin(a)), double(radius * std::cos(a))); }));
+    }
+    ok &= CheckError("FastAtan2", atan_error, 6e-7);
+    ok &= CheckError("FastAtan2, Lanes", LargestErrorLanes(-1e3f, 1e3f, steps, false,
+        [](simd::Lanes y){ return FastAtan2(y, simd::SplatLanes(1.0f)); },
+        [](float y){ return std::atan2(double(y), 1.0); }), 6e-7);
+
+    auto exact_exp = [](float x){ return std::exp(double(x)); };
+    ok &= CheckError("FastExp", LargestError(-87.3f, 88, steps, true, [](float x){ return FastExp(x); }, exact_exp), 3e-7);
+    ok &= CheckError("FastExp, Lanes", LargestErrorLanes(-87.3f, 88, steps, true,
+        [](simd::Lanes x){ return FastExp(x); }, exact_exp), 3e-7);
+
+    printf("Fast math, %zu values, %zu passes\n", batch, passes);
+    size_t total_ops = batch * passes;
+    std::vector<float> angles(batch), xs(batch), ys(batch), out(batch);
+    for(size_t i = 0; i < batch; i++){
+        angles[i] = Random(-100, 100);
+        xs[i] = Random(-10, 10);
+        ys[i] = Random(-10, 10);
+    }
+
+    auto Run = [&](const char* name, auto&& function){
+        double seconds = Time([&]{
+            for(size_t pass = 0; pass < passes; pass++){
+                for(size_t i = 0; i < batch; i++) out[i] = function(i);
+                DoNotOptimize(out[pass % batch]);
+            }
+        });
+        Report(name, total_ops, seconds);
+    };
+    //whole registers at a time, the way a batch kernel uses them
+    auto RunLanes = [&](const char* name, auto&& function){
+        double seconds = Time([&]{
+            for(size_t pass = 0; pass < passes; pass++){
+                for(size_t i = 0; i < batch; i += simd::lane_count) simd::StoreLanesUnaligned(&out[i], function(i));
+                DoNotOptimize(out[pass % batch]);
+            }
+        });
+        Report(name, total_ops, seconds);
+    };
+
+    Run("std::sin", [&](size_t i){ return std::sin(angles[i]); });
+    Run("FastSin", [&](size_t i){ return FastSin(angles[i]); });
+    RunLanes("FastSin, Lanes", [&](size_t i){ return FastSin(simd::LoadLanesUnaligned(&angles[i])); });
+    Run("std::cos", [&](size_t i){ return std::cos(angles[i]); });
+    Run("FastCos", [&](size_t i){ return FastCos(angles[i]); });
+    RunLanes("FastCos, Lanes", [&](size_t i){ return FastCos(simd::LoadLanesUnaligned(&angles[i])); });
+    Run("std::atan2", [&](size_t i){ return std::atan2(ys[i], xs[i]); });
+    Run("FastAtan2", [&](size_t i){ return FastAtan2(ys[i], xs[i]); });
+    RunLanes("FastAtan2, Lanes", [&](size_t i){ return FastAtan2(simd::LoadLanesUnaligned(&ys[i]), simd::LoadLanesUnaligned(&xs[i])); });
+    Run("std::exp", [&](size_t i){ return std::exp(xs[i]); });
+    Run("FastExp", [&](size_t i){ return FastExp(xs[i]); });
+    RunLanes("FastExp, Lanes", [&](size_t i){ return FastExp(simd::LoadLanesUnaligned(&xs[i])); });
+
+    printf("Normalize, %zu vectors, %zu passes\n", batch, passes);
+    std::vector<Vector3> vectors(batch), normals(batch);
+    for(Vector3& v : vectors) v = RandomVector3();
+    Vector3SoA soa(vectors.data(), batch), soa_out(batch);
+
+    auto RunNormal = [&](const char* name, auto&& normalize){
+        double seconds = Time([&]{
+            for(size_t pass = 0; pass < passes; pass++){
+                normalize();
+                DoNotOptimize(normals[pass % batch].x + soa_out.X()[pass % batch]);
+            }
+        });
+        Report(name, total_ops, seconds);
+    };
+    RunNormal("Vector3 Exact", [&]{ for(size_t i = 0; i < batch; i++) normals[i] = vectors[i].Normal(); });
+    RunNormal("Vector3 Refined", [&]{ for(size_t i = 0; i < batch; i++) normals[i] = Normal<Precision::Refined>(vectors[i]); });
+    RunNormal("Vector3 Estimate", [&]{ for(size_t i = 0; i < batch; i++) normals[i] = Normal<Precision::Estimate>(vectors[i]); });
+    RunNormal("Vector3SoA Exact", [&]{ Normalize(soa, soa_out); });
+    RunNormal("Vector3SoA Refined", [&]{ Normalize<Precision::Refined>(soa, soa_out); });
+    RunNormal("Vector3SoA Estimate", [&]{ Normalize<Precision::Estimate>(soa, soa_out); });
+
+    return ok;
+}
+
+int main(int argc, char** argv){
+    const char* only = argc > 1 ? argv[1] : nullptr;
+    auto Run = [&](const char* name){ return only == nullptr || strcmp(only, name) == 0; };
+
+    if(Run("matrix")) BenchmarkMatrix();
+    if(Run("quaternion")) BenchmarkQuaternion();
+    if(Run("expression")){
+        BenchmarkExpression(4096, 4096);    //3 x 16KB per array, in the cache
+        BenchmarkExpression(1 << 22, 8);    //3 x 16MB per array, out in memory
+    }
+    if(Run("batch")){
+        BenchmarkBatch(16 * 1024, 2048);    //2 x 192KB, in the cache, too small for threads
+        BenchmarkBatch(1 << 22, 16);        //2 x 48MB, out in memory
+    }
+    if(Run("fastmath") && !BenchmarkFastMath()){
+        return 1;
+    }
+    return 0;
+}
@@ -1,8 +1,19 @@
 
-
+#include <algorithm>
+#include <cassert>
+#include <cmath>
 #include <iostream>
+#include <stdexcept>
+#include <vector>
 
+#include "BatchTransform.h"
+#include "FastMath.h"
+#include "Matrix4x4.h"
+#include "Quaternion.h"
 #include "Vector3.h"
+#include "Vector3A.h"
+#include "Vector3SoA.h"
+#include "Vector4.h"
 
 /*
 Example usage of our Vector class
@@ -12,7 +23,94 @@ Example usage of our Vector class
 
 void example_function_call(int count, float* pointer){ /* do fancy stuff*/}
 
-    
+//because Vector3 is constexpr the compiler can check the math for us, a wrong answer here
+//is a compile error instead of a bug found later. These double as examples of each operation.
+namespace vector3_checks {
+    using math::Vector3;
+
+    constexpr Vector3 a(1, 2, 3);
+    constexpr Vector3 b(4, 5, 6);
+
+    static_assert(a + b == Vector3(5, 7, 9), "addition");
+    static_assert(b - a == Vector3(3, 3, 3), "subtraction is left minus right");
+    static_assert(a * b == Vector3(4, 10, 18), "component wise multiplication");
+    static_assert(b / Vector3(2, 5, 3) == Vector3(2, 1, 2), "division is left divided by right");
+    static_assert(-a == Vector3(-1, -2, -3), "unary minus");
+    static_assert(a * 2.0f == 2.0f * a && a * 2.0f == Vector3(2, 4, 6), "scaling");
+    static_assert(b / 2.0f == Vector3(2, 2.5f, 3), "dividing by a scalar");
+    static_assert(a != b, "inequality");
+
+    static_assert(a.Dot(b) == 32 && math::Dot(a, b) == 32, "dot product");
+    static_assert(math::VECTOR3_RIGHT.Cross(math::VECTOR3_UP) == Vector3(0, 0, 1), "x cross y is z");
+    static_assert(Cross(a, b) == -Cross(b, a), "cross product flips with the order");
+    static_assert(Dot(Cross(a, b), a) == 0 && Dot(Cross(a, b), b) == 0, "cross product is at a right angle to both");
+    static_assert(Vector3(3, 4, 12).MagnitudeSquared() == 169, "squared length");
+
+    static_assert(Lerp(a, b, 0) == a && Lerp(a, b, 1) == b, "lerp ends");
+    static_assert(Lerp(a, b, 0.5f) == Vector3(2.5f, 3.5f, 4.5f), "lerp halfway");
+
+    static_assert(Projection(Vector3(3, 4, 0), math::VECTOR3_RIGHT) == Vector3(3, 0, 0), "projection");
+    static_assert(Perpendicular(Vector3(3, 4, 0), math::VECTOR3_RIGHT) == Vector3(0, 4, 0), "perpendicular");
+    static_assert(Projection(a, Vector3{}) == Vector3{}, "projecting onto nothing");
+
+    static_assert(math::VECTOR3_LEFT == -math::VECTOR3_RIGHT, "left is the opposite of right");
+    static_assert(math::VECTOR3_DOWN == -math::VECTOR3_UP, "down is the opposite of up");
+    static_assert(math::VECTOR3_BACKWARD == -math::VECTOR3_FORWARD, "backward is the opposite of forward");
+}
+
+//every batch transform against Matrix4x4::TransformPoint and TransformDirection, point by point.
+//out starts one Vector3 into its buffer, so the streaming versions can't count on it being
+//aligned, and nothing may be written in front of it
+bool BatchTransformsMatch(math::Matrix4x4 const& matrix, size_t count, unsigned thread_count){
+    using namespace math;
+    std::vector<Vector3> in(count), points(count), directions(count), buffer(count + 1);
+    for(size_t i = 0; i < count; i++){
+        in[i] = Vector3(i * 0.5f - 300, (i % 97) * 1.25f, 7 - (i % 13) * 0.75f);
+        points[i] = matrix.TransformPoint(in[i]);
+        directions[i] = matrix.TransformDirection(in[i]);
+    }
+    Vector3* out = buffer.data() + 1;
+    bool match = true;
+    auto Check = [&](std::vector<Vector3> const& expected){
+        for(size_t i = 0; i < count; i++){
+            match = match && Distance(out[i], expected[i]) <= 1e-5f * (1 + expected[i].Magnitude());
+        }
+        match = match && buffer[0] == Vector3();
+        std::fill(buffer.begin(), buffer.end(), Vector3());
+    };
+
+    TransformPoints(matrix, in.data(), out, count, thread_count);
+    Check(points);
+    TransformPointsStreaming(matrix, in.data(), out, count, thread_count);
+    Check(points);
+    std::copy(in.begin(), in.end(), out);
+    TransformPointsInPlace(matrix, out, count, thread_count);
+    Check(points);
+
+    TransformDirections(matrix, in.data(), out, count, thread_count);
+    Check(directions);
+    TransformDirectionsStreaming(matrix, in.data(), out, count, thread_count);
+    Check(directions);
+    std::copy(in.begin(), in.end(), out);
+    TransformDirectionsInPlace(matrix, out, count, thread_count);
+    Check(directions);
+    return match;
+}
+
+//the same to within tolerance, element by element
+bool MatricesClose(math::Matrix4x4 const& left, math::Matrix4x4 const& right, float tolerance = 1e-5f){
+    for(int r = 0; r < 4; r++){
+        for(int c = 0; c < 4; c++){
+            if(std::fabs(left(r, c) - right(r, c)) > tolerance) return false;
+        }
+    }
+    return true;
+}
+
+//q and -q are the same rotation
+bool SameRotation(math::Quaternion const& left, math::Quaternion const& right){
+    return std::fabs(std::fabs(Dot(left, right)) - 1) < 1e-5f;
+}
 
 int main(){
 
@@ -24,21 +122,110 @@ int main(){
     //why operator overloads are so nice (for math types)
     Vector3 c = a * b - a / b;
 
+    //sqrt isn't constexpr, so the functions using it are checked when the program runs instead
+    assert(Vector3(3, 4, 12).Magnitude() == 13);
+    assert(std::fabs(Vector3(1, 2, 3).Normal().Magnitude() - 1) < 1e-6f);
+    assert(Vector3{}.Normal() == Vector3{}); //a zero vector stays zero instead of turning into NaN
+    assert(Distance(Vector3(1, 1, 1), Vector3(4, 5, 1)) == 5);
+
+    //the SIMD backed types for math in hot loops, the packed Vector3 for storage
+    Vector3A side = Vector3A(b).Cross(Vector3A(VECTOR3_UP)).Normal();
+    Vector4 point(side, 1.0f); //w = 1, a point
+    assert(point.ToVector3() == side.ToVector3());
+    assert(std::fabs(side.Dot(Vector3A(VECTOR3_UP))) < 1e-6f);
+
+    //whole arrays at once, for particles and the like
+    Vector3 positions[] = {a, b, c};
+    Vector3 velocities[] = {VECTOR3_UP, VECTOR3_LEFT, VECTOR3_FORWARD};
+    Vector3SoA soa_positions(positions, 3);
+    Vector3SoA soa_velocities(velocities, 3);
+    bool same_size = MultiplyAdd(soa_velocities, 0.5f, soa_positions, soa_positions); //positions += velocities * 0.5
+    soa_positions.ToAoS(positions);
+    assert(same_size && positions[1] == b + VECTOR3_LEFT * 0.5f);
+    Vector3SoA too_short(positions, 2);
+    Vector3SoA untouched(soa_positions);
+    same_size = Add(soa_positions, too_short, untouched);
+    assert(!same_size && untouched.Get(2) == positions[2]);
+
+    //the same operators as Vector3, worked out in one pass over the arrays
+    Vector3SoA soa_c = soa_positions * soa_velocities - soa_positions / 2.0f;
+    assert(soa_c.Get(2) == positions[2] * VECTOR3_FORWARD - positions[2] / 2.0f);
+    soa_positions += soa_velocities * 0.5f;
+    bool threw = false;
+    try { soa_c = soa_positions * 2.0f + too_short; } catch(std::length_error const&) { threw = true; }
+    assert(threw && soa_c.Size() == 3);
+
+    //transforms: scale, then rotate, then move, and back again
+    Quaternion turn = Quaternion::FromAxisAngle(VECTOR3_UP, 1.5707964f); //90 degrees
+    Matrix4x4 world = Matrix4x4::TRS(Vector3(10, 0, 0), turn, Vector3(2, 2, 2));
+    Vector3 moved = world.TransformPoint(VECTOR3_RIGHT);
+    assert(Distance(moved, Vector3(10, 0, 0) + turn.Rotate(VECTOR3_RIGHT * 2)) < 1e-5f);
+    assert(Distance(world.InverseAffine().TransformPoint(moved), VECTOR3_RIGHT) < 1e-5f);
+    Quaternion halfway = Slerp(Quaternion::Identity(), turn, 0.5f); //45 degrees
+    assert(std::fabs(Dot(halfway * halfway, turn) - 1) < 1e-5f);      //twice 45 is 90
+    //-turn is the same rotation, both blends have to take the short way round to it
+    Quaternion flipped_turn = Quaternion(-turn.x, -turn.y, -turn.z, -turn.w);
+    assert(SameRotation(Nlerp(Quaternion::Identity(), flipped_turn, 0.5f), halfway));
+    assert(SameRotation(Slerp(Quaternion::Identity(), flipped_turn, 0.5f), halfway));
+
+    //the rotated axes give the rotation back, the half turns go through each branch of FromBasis
+    Quaternion rotations[] = {turn, Quaternion::FromAxisAngle(Vector3(1, 2, 3).Normal(), 0.7f),
+        Quaternion::FromAxisAngle(VECTOR3_RIGHT, 3.1f), Quaternion::FromAxisAngle(VECTOR3_UP, 3.1f),
+        Quaternion::FromAxisAngle(VECTOR3_FORWARD, 3.1f)};
+    for(Quaternion const& r : rotations){
+        assert(SameRotation(Quaternion::FromBasis(r.Rotate(VECTOR3_RIGHT), r.Rotate(VECTOR3_UP), r.Rotate(VECTOR3_FORWARD)), r));
+    }
+
+    //TRS, split up and put back together, gives the same matrix. A mirror comes back as a
+    //negative x scale
+    Quaternion tilt = rotations[1];
+    for(Vector3 scale : {Vector3(2, 3, 0.5f), Vector3(-2, 3, 0.5f), Vector3(2, -3, 0.5f)}){
+        Matrix4x4 original = Matrix4x4::TRS(Vector3(1, -2, 3), tilt, scale);
+        Vector3 t, s;
+        Quaternion r;
+        bool decomposed = original.Decompose(t, r, s);
+        assert(decomposed && MatricesClose(Matrix4x4::TRS(t, r, s), original));
+        assert(Distance(t, Vector3(1, -2, 3)) < 1e-5f && s.y > 0 && s.z > 0);
+    }
+    Vector3 flat_t, flat_s;
+    Quaternion flat_r;
+    assert(!Matrix4x4::TRS(Vector3(), tilt, Vector3(1, 0, 1)).Decompose(flat_t, flat_r, flat_s));
+
+    //a rigid transform times its inverse is no transform at all
+    Matrix4x4 rigid = Matrix4x4::TRS(Vector3(1, -2, 3), tilt, Vector3(1, 1, 1));
+    assert(MatricesClose(rigid * rigid.InverseRigid(), Matrix4x4::Identity()));
+    assert(MatricesClose(rigid.InverseRigid() * rigid, Matrix4x4::Identity()));
+
+    //one matrix over a whole array of points, add a thread count for big ones
+    Vector3 world_positions[3];
+    TransformPoints(world, positions, world_positions, 3);
+    assert(Distance(world_positions[2], world.TransformPoint(positions[2])) < 1e-4f);
+    //3 points is all single ones, these also go through whole registers, and the big one
+    //through more than one thread
+    bool batch_matches = BatchTransformsMatch(world, simd::lane_count * 5 + 3, 1);
+    batch_matches = batch_matches && BatchTransformsMatch(world, batch_detail::min_points_per_thread * 3 + 5, 4);
+    assert(batch_matches);
+
     a.Normalize(); //change a
-    c = b.Normal(); // b gets the normal version of a, but doesn't change a
+    c = b.Normal(); // c gets the normal version of b, but doesn't change b
+
+    //faster and a little less precise, when that is fine
+    assert(std::fabs(Normal<Precision::Refined>(b).Magnitude() - 1) < 1e-5f);
+    assert(std::isfinite(Normal<Precision::Refined>(Vector3(1e-20f, 0, 0)).x)); //1e-40 squared, a denormal
+    assert(std::fabs(FastSin(1.5707964f) - 1) < 1e-6f && std::fabs(FastAtan2(1, 1) - 0.7853982f) < 1e-6f);
 
     float* data_array;
     data_array = c.data_ptr(); //data_array now points to the location of Vector3 c
-    
+
     //forward declaration of a function
     void example_api_call(int count, float* pointer);
 
     //sample usage for data_ptr(). Very handy for C api's (like OpenGL)
-    example_function_call(3, c.data_ptr());
-    
+    example_function_call(3, data_array);
+
     //output to standard output, or for use in custom printer
     std::cout << a << " " << b << " " << c;
     std::string out = a.to_string();
 
-    return 0; 
+    return 0;
 }
@@ -0,0 +1,174 @@
+/*
+    -- Allocator Policies --
+
+    BasicLinearAlloc and PoolAlloc are put together from small policy classes passed in as
+    template arguments. Which checks run, what locking happens and where the memory comes from
+    are all decided at compile time, so there is no runtime branch for any of it. With
+    NoChecks and SingleThreaded the allocators compile down to the bare bump or free list
+    operations.
+
+        //debug checks in debug builds, none in release, no locking, one fixed block
+        LinearAlloc scratch(1024 * 1024);
+
+        //shared between job threads, grows in pages of reserved address space
+        BasicLinearAlloc<DefaultChecks, LockFree, VirtualGrowth> shared(1ull << 32);
+
+        //every particle on its own cache line
+        PoolAlloc<Particle, DefaultChecks, SingleThreaded, ChunkedGrowth, NoLiveTracking, 64> particles(1024);
+
+    Checks:
+        NoChecks    - nothing, the release default
+        DebugChecks - every allocation gets a header and a trailer with canary values, which
+                      catch buffer overruns and double frees. New memory is filled with 0xCD and
+                      freed memory with 0xDD, so reading uninitialized or freed memory stands out
+                      in the debugger. Failures print a message and abort.
+        DefaultChecks is DebugChecks unless NDEBUG is defined. Define ALLOC_CHECKS_ENABLED to 0 or 1
+        before including any allocator to override that.
+
+    Threading:
+        SingleThreaded - no locking at all
+        MutexLocked    - every operation takes a std::mutex
+        LockFree       - compare and swap loops, no thread ever waits on another
+
+    Growth (what happens when the memory runs out):
+        FixedGrowth           - nothing, allocations fail. Also the only one that can use
+                                memory owned by someone else.
+        ChunkedGrowth         - another block is allocated from the heap
+        VirtualGrowth         - address space is reserved up front and pages are committed as
+                                they are needed, see virtual_memory.h
+        VirtualHugePageGrowth - same as VirtualGrowth, with a hint to use huge pages
+
+    Live tracking (PoolAlloc only):
+        NoLiveTracking - the pool doesn't know which slots hold objects
+        LiveBitmap     - every chunk keeps a bit per slot, which costs a bit flip per Allocate()
+                         and Free() but lets the pool iterate over its objects and Clear() them
+
+    Alignment: the last template argument is the minimum alignment of every allocation.
+*/
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <mutex>
+
+#if !defined(ALLOC_CHECKS_ENABLED)
+#if defined(NDEBUG)
+#define ALLOC_CHECKS_ENABLED 0
+#else
+#define ALLOC_CHECKS_ENABLED 1
+#endif
+#endif
+
+/* CHECKS */
+
+// Reports even with NDEBUG defined, DebugChecks can be picked explicitly in a release build
+#define ALLOC_CHECK(condition, message) \
+    do { if(!(condition)) { fprintf(stderr, "Allocator check failed: %s\n", message); abort(); } } while(0)
+
+struct NoChecks {
+    static constexpr bool enabled = false;
+    static constexpr size_t header_size = 0; //bytes reserved in front of every allocation
+    static constexpr size_t trailer_size = 0; //bytes reserved after every allocation
+
+    static void OnAllocate(char*, size_t, size_t) {}
+    static size_t OnFree(char*) { return 0; }
+    static void OnRelease(char*, size_t) {}
+};
+
+struct DebugChecks {
+    static constexpr bool enabled = true;
+
+    struct Header {
+        size_t size;
+        size_t previous; //for the linear allocator, offset of the allocation before this one
+        uint64_t canary; //live_canary or freed_canary
+    };
+
+    static constexpr size_t header_size = sizeof(Header);
+    static constexpr size_t trailer_size = sizeof(uint64_t);
+
+    static constexpr uint64_t live_canary = 0xA110CA7EDC0FFEE5ull;
+    static constexpr uint64_t freed_canary = 0xF4EEDF4EEDF4EED5ull;
+    static constexpr uint64_t trailer_canary = 0x7A11CA7A11CA7A11ull;
+    static constexpr unsigned char allocated_fill = 0xCD;
+    static constexpr unsigned char freed_fill = 0xDD;
+
+    // user points at the memory handed out, with header_size bytes free in front of it and
+    // trailer_size bytes free after size
+    static void OnAllocate(char* user, size_t size, size_t previous){
+        Header* header = (Header*)user - 1;
+        header->size = size;
+        header->previous = previous;
+        header->canary = live_canary;
+        memcpy(user + size, &trailer_canary, sizeof(trailer_canary)); //trailer may be unaligned
+        memset(user, allocated_fill, size);
+    }
+
+    // Checks the canaries, poisons the memory and returns the header's previous
+    static size_t OnFree(char* user){
+        Header* header = (Header*)user - 1;
+        ALLOC_CHECK(header->canary != freed_canary, "double free");
+        ALLOC_CHECK(header->canary == live_canary, "header overwritten, buffer underrun or not from this allocator");
+        uint64_t trailer;
+        memcpy(&trailer, user + header->size, sizeof(trailer));
+        ALLOC_CHECK(trailer == trailer_canary, "trailer overwritten, buffer overrun");
+        header->canary = freed_canary;
+        memset(user, freed_fill, header->size);
+        return header->previous;
+    }
+
+    // Marks memory as freed without checking it, for when the allocator takes everything back
+    // at once and can't tell which of it was live. A later Free() of it is a double free.
+    static void OnRelease(char* user, size_t size){
+        Header* header = (Header*)user - 1;
+        header->size = size;
+        header->canary = freed_canary;
+        memset(user, freed_fill, size);
+    }
+};
+
+#if ALLOC_CHECKS_ENABLED
+using DefaultChecks = DebugChecks;
+#else
+using DefaultChecks = NoChecks;
+#endif
+
+/* THREADING */
+
+struct SingleThreaded {
+    static constexpr bool lock_free = false;
+    struct Mutex {
+        void lock() {}
+        void unlock() {}
+    };
+};
+
+struct MutexLocked {
+    static constexpr bool lock_free = false;
+    using Mutex = std::mutex;
+};
+
+struct LockFree {
+    static constexpr bool lock_free = true;
+    using Mutex = SingleThreaded::Mutex; //nothing to lock
+};
+
+/* GROWTH */
+
+struct FixedGrowth {};
+struct ChunkedGrowth {};
+struct VirtualGrowth {};
+struct VirtualHugePageGrowth {};
+
+/* LIVE TRACKING */
+
+struct NoLiveTracking {
+    static constexpr bool enabled = false;
+};
+struct LiveBitmap {
+    static constexpr bool enabled = true;
+};
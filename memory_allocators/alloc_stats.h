@@ -0,0 +1,222 @@
+/*
+    -- Allocator Statistics --
+
+    Every allocator in this folder keeps an AllocStats that can be read through Stats(). It
+    tracks:
+        - bytes and objects currently in use, and the highest they have been (peak)
+        - how many allocations and frees there were, and how many allocations failed
+        - bytes and allocation counts per tag
+
+    The point is to find out how big an arena really needs to be instead of guessing. Run the game,
+    then look at the peak.
+
+    Tags say what the memory is for. Register a tag once, then every allocation made inside an
+    AllocTagScope on that thread is counted against it:
+
+        static const int physics_tag = RegisterAllocTag("Physics");
+        {
+            AllocTagScope tag(physics_tag);
+            ... every allocation here counts towards "Physics" ...
+        }
+        frame_alloc.Stats().Dump("frame", stdout);
+
+    Collection costs a few adds per allocation, so it is compiled out in release builds (when
+    NDEBUG is defined). Define ALLOC_STATS_ENABLED to 0 or 1 before including any allocator to
+    override that. When disabled the stats are empty and every call does nothing.
+
+    The concurrent allocators use ConcurrentAllocStats, which is the same thing with atomic counters.
+*/
+#pragma once
+
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <atomic>
+#include <mutex>
+
+#if !defined(ALLOC_STATS_ENABLED)
+#if defined(NDEBUG)
+#define ALLOC_STATS_ENABLED 0
+#else
+#define ALLOC_STATS_ENABLED 1
+#endif
+#endif
+
+/* TAGS */
+
+static constexpr int max_alloc_tags = 32;
+
+namespace alloc_stats_detail {
+
+struct TagRegistry {
+    std::mutex lock;
+    const char* names[max_alloc_tags] = {"Untagged"};
+    int count = 1;
+};
+
+inline TagRegistry& Registry(){
+    static TagRegistry registry;
+    return registry;
+}
+
+inline int& CurrentTag(){
+    thread_local int tag = 0;
+    return tag;
+}
+
+inline void RaisePeak(size_t& peak, size_t value){
+    if(value > peak) peak = value;
+}
+inline void RaisePeak(std::atomic<size_t>& peak, size_t value){
+    size_t old = peak.load(std::memory_order_relaxed);
+    while(value > old && !peak.compare_exchange_weak(old, value, std::memory_order_relaxed)){}
+}
+
+inline void Lower(size_t& value, size_t amount){
+    value -= amount;
+}
+inline void Lower(std::atomic<size_t>& value, size_t amount){
+    value.fetch_sub(amount, std::memory_order_relaxed);
+}
+
+} // namespace alloc_stats_detail
+
+// Returns the id for name, the same name always gives the same id. Falls back to the
+// "Untagged" id 0 once max_alloc_tags is reached.
+inline int RegisterAllocTag(const char* name){
+    alloc_stats_detail::TagRegistry& registry = alloc_stats_detail::Registry();
+    std::lock_guard<std::mutex> guard(registry.lock);
+    for(int i = 0; i < registry.count; i++){
+        if(strcmp(registry.names[i], name) == 0) return i;
+    }
+    if(registry.count == max_alloc_tags) return 0;
+    registry.names[registry.count] = name;
+    return registry.count++;
+}
+
+inline const char* AllocTagName(int tag){
+    alloc_stats_detail::TagRegistry& registry = alloc_stats_detail::Registry();
+    std::lock_guard<std::mutex> guard(registry.lock);
+    return tag >= 0 && tag < registry.count ? registry.names[tag] : "Invalid";
+}
+
+// Sets the tag for the current thread until the end of the scope
+class AllocTagScope {
+public:
+    explicit AllocTagScope(int tag) : previous(alloc_stats_detail::CurrentTag()) {
+        alloc_stats_detail::CurrentTag() = tag;
+    }
+    ~AllocTagScope(){
+        alloc_stats_detail::CurrentTag() = previous;
+    }
+
+    AllocTagScope(AllocTagScope const&) = delete;
+    AllocTagScope& operator=(AllocTagScope const&) = delete;
+
+private:
+    int previous;
+};
+
+/* STATS */
+
+// A plain copy of the numbers at one point in time
+struct AllocStatsSnapshot {
+    size_t bytes_in_use = 0;
+    size_t peak_bytes = 0;
+    size_t objects_in_use = 0;
+    size_t peak_objects = 0;
+    size_t allocations = 0;
+    size_t frees = 0;
+    size_t failures = 0;
+    size_t tag_bytes[max_alloc_tags] = {};
+    size_t tag_allocations[max_alloc_tags] = {};
+
+    void Dump(const char* name, FILE* out = stdout) const {
+        fprintf(out, "%s: %zu bytes in use (peak %zu), %zu objects (peak %zu), "
+            "%zu allocations, %zu frees, %zu failures\n",
+            name, bytes_in_use, peak_bytes, objects_in_use, peak_objects, allocations, frees, failures);
+        for(int i = 0; i < max_alloc_tags; i++){
+            if(tag_allocations[i] != 0){
+                fprintf(out, "    %-20s %zu bytes in %zu allocations\n", AllocTagName(i), tag_bytes[i], tag_allocations[i]);
+            }
+        }
+    }
+};
+
+template<typename Counter>
+class BasicAllocStats {
+public:
+#if ALLOC_STATS_ENABLED
+    void RecordAlloc(size_t bytes){
+        alloc_stats_detail::RaisePeak(peak_bytes, bytes_in_use += bytes);
+        alloc_stats_detail::RaisePeak(peak_objects, objects_in_use += 1);
+        allocations += 1;
+        int tag = alloc_stats_detail::CurrentTag();
+        tag_bytes[tag] += bytes;
+        tag_allocations[tag] += 1;
+    }
+    void RecordFree(size_t bytes){
+        alloc_stats_detail::Lower(bytes_in_use, bytes);
+        alloc_stats_detail::Lower(objects_in_use, 1);
+        frees += 1;
+    }
+    void RecordFailure(){
+        failures += 1;
+    }
+    // For allocators that let go of many allocations at once, like LinearAlloc::RewindTo().
+    // objects is how many objects went with them, if the allocator knows.
+    void RecordRelease(size_t bytes, size_t objects){
+        alloc_stats_detail::Lower(bytes_in_use, bytes);
+        alloc_stats_detail::Lower(objects_in_use, objects);
+    }
+    // Everything is gone at once
+    void RecordReset(){
+        bytes_in_use = 0;
+        objects_in_use = 0;
+    }
+
+    AllocStatsSnapshot Snapshot() const {
+        AllocStatsSnapshot snapshot;
+        snapshot.bytes_in_use = bytes_in_use;
+        snapshot.peak_bytes = peak_bytes;
+        snapshot.objects_in_use = objects_in_use;
+        snapshot.peak_objects = peak_objects;
+        snapshot.allocations = allocations;
+        snapshot.frees = frees;
+        snapshot.failures = failures;
+        for(int i = 0; i < max_alloc_tags; i++){
+            snapshot.tag_bytes[i] = tag_bytes[i];
+            snapshot.tag_allocations[i] = tag_allocations[i];
+        }
+        return snapshot;
+    }
+#else
+    void RecordAlloc(size_t) {}
+    void RecordFree(size_t) {}
+    void RecordFailure() {}
+    void RecordRelease(size_t, size_t) {}
+    void RecordReset() {}
+    AllocStatsSnapshot Snapshot() const { return AllocStatsSnapshot{}; }
+#endif
+
+    void Dump(const char* name, FILE* out = stdout) const {
+        Snapshot().Dump(name, out);
+    }
+
+private:
+#if ALLOC_STATS_ENABLED
+    Counter bytes_in_use{0};
+    Counter peak_bytes{0};
+    Counter objects_in_use{0};
+    Counter peak_objects{0};
+    Counter allocations{0};
+    Counter frees{0};
+    Counter failures{0};
+    Counter tag_bytes[max_alloc_tags] = {};
+    Counter tag_allocations[max_alloc_tags] = {};
+#endif
+};
+
+using AllocStats = BasicAllocStats<size_t>;
+using ConcurrentAllocStats = BasicAllocStats<std::atomic<size_t>>;
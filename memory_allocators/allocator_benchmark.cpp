@@ -0,0 +1,1014 @@
+/*
+    -- Allocator Benchmarks --
+
+    Measures the allocators in this folder against plain malloc and new. Build with optimizations
+    on, otherwise the numbers say nothing:
+
+        g++ -O2 -std=c++17 -pthread allocator_benchmark.cpp -o allocator_benchmark
+        ./allocator_benchmark            //everything
+        ./allocator_benchmark traversal  //just one workload
+
+    Workloads:
+        bump       - lots of small allocations, all thrown away at the end of each frame
+        fixed      - fixed size objects replaced at random, always the same number alive
+        churn      - mixed size objects with random lifetimes
+        threads    - linear and pool allocation from several threads at once
+        burst      - spawning and despawning whole waves of objects, one call per object against
+                     PoolAlloc's AllocateN/FreeN/Clear, and updating every live object
+        policies   - LinearAlloc and PoolAlloc with each policy, next to a hand written bump
+                     and free list to show what NoChecks + SingleThreaded boils down to
+        traversal  - walking over objects after a lot of churn, shows how cache friendly the
+                     memory layout ended up, and what compacting a pool gets back
+        stream     - a producer thread handing variable sized messages to a consumer thread,
+                     malloc/free against RingAlloc with the consumer signaling fences
+        snapshot   - building a lookup table from scratch against mapping in one saved with
+                     arena_snapshot.h, and looking things up in both
+
+    Each test reports nanoseconds per operation, millions of operations per second and the peak
+    resident memory (RSS) of the process while it ran. On Linux the peak is reset before every
+    test. Elsewhere it is the peak of the whole run so far. Memory malloc held on to after an
+    earlier test still counts, run a single workload for the cleanest RSS numbers.
+*/
+
+//measure the allocators, not the bookkeeping
+#define ALLOC_STATS_ENABLED 0
+#define ALLOC_CHECKS_ENABLED 0
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <random>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+#include "linear_alloc.h"
+#include "arena_snapshot.h"
+#include "concurrent_linear_alloc.h"
+#include "pool_alloc.h"
+#include "concurrent_pool_alloc.h"
+#include "compacting_pool.h"
+#include "small_object_alloc.h"
+#include "slot_map.h"
+#include "tlsf_alloc.h"
+#include "ring_alloc.h"
+
+/* HELPERS */
+
+using Clock = std::chrono::steady_clock;
+
+double SecondsSince(Clock::time_point start){
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+// Start measuring the peak RSS from the current RSS
+void ResetPeakRss(){
+#if defined(__linux__)
+    FILE* file = fopen("/proc/self/clear_refs", "w");
+    if(file != nullptr){
+        fputs("5", file);
+        fclose(file);
+    }
+#endif
+}
+
+double PeakRssMB(){
+#if defined(_WIN32)
+    PROCESS_MEMORY_COUNTERS counters;
+    GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters));
+    return counters.PeakWorkingSetSize / (1024.0 * 1024.0);
+#elif defined(__linux__)
+    //VmHWM is the peak that clear_refs resets, ru_maxrss isn't
+    FILE* file = fopen("/proc/self/status", "r");
+    char line[256];
+    double kb = 0;
+    while(file != nullptr && fgets(line, sizeof(line), file)){
+        if(strncmp(line, "VmHWM:", 6) == 0){
+            kb = atof(line + 6);
+            break;
+        }
+    }
+    if(file != nullptr) fclose(file);
+    return kb / 1024.0;
+#else
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss / (1024.0 * 1024.0); //bytes on macOS
+#endif
+}
+
+void Report(const char* name, int threads, size_t total_ops, double seconds){
+    printf("  %-24s threads: %2d  %8.2f ns/op  %9.2f Mops/s  peak RSS %7.1f MB\n",
+        name, threads, seconds * 1e9 / total_ops, total_ops / seconds / 1e6, PeakRssMB());
+}
+
+// Runs work(thread_index) on thread_count threads at once and returns the wall time
+template<typename Func>
+double RunOnThreads(int thread_count, Func&& work){
+    std::vector<std::thread> threads;
+    ResetPeakRss();
+    Clock::time_point start = Clock::now();
+    for(int i = 0; i < thread_count; i++){
+        threads.emplace_back(work, i);
+    }
+    for(auto& t : threads){
+        t.join();
+    }
+    return SecondsSince(start);
+}
+
+// Runs work() once and returns the wall time
+template<typename Func>
+double Time(Func&& work){
+    ResetPeakRss();
+    Clock::time_point start = Clock::now();
+    work();
+    return SecondsSince(start);
+}
+
+//keeps the compiler from throwing away allocations we never read
+void* volatile sink;
+void DoNotOptimize(void* p){
+    sink = p;
+}
+
+struct Particle {
+    float position[3];
+    float velocity[3];
+    float lifetime;
+    int id;
+};
+
+/* BUMP ALLOCATE THEN RESET */
+
+const size_t bump_frames = 256;
+const size_t bump_allocs_per_frame = 16384;
+
+void BenchmarkBumpReset(){
+    printf("Bump allocate then reset, %zu frames of %zu allocations of 16-128 bytes\n", bump_frames, bump_allocs_per_frame);
+    size_t total_ops = bump_frames * bump_allocs_per_frame;
+
+    std::vector<size_t> sizes(bump_allocs_per_frame);
+    std::mt19937 rng(42);
+    for(size_t& size : sizes){
+        size = 16 + rng() % 113;
+    }
+    std::vector<void*> ptrs(bump_allocs_per_frame);
+
+    double seconds = Time([&]{
+        for(size_t frame = 0; frame < bump_frames; frame++){
+            for(size_t i = 0; i < bump_allocs_per_frame; i++){
+                ptrs[i] = malloc(sizes[i]);
+                *(char*)ptrs[i] = 1;
+            }
+            for(size_t i = 0; i < bump_allocs_per_frame; i++){
+                free(ptrs[i]);
+            }
+        }
+    });
+    Report("malloc + free", 1, total_ops, seconds);
+
+    seconds = Time([&]{
+        for(size_t frame = 0; frame < bump_frames; frame++){
+            for(size_t i = 0; i < bump_allocs_per_frame; i++){
+                ptrs[i] = new char[sizes[i]];
+                *(char*)ptrs[i] = 1;
+            }
+            for(size_t i = 0; i < bump_allocs_per_frame; i++){
+                delete[] (char*)ptrs[i];
+            }
+        }
+    });
+    Report("new + delete", 1, total_ops, seconds);
+
+    seconds = Time([&]{
+        LinearAlloc frame_alloc(bump_allocs_per_frame * 128);
+        for(size_t frame = 0; frame < bump_frames; frame++){
+            for(size_t i = 0; i < bump_allocs_per_frame; i++){
+                ptrs[i] = frame_alloc.Allocate(sizes[i]);
+                *(char*)ptrs[i] = 1;
+            }
+            frame_alloc.Reset();
+        }
+    });
+    Report("LinearAlloc + Reset", 1, total_ops, seconds);
+}
+
+/* FIXED SIZE CHURN */
+
+const size_t fixed_live_objects = 65536;
+const size_t fixed_operations = 1 << 22;
+
+// Replaces a random live particle with a new one, over and over
+template<typename AllocFunc, typename FreeFunc>
+double FixedChurn(AllocFunc&& alloc, FreeFunc&& release){
+    std::mt19937 rng(99);
+    std::vector<uint32_t> slots(fixed_operations);
+    for(uint32_t& slot : slots){
+        slot = rng() % fixed_live_objects;
+    }
+    std::vector<Particle*> live(fixed_live_objects);
+
+    double seconds = Time([&]{
+        for(Particle*& p : live){
+            p = alloc();
+        }
+        for(size_t i = 0; i < fixed_operations; i++){
+            Particle*& p = live[slots[i]];
+            release(p);
+            p = alloc();
+            p->id = (int)i;
+        }
+        for(Particle* p : live){
+            release(p);
+        }
+    });
+    return seconds;
+}
+
+void BenchmarkFixedChurn(){
+    printf("Fixed size churn, %zu live particles, %zu replacements\n", fixed_live_objects, fixed_operations);
+    size_t total_ops = fixed_operations + fixed_live_objects;
+
+    double seconds = FixedChurn([]{ return new (malloc(sizeof(Particle))) Particle(); },
+                                [](Particle* p){ free(p); });
+    Report("malloc + free", 1, total_ops, seconds);
+
+    seconds = FixedChurn([]{ return new Particle(); },
+                         [](Particle* p){ delete p; });
+    Report("new + delete", 1, total_ops, seconds);
+
+    {
+        PoolAlloc<Particle> pool(4096);
+        seconds = FixedChurn([&]{ return pool.Allocate(); },
+                             [&](Particle* p){ pool.Free(p); });
+        Report("PoolAlloc", 1, total_ops, seconds);
+    }
+    {
+        SmallObjectAlloc small(fixed_live_objects * sizeof(Particle));
+        seconds = FixedChurn([&]{ return new (small.Allocate(sizeof(Particle))) Particle(); },
+                             [&](Particle* p){ small.Free(p); });
+        Report("SmallObjectAlloc", 1, total_ops, seconds);
+    }
+}
+
+/* LINEAR ALLOCATOR THREAD SCALING */
+
+const size_t allocs_per_thread = 1 << 20;
+const size_t alloc_size = 32;
+
+void BenchmarkLinearScaling(){
+    printf("Linear allocation, %zu x %zu byte allocations per thread\n", allocs_per_thread, alloc_size);
+
+    //always go up to a few threads, past the core count they time-share which still shows contention
+    int max_threads = (int)std::thread::hardware_concurrency();
+    if(max_threads < 4) max_threads = 4;
+
+    for(int threads = 1; threads <= max_threads; threads *= 2){
+        size_t total_ops = allocs_per_thread * threads;
+
+        double seconds = RunOnThreads(threads, [](int){
+            std::vector<void*> ptrs(allocs_per_thread);
+            for(size_t i = 0; i < allocs_per_thread; i++){
+                ptrs[i] = malloc(alloc_size);
+                DoNotOptimize(ptrs[i]);
+            }
+            for(size_t i = 0; i < allocs_per_thread; i++){
+                free(ptrs[i]);
+            }
+        });
+        Report("malloc + free", threads, total_ops, seconds);
+
+        {
+            BasicLinearAlloc<NoChecks, MutexLocked> shared(total_ops * alloc_size);
+            seconds = RunOnThreads(threads, [&](int){
+                for(size_t i = 0; i < allocs_per_thread; i++){
+                    DoNotOptimize(shared.Allocate(alloc_size));
+                }
+            });
+            Report("MutexLocked LinearAlloc", threads, total_ops, seconds);
+        }
+        {
+            BasicLinearAlloc<NoChecks, LockFree> shared(total_ops * alloc_size);
+            seconds = RunOnThreads(threads, [&](int){
+                for(size_t i = 0; i < allocs_per_thread; i++){
+                    DoNotOptimize(shared.Allocate(alloc_size));
+                }
+            });
+            Report("LockFree LinearAlloc", threads, total_ops, seconds);
+        }
+        {
+            AtomicLinearAlloc shared(total_ops * alloc_size);
+            seconds = RunOnThreads(threads, [&](int){
+                for(size_t i = 0; i < allocs_per_thread; i++){
+                    DoNotOptimize(shared.Allocate(alloc_size));
+                }
+            });
+            Report("AtomicLinearAlloc", threads, total_ops, seconds);
+        }
+        {
+            ThreadLinearArenas arenas(threads, allocs_per_thread * alloc_size);
+            seconds = RunOnThreads(threads, [&](int index){
+                LinearAlloc& local = arenas.ForThread(index);
+                for(size_t i = 0; i < allocs_per_thread; i++){
+                    DoNotOptimize(local.Allocate(alloc_size));
+                }
+            });
+            arenas.ResetAll();
+            Report("ThreadLinearArenas", threads, total_ops, seconds);
+        }
+    }
+}
+
+/* POOL ALLOCATOR THREAD STRESS */
+
+const size_t pool_rounds = 4096;
+const size_t pool_burst = 256;
+
+// Every thread spawns a burst of particles then kills them all, over and over
+template<typename AllocFunc, typename FreeFunc>
+void PoolStressLoop(AllocFunc&& alloc, FreeFunc&& release){
+    Particle* live[pool_burst];
+    for(size_t round = 0; round < pool_rounds; round++){
+        for(size_t i = 0; i < pool_burst; i++){
+            live[i] = alloc();
+            live[i]->id = (int)i;
+        }
+        for(size_t i = 0; i < pool_burst; i++){
+            release(live[i]);
+        }
+    }
+}
+
+void BenchmarkPoolStress(){
+    printf("Pool alloc/free stress, %zu rounds of %zu particles per thread\n", pool_rounds, pool_burst);
+
+    int max_threads = (int)std::thread::hardware_concurrency();
+    if(max_threads < 4) max_threads = 4;
+
+    for(int threads = 1; threads <= max_threads; threads *= 2){
+        size_t total_ops = pool_rounds * pool_burst * 2 * threads;
+
+        double seconds = RunOnThreads(threads, [](int){
+            PoolStressLoop([]{ return new (malloc(sizeof(Particle))) Particle(); },
+                           [](Particle* p){ free(p); });
+        });
+        Report("malloc + free", threads, total_ops, seconds);
+
+        {
+            PoolAlloc<Particle, NoChecks, MutexLocked> pool(pool_burst * threads);
+            seconds = RunOnThreads(threads, [&](int){
+                PoolStressLoop([&]{ return pool.Allocate(); },
+                               [&](Particle* p){ pool.Free(p); });
+            });
+            Report("MutexLocked PoolAlloc", threads, total_ops, seconds);
+        }
+        {
+            PoolAlloc<Particle, NoChecks, LockFree> pool(pool_burst * threads);
+            seconds = RunOnThreads(threads, [&](int){
+                PoolStressLoop([&]{ return pool.Allocate(); },
+                               [&](Particle* p){ pool.Free(p); });
+            });
+            Report("LockFree PoolAlloc", threads, total_ops, seconds);
+        }
+        {
+            ConcurrentPoolAlloc<Particle> pool(pool_burst * threads);
+            seconds = RunOnThreads(threads, [&](int){
+                PoolStressLoop([&]{ return pool.Allocate(); },
+                               [&](Particle* p){ pool.Free(p); });
+            });
+            Report("ConcurrentPoolAlloc", threads, total_ops, seconds);
+        }
+    }
+}
+
+/* BURST SPAWN AND WHOLE POOL UPDATE */
+
+const size_t burst_waves = 512;
+const size_t burst_size = 8192;
+const size_t burst_update_passes = 32;
+
+void BenchmarkBurst(){
+    printf("Burst spawn/despawn, %zu waves of %zu particles\n", burst_waves, burst_size);
+    size_t total_ops = burst_waves * burst_size * 2;
+    std::vector<Particle*> wave(burst_size);
+
+    using TrackedPool = PoolAlloc<Particle, NoChecks, SingleThreaded, ChunkedGrowth, LiveBitmap>;
+    {
+        PoolAlloc<Particle> pool(burst_size);
+        double seconds = Time([&]{
+            for(size_t w = 0; w < burst_waves; w++){
+                for(Particle*& p : wave) p = pool.Allocate();
+                DoNotOptimize(wave[burst_size - 1]);
+                for(Particle* p : wave) pool.Free(p);
+            }
+        });
+        Report("Allocate + Free", 1, total_ops, seconds);
+    }
+    {
+        TrackedPool pool(burst_size);
+        double seconds = Time([&]{
+            for(size_t w = 0; w < burst_waves; w++){
+                for(Particle*& p : wave) p = pool.Allocate();
+                DoNotOptimize(wave[burst_size - 1]);
+                for(Particle* p : wave) pool.Free(p);
+            }
+        });
+        Report("LiveBitmap Allocate+Free", 1, total_ops, seconds);
+    }
+    {
+        TrackedPool pool(burst_size);
+        double seconds = Time([&]{
+            for(size_t w = 0; w < burst_waves; w++){
+                pool.AllocateN(wave.data(), burst_size);
+                DoNotOptimize(wave[burst_size - 1]);
+                pool.FreeN(wave.data(), burst_size);
+            }
+        });
+        Report("AllocateN + FreeN", 1, total_ops, seconds);
+    }
+    {
+        TrackedPool pool(burst_size);
+        double seconds = Time([&]{
+            for(size_t w = 0; w < burst_waves; w++){
+                pool.AllocateN(wave.data(), burst_size);
+                DoNotOptimize(wave[burst_size - 1]);
+                pool.Clear();
+            }
+        });
+        Report("AllocateN + Clear", 1, total_ops, seconds);
+    }
+
+    //half the pool dead at random, update what is left
+    printf("Whole pool update, %zu particles with every other one dead at random, %zu passes\n", burst_size * 8, burst_update_passes);
+    {
+        TrackedPool pool(burst_size * 8);
+        std::vector<Particle*> all(burst_size * 8);
+        pool.AllocateN(all.data(), all.size());
+        std::mt19937 rng(5);
+        std::shuffle(all.begin(), all.end(), rng);
+        pool.FreeN(all.data(), all.size() / 2);
+        std::vector<Particle*> live(all.begin() + all.size() / 2, all.end());
+        std::sort(live.begin(), live.end()); //the best a side list of pointers can do
+        size_t update_ops = live.size() * burst_update_passes;
+
+        double seconds = Time([&]{
+            for(size_t pass = 0; pass < burst_update_passes; pass++){
+                for(Particle* p : live) p->position[0] += 1.0f;
+            }
+        });
+        Report("sorted pointer list", 1, update_ops, seconds);
+
+        seconds = Time([&]{
+            for(size_t pass = 0; pass < burst_update_passes; pass++){
+                for(Particle& p : pool) p.position[0] += 1.0f;
+            }
+        });
+        Report("LiveBitmap iterator", 1, update_ops, seconds);
+    }
+}
+
+/* POLICY OVERHEAD */
+
+// What BasicLinearAlloc<NoChecks, SingleThreaded, FixedGrowth> should compile down to
+struct BareBump {
+    char* data;
+    size_t offset;
+    size_t size;
+
+    char* Allocate(size_t bytes){
+        size_t aligned = (offset + 15) & ~(size_t)15;
+        if(aligned + bytes > size) return nullptr;
+        offset = aligned + bytes;
+        return data + aligned;
+    }
+    void Reset() { offset = 0; }
+};
+
+// What PoolAlloc<Particle, NoChecks, SingleThreaded> should compile down to, once warmed up
+struct BareFreeList {
+    union Slot {
+        Slot* next;
+        Particle particle;
+    };
+    Slot* head;
+
+    Particle* Allocate(){
+        Slot* slot = head;
+        head = slot->next;
+        return new (&slot->particle) Particle();
+    }
+    void Free(Particle* p){
+        Slot* slot = (Slot*)p;
+        slot->next = head;
+        head = slot;
+    }
+};
+
+template<typename Alloc>
+void PolicyBump(const char* name, Alloc& alloc, std::vector<size_t> const& sizes){
+    size_t total_ops = bump_frames * sizes.size();
+    double seconds = Time([&]{
+        for(size_t frame = 0; frame < bump_frames; frame++){
+            for(size_t size : sizes){
+                char* p = alloc.Allocate(size);
+                *p = 1;
+                DoNotOptimize(p);
+            }
+            alloc.Reset();
+        }
+    });
+    Report(name, 1, total_ops, seconds);
+}
+
+template<typename Pool>
+void PolicyPool(const char* name, Pool& pool){
+    size_t total_ops = fixed_operations + fixed_live_objects;
+    double seconds = FixedChurn([&]{ return pool.Allocate(); },
+                                [&](Particle* p){ pool.Free(p); });
+    Report(name, 1, total_ops, seconds);
+}
+
+void BenchmarkPolicies(){
+    printf("Linear allocator policies, %zu frames of %zu allocations of 16-128 bytes\n", bump_frames, bump_allocs_per_frame);
+    std::vector<size_t> sizes(bump_allocs_per_frame);
+    std::mt19937 rng(42);
+    for(size_t& size : sizes){
+        size = 16 + rng() % 113;
+    }
+    size_t frame_size = bump_allocs_per_frame * 160; //room for the debug headers too
+    {
+        std::vector<char> memory(frame_size);
+        BareBump bare{memory.data(), 0, frame_size};
+        PolicyBump("hand written bump", bare, sizes);
+    }
+    {
+        BasicLinearAlloc<NoChecks, SingleThreaded, FixedGrowth> alloc(frame_size);
+        PolicyBump("NoChecks Fixed", alloc, sizes);
+    }
+    {
+        BasicLinearAlloc<NoChecks, SingleThreaded, ChunkedGrowth> alloc(64 * 1024);
+        PolicyBump("NoChecks Chunked", alloc, sizes);
+    }
+    {
+        BasicLinearAlloc<NoChecks, SingleThreaded, VirtualGrowth> alloc(frame_size);
+        PolicyBump("NoChecks Virtual", alloc, sizes);
+    }
+    {
+        BasicLinearAlloc<NoChecks, MutexLocked, FixedGrowth> alloc(frame_size);
+        PolicyBump("NoChecks MutexLocked", alloc, sizes);
+    }
+    {
+        BasicLinearAlloc<NoChecks, LockFree, FixedGrowth> alloc(frame_size);
+        PolicyBump("NoChecks LockFree", alloc, sizes);
+    }
+    {
+        BasicLinearAlloc<DebugChecks, SingleThreaded, FixedGrowth> alloc(frame_size);
+        PolicyBump("DebugChecks Fixed", alloc, sizes);
+    }
+
+    printf("Pool allocator policies, %zu live particles, %zu replacements\n", fixed_live_objects, fixed_operations);
+    {
+        std::vector<BareFreeList::Slot> slots(fixed_live_objects);
+        BareFreeList bare{nullptr};
+        for(BareFreeList::Slot& slot : slots){
+            slot.next = bare.head;
+            bare.head = &slot;
+        }
+        PolicyPool("hand written free list", bare);
+    }
+    {
+        PoolAlloc<Particle, NoChecks, SingleThreaded, FixedGrowth> pool(fixed_live_objects);
+        PolicyPool("NoChecks Fixed", pool);
+    }
+    {
+        PoolAlloc<Particle, NoChecks, SingleThreaded, ChunkedGrowth> pool(4096);
+        PolicyPool("NoChecks Chunked", pool);
+    }
+    {
+        PoolAlloc<Particle, NoChecks, SingleThreaded, VirtualGrowth> pool(4096);
+        PolicyPool("NoChecks Virtual", pool);
+    }
+    {
+        PoolAlloc<Particle, NoChecks, MutexLocked> pool(4096);
+        PolicyPool("NoChecks MutexLocked", pool);
+    }
+    {
+        PoolAlloc<Particle, NoChecks, LockFree> pool(4096);
+        PolicyPool("NoChecks LockFree", pool);
+    }
+    {
+        PoolAlloc<Particle, DebugChecks> pool(4096);
+        PolicyPool("DebugChecks Chunked", pool);
+    }
+}
+
+/* RANDOM LIFETIME MIXED SIZE CHURN */
+
+const size_t churn_live_objects = 16384;
+const size_t churn_operations = 1 << 22;
+
+// Keeps a window of live objects and keeps replacing random ones with a new random size.
+// Mostly small sizes with the occasional larger one, like a real heap.
+template<typename AllocFunc, typename FreeFunc>
+double MixedChurn(AllocFunc&& alloc, FreeFunc&& release){
+    std::mt19937 rng(1234);
+    std::vector<size_t> sizes(churn_operations);
+    std::vector<size_t> slots(churn_operations);
+    for(size_t i = 0; i < churn_operations; i++){
+        sizes[i] = (rng() % 16 == 0) ? 256 + rng() % 768 : 8 + rng() % 248;
+        slots[i] = rng() % churn_live_objects;
+    }
+
+    std::vector<void*> live(churn_live_objects, nullptr);
+    double seconds = Time([&]{
+        for(size_t i = 0; i < churn_operations; i++){
+            void*& slot = live[slots[i]];
+            release(slot);
+            slot = alloc(sizes[i]);
+            *(char*)slot = (char)i; //touch it
+        }
+    });
+    for(void* p : live){
+        release(p);
+    }
+    return seconds;
+}
+
+void BenchmarkMixedChurn(){
+    printf("Mixed size churn, %zu live objects, %zu replacements\n", churn_live_objects, churn_operations);
+
+    double seconds = MixedChurn([](size_t size){ return malloc(size); },
+                                [](void* p){ free(p); });
+    Report("malloc + free", 1, churn_operations, seconds);
+
+    seconds = MixedChurn([](size_t size){ return (void*)new char[size]; },
+                         [](void* p){ delete[] (char*)p; });
+    Report("new + delete", 1, churn_operations, seconds);
+
+    {
+        SmallObjectAlloc small(1024 * 1024);
+        seconds = MixedChurn([&](size_t size){ return small.Allocate(size); },
+                             [&](void* p){ small.Free(p); });
+        Report("SmallObjectAlloc", 1, churn_operations, seconds);
+    }
+    {
+        size_t heap_size = 64 * 1024 * 1024;
+        char* heap_memory = (char*)malloc(heap_size);
+        TlsfAlloc tlsf(heap_memory, heap_size);
+        seconds = MixedChurn([&](size_t size){ return tlsf.Allocate(size); },
+                             [&](void* p){ tlsf.Free(p); });
+        Report("TlsfAlloc", 1, churn_operations, seconds);
+        free(heap_memory);
+    }
+}
+
+/* TRAVERSAL AFTER CHURN */
+
+const size_t traversal_objects = 1 << 18;
+const size_t traversal_passes = 32;
+
+// Fills up, churns so the objects end up all over memory, then times walking over them.
+// Unrelated allocations are mixed in during the churn, like other systems allocating.
+template<typename AllocFunc, typename FreeFunc>
+double TraverseAfterChurn(AllocFunc&& alloc, FreeFunc&& release){
+    std::mt19937 rng(7);
+    std::vector<Particle*> live(traversal_objects);
+    std::vector<void*> unrelated;
+    for(Particle*& p : live){
+        p = alloc();
+    }
+    for(size_t i = 0; i < traversal_objects * 2; i++){
+        Particle*& p = live[rng() % traversal_objects];
+        release(p);
+        if(i % 4 == 0) unrelated.push_back(malloc(sizeof(Particle)));
+        p = alloc();
+    }
+    for(Particle* p : live){
+        p->velocity[0] = p->velocity[1] = p->velocity[2] = 1.0f;
+    }
+
+    double seconds = Time([&]{
+        for(size_t pass = 0; pass < traversal_passes; pass++){
+            for(Particle* p : live){
+                p->position[0] += p->velocity[0];
+                p->position[1] += p->velocity[1];
+                p->position[2] += p->velocity[2];
+            }
+        }
+    });
+
+    for(Particle* p : live){
+        release(p);
+    }
+    for(void* p : unrelated){
+        free(p);
+    }
+    return seconds;
+}
+
+void BenchmarkTraversal(){
+    printf("Traversal after churn, %zu particles, %zu passes\n", traversal_objects, traversal_passes);
+    size_t total_ops = traversal_objects * traversal_passes;
+
+    double seconds = TraverseAfterChurn([]{ return new Particle(); },
+                                        [](Particle* p){ delete p; });
+    Report("new + delete", 1, total_ops, seconds);
+
+    {
+        PoolAlloc<Particle> pool(4096);
+        seconds = TraverseAfterChurn([&]{ return pool.Allocate(); },
+                                     [&](Particle* p){ pool.Free(p); });
+        Report("PoolAlloc", 1, total_ops, seconds);
+    }
+    {
+        //the slot map keeps live objects packed, so the walk is a straight line through memory
+        std::mt19937 rng(7);
+        SlotMap<Particle> particles(traversal_objects);
+        std::vector<SlotMap<Particle>::Handle> handles(traversal_objects);
+        for(auto& handle : handles){
+            handle = particles.Insert();
+        }
+        for(size_t i = 0; i < traversal_objects * 2; i++){
+            auto& handle = handles[rng() % traversal_objects];
+            particles.Remove(handle);
+            handle = particles.Insert();
+        }
+        for(Particle& p : particles){
+            p.velocity[0] = p.velocity[1] = p.velocity[2] = 1.0f;
+        }
+        seconds = Time([&]{
+            for(size_t pass = 0; pass < traversal_passes; pass++){
+                for(Particle& p : particles){
+                    p.position[0] += p.velocity[0];
+                    p.position[1] += p.velocity[1];
+                    p.position[2] += p.velocity[2];
+                }
+            }
+        });
+        DoNotOptimize(particles.begin());
+        Report("SlotMap (dense)", 1, total_ops, seconds);
+    }
+    {
+        //spawn a wave twice the size, kill a random half: the survivors are spread over the pool
+        std::mt19937 rng(7);
+        CompactingPool<Particle> particles(traversal_objects * 2);
+        std::vector<CompactingPool<Particle>::Handle> handles(traversal_objects * 2);
+        for(auto& handle : handles){
+            handle = particles.Create();
+        }
+        std::shuffle(handles.begin(), handles.end(), rng);
+        for(size_t i = traversal_objects; i < handles.size(); i++){
+            particles.Destroy(handles[i]);
+        }
+        particles.ForEach([](Particle& p){ p.velocity[0] = p.velocity[1] = p.velocity[2] = 1.0f; });
+
+        auto Walk = [&]{
+            return Time([&]{
+                for(size_t pass = 0; pass < traversal_passes; pass++){
+                    particles.ForEach([](Particle& p){
+                        p.position[0] += p.velocity[0];
+                        p.position[1] += p.velocity[1];
+                        p.position[2] += p.velocity[2];
+                    });
+                }
+            });
+        };
+        seconds = Walk();
+        Report("CompactingPool (holes)", 1, total_ops, seconds);
+
+        //the way a game would do it, a small budget every frame
+        int frames = 0;
+        size_t moved = 0;
+        double compact_seconds = Time([&]{
+            while(!particles.IsCompact()){
+                moved += particles.Compact(std::chrono::microseconds(500));
+                frames++;
+            }
+        });
+        seconds = Walk();
+        Report("CompactingPool (packed)", 1, total_ops, seconds);
+        printf("  compaction moved %zu objects in %d frames of 500 us, %.2f ms total\n",
+            moved, frames, compact_seconds * 1e3);
+    }
+}
+
+/* STREAMING PRODUCER/CONSUMER */
+
+const size_t stream_messages = 1 << 21;
+const size_t stream_queue_size = 1024;
+const size_t stream_ring_size = 4 * 1024 * 1024;
+
+struct StreamMessage {
+    char* data;
+    size_t size;
+    uint64_t fence;
+};
+
+// Single producer single consumer queue with a fixed size, so the only heap traffic is the
+// allocator's
+class StreamQueue {
+public:
+    void Push(StreamMessage message){
+        size_t written = write.load(std::memory_order_relaxed);
+        while(written - read.load(std::memory_order_acquire) == stream_queue_size){
+            std::this_thread::yield();
+        }
+        slots[written % stream_queue_size] = message;
+        write.store(written + 1, std::memory_order_release);
+    }
+    StreamMessage Pop(){
+        size_t position = read.load(std::memory_order_relaxed);
+        while(write.load(std::memory_order_acquire) == position){
+            std::this_thread::yield();
+        }
+        StreamMessage message = slots[position % stream_queue_size];
+        read.store(position + 1, std::memory_order_release);
+        return message;
+    }
+
+private:
+    std::vector<StreamMessage> slots = std::vector<StreamMessage>(stream_queue_size);
+    std::atomic<size_t> write{0};
+    std::atomic<size_t> read{0};
+};
+
+// The producer runs on its own thread, alloc(size, fence) is retried until it stops returning
+// nullptr. The consumer reads every message and hands it to release().
+template<typename AllocFunc, typename ReleaseFunc>
+double StreamLoop(std::vector<size_t> const& sizes, AllocFunc&& alloc, ReleaseFunc&& release){
+    StreamQueue queue;
+    size_t checksum = 0;
+    double seconds = Time([&]{
+        std::thread producer([&]{
+            for(size_t i = 0; i < stream_messages; i++){
+                char* data;
+                while((data = alloc(sizes[i], i + 1)) == nullptr){
+                    std::this_thread::yield(); //consumer hasn't caught up
+                }
+                data[0] = (char)i;
+                data[sizes[i] - 1] = (char)i;
+                queue.Push(StreamMessage{data, sizes[i], i + 1});
+            }
+        });
+        for(size_t i = 0; i < stream_messages; i++){
+            StreamMessage message = queue.Pop();
+            checksum += (size_t)message.data[0] + (size_t)message.data[message.size - 1];
+            release(message);
+        }
+        producer.join();
+    });
+    DoNotOptimize((void*)checksum);
+    return seconds;
+}
+
+void BenchmarkStream(){
+    printf("Streaming %zu messages of 16 to 4096 bytes between two threads\n", stream_messages);
+    std::mt19937 rng(21);
+    std::vector<size_t> sizes(stream_messages);
+    for(size_t& size : sizes) size = 16 + rng() % (4096 - 16 + 1);
+
+    double seconds = StreamLoop(sizes,
+        [](size_t size, uint64_t){ return (char*)malloc(size); },
+        [](StreamMessage const& message){ free(message.data); });
+    Report("malloc/free", 2, stream_messages, seconds);
+
+    CpuFence consumed;
+    RingAlloc<> ring(stream_ring_size, consumed, stream_queue_size);
+    seconds = StreamLoop(sizes,
+        [&](size_t size, uint64_t fence){ return ring.Allocate(size, fence, 16); },
+        [&](StreamMessage const& message){ consumed.Signal(message.fence); });
+    Report("RingAlloc + CpuFence", 2, stream_messages, seconds);
+}
+
+/* SNAPSHOT LOADING */
+
+const size_t snapshot_entries = 1 << 20;
+const size_t snapshot_lookups = 1 << 22;
+const char* const snapshot_path = "allocator_benchmark.snapshot";
+
+struct SnapshotEntry {
+    uint64_t key;
+    OffsetPtr<const char> name;
+    float value;
+};
+
+struct SnapshotTable {
+    uint64_t count;
+    OffsetPtr<SnapshotEntry> entries; //sorted by key
+};
+
+// Stands in for whatever a real startup does with its source data: generate, sort, format
+SnapshotTable* BuildSnapshotTable(LinearAlloc& arena){
+    std::mt19937_64 rng(17);
+    std::vector<uint64_t> keys(snapshot_entries);
+    for(uint64_t& key : keys) key = rng();
+    std::sort(keys.begin(), keys.end());
+
+    SnapshotTable* table = arena.Create<SnapshotTable>();
+    SnapshotEntry* entries = arena.CreateArray<SnapshotEntry>(snapshot_entries);
+    if(table == nullptr || entries == nullptr) return nullptr;
+    for(size_t i = 0; i < snapshot_entries; i++){
+        char* name = arena.Allocate(24, 1);
+        if(name == nullptr) return nullptr;
+        snprintf(name, 24, "entry_%zu", i);
+        entries[i].key = keys[i];
+        entries[i].name = name;
+        entries[i].value = (float)i;
+    }
+    table->count = snapshot_entries;
+    table->entries = entries;
+    return table;
+}
+
+// Binary searches for keys that are in the table, returns a sum so nothing is optimized out
+double SnapshotLookups(const SnapshotTable* table, std::vector<uint64_t> const& keys){
+    const SnapshotEntry* entries = table->entries.Get();
+    double sum = 0;
+    for(uint64_t key : keys){
+        const SnapshotEntry* found = std::lower_bound(entries, entries + table->count, key,
+            [](SnapshotEntry const& entry, uint64_t k){ return entry.key < k; });
+        sum += found->value + found->name[0];
+    }
+    return sum;
+}
+
+void BenchmarkSnapshot(){
+    printf("Snapshot loading, a table of %zu entries, ns per entry\n", snapshot_entries);
+    LinearAlloc arena(64 * 1024 * 1024);
+    SnapshotTable* built = nullptr;
+    double seconds = Time([&]{ built = BuildSnapshotTable(arena); });
+    if(built == nullptr){
+        printf("  arena too small, skipping\n");
+        return;
+    }
+    Report("rebuild", 1, snapshot_entries, seconds);
+
+    bool saved = false;
+    seconds = Time([&]{ saved = SaveArenaSnapshot(snapshot_path, arena, built, 1); });
+    if(!saved){
+        printf("  couldn't write %s, skipping\n", snapshot_path);
+        return;
+    }
+    Report("save", 1, snapshot_entries, seconds);
+
+    //the file was just written, so this is a page-in from the OS's cache rather than the disk
+    seconds = Time([&]{
+        ArenaSnapshot snapshot(snapshot_path, 1);
+        DoNotOptimize((void*)snapshot.Root<SnapshotTable>());
+    });
+    Report("map + verify checksum", 1, snapshot_entries, seconds);
+    seconds = Time([&]{
+        ArenaSnapshot snapshot(snapshot_path, 1, false);
+        DoNotOptimize((void*)snapshot.Root<SnapshotTable>());
+    });
+    Report("map, pages on demand", 1, snapshot_entries, seconds);
+
+    printf("Lookups, %zu binary searches\n", snapshot_lookups);
+    std::mt19937 rng(18);
+    std::vector<uint64_t> keys(snapshot_lookups);
+    for(uint64_t& key : keys) key = built->entries[rng() % snapshot_entries].key;
+
+    double sum = 0;
+    seconds = Time([&]{ sum += SnapshotLookups(built, keys); });
+    Report("rebuilt table", 1, snapshot_lookups, seconds);
+    {
+        ArenaSnapshot snapshot(snapshot_path, 1, false);
+        seconds = Time([&]{ sum += SnapshotLookups(snapshot.Root<SnapshotTable>(), keys); });
+        Report("mapped table", 1, snapshot_lookups, seconds);
+    }
+    DoNotOptimize(&sum);
+    remove(snapshot_path);
+}
+
+int main(int argc, char** argv){
+    const char* only = argc > 1 ? argv[1] : nullptr;
+    auto Run = [&](const char* name){ return only == nullptr || strcmp(only, name) == 0; };
+
+    if(Run("bump")) BenchmarkBumpReset();
+    if(Run("fixed")) BenchmarkFixedChurn();
+    if(Run("churn")) BenchmarkMixedChurn();
+    if(Run("threads")){
+        BenchmarkLinearScaling();
+        BenchmarkPoolStress();
+    }
+    if(Run("traversal")) BenchmarkTraversal();
+    if(Run("burst")) BenchmarkBurst();
+    if(Run("policies")) BenchmarkPolicies();
+    if(Run("stream")) BenchmarkStream();
+    if(Run("snapshot")) BenchmarkSnapshot();
+    return 0;
+}
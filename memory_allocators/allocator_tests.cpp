@@ -0,0 +1,901 @@
+/*
+    -- Allocator Tests --
+
+    Checks that the allocators in this folder do what their headers say they do. Where
+    allocator_benchmark.cpp asks how fast, this asks whether it is right. Build it without NDEBUG
+    so the debug checks and asserts are on, and with the sanitizers when there is time:
+
+        g++ -g -std=c++17 -pthread allocator_tests.cpp -o allocator_tests
+        g++ -g -std=c++17 -pthread -fsanitize=address,undefined allocator_tests.cpp -o allocator_tests
+        ./allocator_tests          //everything
+        ./allocator_tests frame    //just one group
+
+    Groups:
+        frame      - MultiFrameAlloc keeps memory alive for N-1 frames, then reuses it
+        concurrent - ConcurrentPoolAlloc gets every slot back from threads that have exited,
+                     also after many more threads than max_threads
+        slotmap    - SlotMap handles never match again after their object is removed, and a
+                     throwing constructor leaves the map as it was
+        pmr        - the std::pmr resources and STL allocators under vector, unordered_map and
+                     list, and requests too big or too aligned for a pool block going upstream
+        stack      - StackAlloc nesting, alignment padding, markers, and in debug builds on
+                     POSIX that freeing out of order trips the assert
+        pool       - PoolAlloc Clear() hands every slot out again, also with LockFree, the
+                     LiveBitmap iterator visits exactly the live objects, also after many
+                     threads freed into the pool at once, and on POSIX that
+                     freeing an object from before a Clear() aborts with DebugChecks
+        tlsf       - TlsfAlloc splits blocks and merges them back with both neighbours, and
+                     over aligned blocks give their front piece back too
+        small      - SmallObjectAlloc sends each size to the right class, and to malloc when it
+                     is too big or its class is full
+        compacting - CompactingPool handles go stale like SlotMap's, compaction keeps every
+                     object and handle intact, and a throwing constructor changes nothing
+        snapshot   - an arena saved with SaveArenaSnapshot() maps back in somewhere else with
+                     every OffsetPtr still right, and bad files are turned down
+        ring       - RingAlloc wraps around without splitting an allocation, and memory only
+                     comes back once its fence has completed
+
+    Every failed check prints where it was, the run goes on with the next one. The exit code is
+    the number of failed checks, so 0 means everything passed.
+*/
+
+#include <stdio.h>
+#include <string.h>
+
+#include <algorithm>
+#include <atomic>
+#include <list>
+#include <memory_resource>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <signal.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#define HAS_FORK 1
+#endif
+
+#include "frame_alloc.h"
+#include "concurrent_pool_alloc.h"
+#include "slot_map.h"
+#include "std_allocators.h"
+#include "stack_alloc.h"
+#include "pool_alloc.h"
+#include "tlsf_alloc.h"
+#include "small_object_alloc.h"
+#include "compacting_pool.h"
+#include "arena_snapshot.h"
+#include "ring_alloc.h"
+
+/* HELPERS */
+
+std::atomic<int> failures{0}; //checks also run on other threads
+
+// Like assert, but also in release builds, and it doesn't stop at the first failure
+#define CHECK(condition) \
+    do { if(!(condition)) { printf("  FAILED %s:%d: %s\n", __FILE__, __LINE__, #condition); failures++; } } while(0)
+
+/* FRAME */
+
+template<int N>
+void TestMultiFrame(){
+    const int frames = 4 * N;
+    MultiFrameAlloc<N> alloc(1024);
+    int* values[frames];
+    for(int frame = 0; frame < frames; frame++){
+        alloc.BeginFrame();
+        values[frame] = alloc.template Create<int>(frame);
+        CHECK(values[frame] != nullptr);
+
+        //everything from the last N-1 frames is still there
+        for(int older = frame - N + 1; older <= frame; older++){
+            if(older >= 0) CHECK(*values[older] == older);
+        }
+        //the buffer of frame - N was reset and handed out again, from the start
+        if(frame >= N) CHECK(values[frame] == values[frame - N]);
+        for(int older = frame - N + 1; older < frame; older++){
+            if(older >= 0) CHECK(values[frame] != values[older]);
+        }
+    }
+    CHECK(&alloc.Previous(N - 1) != &alloc.Current());
+    CHECK(&alloc.Previous(N) == &alloc.Current());
+}
+
+void TestFrame(){
+    printf("frame\n");
+    TestMultiFrame<2>();
+    TestMultiFrame<3>();
+    TestMultiFrame<4>();
+
+    //DoubleFrameAlloc, last frame's data readable while this frame is built
+    DoubleFrameAlloc frames(256);
+    frames.BeginFrame();
+    char* last = frames.Allocate(200);
+    memset(last, 7, 200);
+    frames.BeginFrame();
+    CHECK(frames.Allocate(200) != nullptr);
+    CHECK(frames.Allocate(200) == nullptr); //each buffer has its own capacity
+    CHECK(last[0] == 7 && last[199] == 7);
+    CHECK(frames.Previous().BytesUsed() >= 200);
+}
+
+/* CONCURRENT POOL */
+
+// Allocates until the pool is out of slots and frees everything again, returns how many it got
+template<typename Pool>
+size_t DrainPool(Pool& pool){
+    std::vector<int*> all;
+    while(int* p = pool.Allocate(0)){
+        all.push_back(p);
+    }
+    for(int* p : all){
+        pool.Free(p);
+    }
+    return all.size();
+}
+
+void TestConcurrentPool(){
+    printf("concurrent\n");
+    using Pool = ConcurrentPoolAlloc<int>;
+    const uint32_t capacity = 4096; //one chunk, so the pool can't grow past it
+    const int allocs_per_thread = 100; //more than a magazine holds, so some go back as batches
+    Pool pool(capacity, 1);
+    CHECK(DrainPool(pool) == capacity);
+
+    //short lived threads, a few at a time and many more than max_threads in total. Each one
+    //exits with slots in its magazine
+    const int waves = 3 * Pool::max_threads / 4;
+    for(int wave = 0; wave < waves; wave++){
+        std::vector<std::thread> threads;
+        for(int t = 0; t < 4; t++){
+            threads.emplace_back([&]{
+                int* mine[allocs_per_thread];
+                for(int i = 0; i < allocs_per_thread; i++) mine[i] = pool.Allocate(i);
+                for(int i = 0; i < allocs_per_thread; i++){
+                    CHECK(mine[i] != nullptr && *mine[i] == i);
+                    pool.Free(mine[i]);
+                }
+            });
+        }
+        for(std::thread& thread : threads) thread.join();
+    }
+    CHECK(DrainPool(pool) == capacity);
+
+    //more than max_threads alive at once, the ones past it go straight to the global stack
+    const int crowd = Pool::max_threads + 16;
+    std::atomic<int> started{0};
+    std::vector<std::thread> threads;
+    for(int t = 0; t < crowd; t++){
+        threads.emplace_back([&]{
+            int* first = pool.Allocate(1);
+            started.fetch_add(1);
+            while(started.load() < crowd) std::this_thread::yield();
+            int* second = pool.Allocate(2);
+            CHECK(first != nullptr && second != nullptr && *first == 1 && *second == 2);
+            pool.Free(first);
+            pool.Free(second);
+        });
+    }
+    for(std::thread& thread : threads) thread.join();
+    CHECK(DrainPool(pool) == capacity);
+
+    //a pool made after the threads are gone starts with nothing in any magazine
+    Pool second_pool(capacity, 1);
+    CHECK(DrainPool(second_pool) == capacity);
+}
+
+/* SLOT MAP */
+
+struct ThrowsOnRequest {
+    int value;
+    explicit ThrowsOnRequest(int value, bool throws = false) : value(value) {
+        if(throws) throw value;
+    }
+};
+
+void TestSlotMap(){
+    printf("slotmap\n");
+    using Map = SlotMap<int>;
+
+    //the same slot over and over, until it runs out of generations
+    Map map;
+    Map::Handle first = map.Insert(0);
+    CHECK(first.Generation() == 1);
+    Map::Handle last = first;
+    uint32_t removes = 0;
+    while(last.Index() == first.Index()){
+        CHECK(map.Remove(last));
+        CHECK(!map.IsValid(first) && map.Get(first) == nullptr);
+        removes++;
+        last = map.Insert((int)removes);
+        CHECK(*map.Get(last) == (int)removes);
+    }
+    //every generation was used once, then the slot was retired instead of wrapping to 1
+    CHECK(removes == (1u << Map::generation_bits) - 1);
+    CHECK(last.Index() != first.Index());
+    CHECK(!map.IsValid(first) && !map.Remove(first));
+    CHECK(map.Size() == 1);
+
+    //a throwing constructor neither leaks the free slot nor leaves a half inserted object
+    SlotMap<ThrowsOnRequest> throwing;
+    throwing.Insert(0);
+    SlotMap<ThrowsOnRequest>::Handle removed = throwing.Insert(1);
+    throwing.Insert(2);
+    CHECK(throwing.Remove(removed));
+    for(int attempt = 0; attempt < 2; attempt++){
+        bool threw = false;
+        try {
+            throwing.Insert(99, true);
+        } catch(int) {
+            threw = true;
+        }
+        CHECK(threw);
+        CHECK(throwing.Size() == 2);
+    }
+    SlotMap<ThrowsOnRequest>::Handle reused = throwing.Insert(7);
+    CHECK(reused.Index() == removed.Index() && reused.Generation() == removed.Generation() + 1);
+    int sum = 0;
+    for(ThrowsOnRequest& object : throwing) sum += object.value;
+    CHECK(throwing.Size() == 3 && sum == 0 + 2 + 7);
+}
+
+/* STD ADAPTERS */
+
+// Passes everything on to new/delete and counts what went through it
+class CountingResource : public std::pmr::memory_resource {
+public:
+    size_t allocations = 0;
+    size_t live_bytes = 0;
+
+private:
+    void* do_allocate(size_t bytes, size_t alignment) override {
+        allocations++;
+        live_bytes += bytes;
+        return std::pmr::new_delete_resource()->allocate(bytes, alignment);
+    }
+    void do_deallocate(void* mem, size_t bytes, size_t alignment) override {
+        live_bytes -= bytes;
+        std::pmr::new_delete_resource()->deallocate(mem, bytes, alignment);
+    }
+    bool do_is_equal(std::pmr::memory_resource const& other) const noexcept override {
+        return this == &other;
+    }
+};
+
+bool InArena(LinearAlloc& arena, const void* p){
+    return (const char*)p >= arena.Data() && (const char*)p < arena.Data() + arena.BytesUsed();
+}
+
+void TestStdAdapters(){
+    printf("pmr\n");
+
+    //everything out of the frame arena, nothing given back until the Reset()
+    LinearAlloc frame(1024 * 1024);
+    LinearMemoryResource frame_resource(frame);
+    {
+        std::pmr::vector<int> numbers(&frame_resource);
+        for(int i = 0; i < 1000; i++) numbers.push_back(i);
+        CHECK(InArena(frame, numbers.data()) && numbers[999] == 999);
+
+        std::pmr::unordered_map<int, int> squares(&frame_resource);
+        for(int i = 0; i < 100; i++) squares[i] = i * i;
+        CHECK(squares.size() == 100 && squares[9] == 81);
+        CHECK(InArena(frame, &squares[50]));
+
+        std::vector<int, LinearStlAllocator<int>> classic{LinearStlAllocator<int>(frame)};
+        classic.assign(100, 5);
+        CHECK(InArena(frame, classic.data()) && classic[99] == 5);
+    }
+    size_t used = frame.BytesUsed();
+    CHECK(used >= 1000 * sizeof(int));
+    frame.Reset();
+
+    //list nodes fit a block, the unordered_map's bucket array and over aligned requests don't
+    CountingResource upstream;
+    {
+        PoolMemoryResource<64> node_pool(256, &upstream);
+        std::pmr::list<int> list(&node_pool);
+        for(int i = 0; i < 500; i++) list.push_back(i);
+        list.remove_if([](int i){ return i % 2 == 0; });
+        for(int i = 0; i < 250; i++) list.push_front(-i);
+        CHECK(list.size() == 500 && upstream.allocations == 0);
+
+        std::pmr::unordered_map<int, int> map(&node_pool);
+        for(int i = 0; i < 500; i++) map[i] = -i;
+        CHECK(map[321] == -321);
+        CHECK(upstream.allocations > 0); //the buckets
+        size_t buckets_only = upstream.allocations;
+
+        void* big = node_pool.allocate(65, 8);
+        void* aligned = node_pool.allocate(16, 128);
+        CHECK(upstream.allocations == buckets_only + 2);
+        CHECK((uintptr_t)aligned % 128 == 0);
+        node_pool.deallocate(aligned, 16, 128);
+        node_pool.deallocate(big, 65, 8);
+        CHECK(PoolMemoryResource<64>::FitsBlock(64, alignof(max_align_t)));
+        CHECK(!PoolMemoryResource<64>::FitsBlock(65, 8) && !PoolMemoryResource<64>::FitsBlock(8, 128));
+
+        //the same pool through the classic allocator
+        using NodeAllocator = PoolStlAllocator<int, 64>;
+        std::list<int, NodeAllocator> classic{NodeAllocator(node_pool)};
+        for(int i = 0; i < 100; i++) classic.push_back(i);
+        CHECK(classic.back() == 99 && upstream.allocations == buckets_only + 2);
+        std::list<int, NodeAllocator> copy = classic;
+        CHECK(copy == classic && copy.get_allocator() == classic.get_allocator());
+    }
+    //everything that went upstream came back
+    CHECK(upstream.live_bytes == 0);
+}
+
+/* STACK */
+
+bool IsAligned(const void* p, size_t alignment){
+    return (uintptr_t)p % alignment == 0;
+}
+
+#if HAS_FORK
+// Runs body in a child process and says whether it died of an abort, like a failed assert does
+template<typename Func>
+bool Aborts(Func&& body){
+    fflush(stdout);
+    pid_t child = fork();
+    if(child == 0){
+        freopen("/dev/null", "w", stderr); //the expected assert message is just noise
+        body();
+        _exit(0);
+    }
+    int status = 0;
+    waitpid(child, &status, 0);
+    return WIFSIGNALED(status) && WTERMSIG(status) == SIGABRT;
+}
+#endif
+
+void TestStack(){
+    printf("stack\n");
+    StackAlloc stack(4096);
+
+    //nested, each one aligned and after the one before
+    char* a = stack.Allocate(10);
+    size_t after_a = stack.BytesUsed();
+    char* b = stack.Allocate(100, 64);
+    char* c = stack.Allocate(1, 16);
+    CHECK(a != nullptr && b != nullptr && c != nullptr);
+    CHECK(IsAligned(a, alignof(max_align_t)) && IsAligned(b, 64) && IsAligned(c, 16));
+    CHECK(b >= a + 10 && c >= b + 100);
+    memset(a, 1, 10);
+    memset(b, 2, 100);
+    memset(c, 3, 1);
+
+    //padding for a big alignment right after a 1 byte allocation, and freeing gives all of it back
+    size_t before_padded = stack.BytesUsed();
+    char* padded = stack.Allocate(8, 256);
+    CHECK(IsAligned(padded, 256) && padded > c);
+    stack.Free(padded);
+    CHECK(stack.BytesUsed() == before_padded);
+
+    stack.Free(c);
+    stack.Free(b);
+    CHECK(stack.BytesUsed() == after_a);
+    CHECK(a[0] == 1 && a[9] == 1);
+    CHECK(stack.Allocate(100, 64) == b); //the same spot again
+    stack.Free(b);
+
+    //a marker throws away everything after it, and what is below still frees in order
+    StackAlloc::Marker marker = stack.GetMarker();
+    char* first_after = stack.Allocate(24, 32);
+    for(int i = 0; i < 5; i++) CHECK(stack.Allocate(40, 8 << i) != nullptr);
+    stack.RewindTo(marker);
+    CHECK(stack.BytesUsed() == after_a);
+    CHECK(stack.Allocate(24, 32) == first_after);
+    stack.RewindTo(marker);
+    stack.RewindTo(StackAlloc::Marker{4000, 0}); //from the future, ignored
+    CHECK(stack.BytesUsed() == after_a);
+    stack.Free(a);
+    CHECK(stack.BytesUsed() == 0);
+
+    //out of room, and the failure doesn't break the stack
+    CHECK(stack.Allocate(4096) == nullptr);
+    CHECK(stack.Allocate(4000) != nullptr);
+    stack.Reset();
+    CHECK(stack.BytesUsed() == 0);
+
+#if HAS_FORK && !defined(NDEBUG)
+    CHECK(Aborts([]{
+        StackAlloc out_of_order(256);
+        char* older = out_of_order.Allocate(8);
+        out_of_order.Allocate(8);
+        out_of_order.Free(older);
+    }));
+    CHECK(!Aborts([]{
+        StackAlloc in_order(256);
+        char* older = in_order.Allocate(8);
+        char* newer = in_order.Allocate(8);
+        in_order.Free(newer);
+        in_order.Free(older);
+    }));
+#endif
+}
+
+/* POOL */
+
+template<typename Pool>
+void ClearAndRefill(Pool& pool, size_t count){
+    std::vector<uint64_t*> objects(count);
+    CHECK(pool.AllocateN(objects.data(), count, 7) == count);
+    size_t capacity = pool.Capacity();
+    pool.Clear();
+    CHECK(pool.ObjectsAllocated() == 0);
+    //every slot comes back, none of them twice, and the pool didn't grow for it
+    std::vector<uint64_t*> again(count);
+    CHECK(pool.AllocateN(again.data(), count, 9) == count);
+    CHECK(pool.Capacity() == capacity);
+    std::sort(objects.begin(), objects.end());
+    std::sort(again.begin(), again.end());
+    CHECK(objects == again);
+    pool.FreeN(again.data(), count);
+    CHECK(pool.ObjectsAllocated() == 0);
+}
+
+// Threads allocate and FreeN into one pool at the same time, after that the live bitmap has
+// to show exactly the objects they kept
+template<typename Pool>
+void TrackedFreeFromThreads(){
+    Pool pool(256);
+    const int thread_count = 4;
+    const size_t per_round = 300;
+    std::vector<std::vector<uint64_t*>> kept(thread_count);
+    std::vector<std::thread> threads;
+    for(int t = 0; t < thread_count; t++){
+        threads.emplace_back([&pool, &kept, t]{
+            std::vector<uint64_t*> objects(per_round), freed;
+            for(int round = 0; round < 50; round++){
+                size_t got = pool.AllocateN(objects.data(), per_round, (uint64_t)t);
+                CHECK(got == per_round);
+                freed.clear();
+                for(size_t i = 0; i < got; i++){
+                    //keep a few, the slots next to them are freed by other threads
+                    if(i % 50 == (size_t)t) kept[t].push_back(objects[i]);
+                    else freed.push_back(objects[i]);
+                }
+                pool.FreeN(freed.data(), freed.size());
+            }
+        });
+    }
+    for(std::thread& thread : threads) thread.join();
+
+    std::vector<uint64_t*> live, visited;
+    for(int t = 0; t < thread_count; t++) live.insert(live.end(), kept[t].begin(), kept[t].end());
+    for(uint64_t& object : pool) visited.push_back(&object);
+    std::sort(live.begin(), live.end());
+    std::sort(visited.begin(), visited.end());
+    CHECK(visited == live && pool.ObjectsAllocated() == live.size());
+}
+
+void TestPool(){
+    printf("pool\n");
+    PoolAlloc<uint64_t, NoChecks, SingleThreaded> single(256);
+    ClearAndRefill(single, 256 * 3);
+    PoolAlloc<uint64_t, NoChecks, LockFree> lock_free(256);
+    for(int round = 0; round < 3; round++) ClearAndRefill(lock_free, 256 * 3);
+
+    //live objects spread out with whole empty words and an empty chunk in between
+    using TrackedPool = PoolAlloc<uint64_t, NoChecks, SingleThreaded, ChunkedGrowth, LiveBitmap>;
+    TrackedPool tracked(500);
+    size_t capacity = tracked.Capacity();
+    std::vector<uint64_t*> objects(capacity * 4);
+    CHECK(tracked.AllocateN(objects.data(), objects.size(), 0) == objects.size());
+    std::vector<uint64_t*> live;
+    for(size_t i = 0; i < objects.size(); i++){
+        bool keep = (i % 200 < 3 || i % 200 == 130) && (i < capacity || i >= capacity * 2);
+        if(keep) live.push_back(objects[i]);
+        else tracked.Free(objects[i]);
+    }
+    live.push_back(tracked.Allocate(1)); //back into one of the freed slots
+    std::vector<uint64_t*> visited;
+    for(uint64_t& object : tracked) visited.push_back(&object);
+    std::sort(live.begin(), live.end());
+    std::sort(visited.begin(), visited.end());
+    CHECK(!live.empty() && visited == live);
+    tracked.Clear();
+    CHECK(tracked.begin() == tracked.end());
+
+    TrackedFreeFromThreads<PoolAlloc<uint64_t, NoChecks, MutexLocked, ChunkedGrowth, LiveBitmap>>();
+
+#if HAS_FORK
+    CHECK(Aborts([]{
+        PoolAlloc<uint64_t, DebugChecks> checked(64);
+        uint64_t* stale = checked.Allocate(1);
+        checked.Clear();
+        checked.Free(stale);
+    }));
+    CHECK(!Aborts([]{
+        PoolAlloc<uint64_t, DebugChecks> checked(64);
+        checked.Clear();
+        checked.Free(checked.Allocate(1));
+    }));
+#endif
+}
+
+/* TLSF */
+
+bool Overlap(const char* a, size_t a_size, const char* b, size_t b_size){
+    return a < b + b_size && b < a + a_size;
+}
+
+void TestTlsf(){
+    printf("tlsf\n");
+    const size_t heap_size = 1024 * 1024;
+    std::vector<char> memory(heap_size);
+    TlsfAlloc heap(memory.data(), memory.size());
+
+    char* a = (char*)heap.Allocate(100);
+    char* b = (char*)heap.Allocate(200);
+    char* c = (char*)heap.Allocate(3000);
+    CHECK(a != nullptr && b != nullptr && c != nullptr);
+    CHECK(IsAligned(a, 16) && IsAligned(b, 16) && IsAligned(c, 16));
+    CHECK(!Overlap(a, 100, b, 200) && !Overlap(b, 200, c, 3000) && !Overlap(a, 100, c, 3000));
+    memset(a, 1, 100);
+    memset(b, 2, 200);
+    memset(c, 3, 3000);
+
+    //a freed block is found again for the same size, the big rest of the heap isn't split instead
+    heap.Free(b);
+    CHECK(heap.Allocate(200) == b);
+    CHECK(a[99] == 1 && c[0] == 3 && c[2999] == 3);
+
+    //a and c first, then b in between merges with both, and that with the rest of the heap
+    heap.Free(a);
+    heap.Free(c);
+    CHECK(heap.BytesUsed() != 0);
+    heap.Free(b);
+    CHECK(heap.BytesUsed() == 0);
+    //bigger than a b and c together, so only the merged block can start at a
+    char* merged = (char*)heap.Allocate(4000);
+    CHECK(merged == a);
+    heap.Free(merged);
+    char* half = (char*)heap.Allocate(heap_size / 2);
+    CHECK(half == a);
+    heap.Free(half);
+    CHECK(heap.Allocate(heap_size * 2) == nullptr);
+
+    //over aligned, the piece in front of each one is split off as a free block
+    std::vector<char*> aligned;
+    for(size_t align : {32, 64, 256, 4096}){
+        for(int i = 0; i < 3; i++){
+            char* p = (char*)heap.Allocate(24 + i * 40, align);
+            CHECK(p != nullptr && IsAligned(p, align));
+            if(p != nullptr) memset(p, 4, 24 + i * 40);
+            aligned.push_back(p);
+        }
+    }
+    for(size_t i = 0; i < aligned.size(); i += 2) heap.Free(aligned[i]);
+    for(size_t i = 1; i < aligned.size(); i += 2) heap.Free(aligned[i]);
+    //and all of those pieces merged back together
+    CHECK(heap.BytesUsed() == 0);
+    CHECK(heap.Allocate(heap_size / 2) == a);
+}
+
+/* SMALL OBJECTS */
+
+void TestSmallObjects(){
+    printf("small\n");
+    const size_t bytes_per_class = 64 * 1024;
+    SmallObjectAlloc small(bytes_per_class);
+
+    //the first 16 byte block is at the very start of the region, each class has the next share
+    char* first = (char*)small.Allocate(16);
+    const char* region = first - 64; //no further in than a debug header
+    auto ClassOf = [&](const void* p){
+        size_t offset = (size_t)((const char*)p - region);
+        return offset < bytes_per_class * 8 ? (int)(offset / bytes_per_class) : -1;
+    };
+    CHECK(ClassOf(first) == 0);
+
+    struct Routing { size_t size; int size_class; };
+    const Routing routes[] = {
+        {0, 0}, {1, 0}, {16, 0}, {17, 1}, {32, 1}, {33, 2}, {48, 2}, {49, 3}, {64, 3}, {65, 4},
+        {96, 4}, {97, 5}, {128, 5}, {129, 6}, {192, 6}, {193, 7}, {256, 7}, {257, -1}, {4096, -1},
+    };
+    std::vector<char*> blocks;
+    for(Routing const& route : routes){
+        char* p = (char*)small.Allocate(route.size);
+        CHECK(p != nullptr && IsAligned(p, 16) && ClassOf(p) == route.size_class);
+        if(p != nullptr) memset(p, (int)blocks.size(), route.size);
+        blocks.push_back(p);
+    }
+    for(size_t i = 0; i < blocks.size(); i++){
+        CHECK(routes[i].size == 0 || (blocks[i][0] == (char)i && blocks[i][routes[i].size - 1] == (char)i));
+    }
+    //a freed block is the next one handed out from its class
+    small.Free(blocks[6]);
+    CHECK(small.Allocate(40) == blocks[6]);
+    for(char* p : blocks) small.Free(p);
+    small.Free(first);
+
+    //filling up the 256 byte class spills over to malloc, and both kinds free the same way
+    std::vector<char*> spilled;
+    size_t from_malloc = 0;
+    for(size_t i = 0; i < bytes_per_class / 256 + 16; i++){
+        char* p = (char*)small.Allocate(200);
+        CHECK(p != nullptr);
+        if(p == nullptr) break;
+        if(ClassOf(p) == -1) from_malloc++;
+        else CHECK(ClassOf(p) == 7);
+        memset(p, 7, 200);
+        spilled.push_back(p);
+    }
+    CHECK(from_malloc >= 16);
+    for(char* p : spilled) small.Free(p);
+    CHECK(ClassOf(small.Allocate(200)) == 7);
+}
+
+/* COMPACTING POOL */
+
+void TestCompactingPool(){
+    printf("compacting\n");
+    using Pool = CompactingPool<int>;
+
+    //handles find their object until it is destroyed, and never again after that
+    Pool pool(256);
+    std::vector<Pool::Handle> handles;
+    for(int i = 0; i < 200; i++) handles.push_back(pool.Create(i));
+    for(int i = 0; i < 200; i++) CHECK(pool.IsValid(handles[i]) && *pool.Get(handles[i]) == i);
+    CHECK(!pool.IsValid(Pool::Handle{}) && pool.Get(Pool::Handle{}) == nullptr);
+    for(int i = 0; i < 200; i += 3) CHECK(pool.Destroy(handles[i]));
+    for(int i = 0; i < 200; i += 3){
+        CHECK(!pool.IsValid(handles[i]) && pool.Get(handles[i]) == nullptr && !pool.Destroy(handles[i]));
+    }
+    //a new object in a destroyed one's handle entry doesn't bring the old handle back
+    Pool::Handle reused = pool.Create(1000);
+    CHECK(reused.Index() == handles[198].Index() && reused.Generation() == handles[198].Generation() + 1);
+    CHECK(!pool.IsValid(handles[198]) && *pool.Get(reused) == 1000);
+    handles[198] = reused;
+
+    //compaction packs the pool without losing or mixing up anything
+    CHECK(!pool.IsCompact());
+    pool.CompactSteps(1000);
+    CHECK(pool.IsCompact() && pool.Span() == pool.Size());
+    int sum = 0, expected_sum = 1000;
+    for(int i = 0; i < 200; i++){
+        if(i % 3 == 0 && i != 198) continue;
+        expected_sum += i == 198 ? 0 : i;
+        CHECK(pool.IsValid(handles[i]) && *pool.Get(handles[i]) == (i == 198 ? 1000 : i));
+    }
+    pool.ForEach([&](int& value){
+        sum += value;
+        CHECK(pool.Get(pool.HandleOf(value)) == &value);
+    });
+    CHECK(sum == expected_sum);
+
+    //the same handle entry over and over, until it runs out of generations
+    Pool cycling(4);
+    Pool::Handle first = cycling.Create(0);
+    Pool::Handle last = first;
+    uint32_t destroys = 0;
+    while(last.Index() == first.Index()){
+        CHECK(cycling.Destroy(last));
+        CHECK(!cycling.IsValid(first));
+        destroys++;
+        last = cycling.Create((int)destroys);
+        CHECK(cycling.Get(last) != nullptr && *cycling.Get(last) == (int)destroys);
+    }
+    //every generation was used once, then the entry was retired instead of wrapping to 1
+    CHECK(destroys == (1u << Pool::generation_bits) - 1);
+    CHECK(!cycling.IsValid(first) && !cycling.Destroy(first));
+    CHECK(cycling.Size() == 1);
+
+    //a throwing constructor neither leaks the free handle entry nor leaves a live slot behind
+    CompactingPool<ThrowsOnRequest> throwing(8);
+    throwing.Create(0);
+    CompactingPool<ThrowsOnRequest>::Handle destroyed = throwing.Create(1);
+    throwing.Create(2);
+    CHECK(throwing.Destroy(destroyed));
+    for(int attempt = 0; attempt < 2; attempt++){
+        bool threw = false;
+        try {
+            throwing.Create(99, true);
+        } catch(int) {
+            threw = true;
+        }
+        CHECK(threw);
+        CHECK(throwing.Size() == 2 && throwing.Span() == 3);
+    }
+    CompactingPool<ThrowsOnRequest>::Handle again = throwing.Create(7);
+    CHECK(again.Index() == destroyed.Index() && again.Generation() == destroyed.Generation() + 1);
+    int values = 0;
+    throwing.ForEach([&](ThrowsOnRequest& object){ values += object.value; });
+    CHECK(throwing.Size() == 3 && values == 0 + 2 + 7);
+}
+
+/* ARENA SNAPSHOT */
+
+struct alignas(64) SnapshotTable {
+    float values[16];
+};
+
+struct SnapshotNode {
+    uint32_t id = 0;
+    OffsetPtr<SnapshotNode> left;
+    OffsetPtr<SnapshotNode> right;
+    OffsetPtr<const char> name;
+    OffsetPtr<SnapshotTable> table;
+};
+
+// Builds a little tree, every node with its own name and table
+SnapshotNode* BuildSnapshotTree(LinearAlloc& arena, uint32_t id, int depth){
+    SnapshotNode* node = arena.Create<SnapshotNode>();
+    node->id = id;
+    char* name = arena.CreateArray<char>(16);
+    snprintf(name, 16, "node %u", id);
+    node->name = name;
+    SnapshotTable* table = arena.Create<SnapshotTable>();
+    for(int i = 0; i < 16; i++) table->values[i] = (float)(id * 16 + i);
+    node->table = table;
+    if(depth > 0){
+        node->left = BuildSnapshotTree(arena, id * 2, depth - 1);
+        node->right = BuildSnapshotTree(arena, id * 2 + 1, depth - 1);
+    }
+    return node;
+}
+
+// Walks the tree like BuildSnapshotTree() made it, counting the nodes that are right
+int CheckSnapshotTree(const SnapshotNode* node, uint32_t id, int depth){
+    char name[16];
+    snprintf(name, sizeof(name), "node %u", id);
+    bool right = node->id == id && strcmp(node->name.Get(), name) == 0 &&
+        IsAligned(node->table.Get(), 64) && node->table->values[15] == (float)(id * 16 + 15);
+    if(depth == 0) return right && !node->left && !node->right;
+    return right + CheckSnapshotTree(node->left.Get(), id * 2, depth - 1) +
+        CheckSnapshotTree(node->right.Get(), id * 2 + 1, depth - 1);
+}
+
+void WriteFileBytes(const char* path, std::vector<char> const& bytes){
+    FILE* file = fopen(path, "wb");
+    if(file == nullptr) return;
+    fwrite(bytes.data(), 1, bytes.size(), file);
+    fclose(file);
+}
+
+void TestArenaSnapshot(){
+    printf("snapshot\n");
+    const char* path = "allocator_tests_snapshot.bin";
+    const int depth = 6;
+    const int node_count = (1 << (depth + 1)) - 1;
+    std::vector<char> file_bytes;
+    {
+        LinearAlloc arena(1024 * 1024);
+        arena.Allocate(8); //the root doesn't have to be the first thing in the arena
+        SnapshotNode* root = BuildSnapshotTree(arena, 1, depth);
+        CHECK(CheckSnapshotTree(root, 1, depth) == node_count);
+        //a copied OffsetPtr still points at the same node, not the same distance away
+        SnapshotNode copy = *root;
+        CHECK(copy.left.Get() == root->left.Get() && copy.name.Get() == root->name.Get());
+
+        SnapshotNode outside;
+        CHECK(!SaveArenaSnapshot(path, arena, &outside, 3));
+        CHECK(SaveArenaSnapshot(path, arena, root, 3));
+
+        ArenaSnapshot snapshot(path, 3);
+        CHECK(snapshot.Loaded() && snapshot.Error() == nullptr && snapshot.Size() == arena.BytesUsed());
+        //the arena is still there, so the mapping is at another address
+        const SnapshotNode* loaded = snapshot.Root<SnapshotNode>();
+        CHECK(loaded != nullptr && (const char*)loaded != (const char*)root);
+        CHECK(loaded != nullptr && CheckSnapshotTree(loaded, 1, depth) == node_count);
+        CHECK(loaded != nullptr && loaded->left.Get() >= (const SnapshotNode*)snapshot.Data() &&
+            (const char*)loaded->left.Get() < snapshot.Data() + snapshot.Size());
+
+        FILE* file = fopen(path, "rb");
+        if(file != nullptr){
+            char buffer[4096];
+            size_t read;
+            while((read = fread(buffer, 1, sizeof(buffer), file)) > 0) file_bytes.insert(file_bytes.end(), buffer, buffer + read);
+            fclose(file);
+        }
+    }
+
+    //skipping the checksum loads the same
+    ArenaSnapshot unchecked(path, 3, false);
+    CHECK(unchecked.Root<SnapshotNode>() != nullptr && CheckSnapshotTree(unchecked.Root<SnapshotNode>(), 1, depth) == node_count);
+
+    //turned down: another data version, a flipped byte, a cut off file, not a snapshot at all
+    ArenaSnapshot old_version(path, 2);
+    CHECK(!old_version.Loaded() && old_version.Error() != nullptr && old_version.Root<SnapshotNode>() == nullptr);
+
+    std::vector<char> corrupted = file_bytes;
+    corrupted[corrupted.size() - 100] ^= 1;
+    WriteFileBytes(path, corrupted);
+    CHECK(!ArenaSnapshot(path, 3).Loaded() && ArenaSnapshot(path, 3, false).Loaded());
+
+    WriteFileBytes(path, std::vector<char>(file_bytes.begin(), file_bytes.end() - 1));
+    CHECK(!ArenaSnapshot(path, 3, false).Loaded());
+    WriteFileBytes(path, std::vector<char>(file_bytes.begin(), file_bytes.begin() + 32));
+    CHECK(!ArenaSnapshot(path, 3, false).Loaded());
+    WriteFileBytes(path, std::vector<char>(256, 'x'));
+    CHECK(!ArenaSnapshot(path, 3, false).Loaded());
+
+    CHECK(!ArenaSnapshot("allocator_tests_missing.bin", 3).Loaded());
+    remove(path);
+}
+
+/* RING */
+
+void TestRing(){
+    printf("ring\n");
+    CpuFence fence;
+    alignas(64) static char memory[1024];
+    RingAlloc<> ring(memory, sizeof(memory), fence);
+
+    char* one = ring.Allocate(300, 1);
+    char* two = ring.Allocate(300, 2);
+    char* three = ring.Allocate(300, 3);
+    CHECK(one == memory && two != nullptr && three != nullptr);
+    CHECK(two >= one + 300 && three >= two + 300 && three + 300 <= memory + sizeof(memory));
+    memset(two, 2, 300);
+    memset(three, 3, 300);
+    CHECK(ring.PendingFences() == 3);
+
+    //nothing has completed, so there is no room
+    CHECK(ring.Allocate(300, 4) == nullptr);
+    CHECK(ring.BytesUsed() >= 900);
+
+    //fence 1 frees the start, the next one doesn't fit at the end and wraps around to it whole
+    fence.Signal(1);
+    char* four = ring.Allocate(300, 4);
+    CHECK(four == one && ring.OffsetOf(four) == 0);
+    memset(four, 4, 300);
+    CHECK(two[0] == 2 && two[299] == 2 && three[0] == 3 && three[299] == 3);
+    CHECK(ring.PendingFences() == 3);
+
+    //fence 3 covers 2 as well, the skipped end of the buffer comes back with them
+    fence.Signal(3);
+    size_t used = ring.BytesUsed();
+    size_t reclaimed = ring.Reclaim();
+    CHECK(ring.BytesUsed() == used - reclaimed && ring.PendingFences() == 1);
+    CHECK(four[0] == 4 && four[299] == 4);
+    fence.Signal(4);
+    ring.Reclaim();
+    CHECK(ring.BytesUsed() == 0 && ring.PendingFences() == 0);
+
+    //empty again, so it starts over at the top, and alignment is kept
+    char* aligned = ring.Allocate(10, 5, 256);
+    CHECK(aligned != nullptr && IsAligned(aligned, 256) && aligned < memory + 256);
+    CHECK(ring.Allocate(sizeof(memory) + 1, 5) == nullptr);
+    fence.Signal(5);
+
+    //more fences than there is room for: the newest entry takes the later fence over
+    CpuFence few_fence;
+    RingAlloc<> few(1024, few_fence, 2);
+    few.Allocate(100, 1);
+    few.Allocate(100, 2);
+    few.Allocate(100, 3);
+    CHECK(few.PendingFences() == 2);
+    few_fence.Signal(2);
+    few.Reclaim();
+    CHECK(few.PendingFences() == 1 && few.BytesUsed() != 0); //2 is held back until 3 completes
+    few_fence.Signal(3);
+    few.Reclaim();
+    CHECK(few.PendingFences() == 0 && few.BytesUsed() == 0);
+}
+
+int main(int argc, char** argv){
+    const char* only = argc > 1 ? argv[1] : nullptr;
+    auto Run = [&](const char* name){ return only == nullptr || strcmp(only, name) == 0; };
+
+    if(Run("frame")) TestFrame();
+    if(Run("concurrent")) TestConcurrentPool();
+    if(Run("slotmap")) TestSlotMap();
+    if(Run("pmr")) TestStdAdapters();
+    if(Run("stack")) TestStack();
+    if(Run("pool")) TestPool();
+    if(Run("tlsf")) TestTlsf();
+    if(Run("small")) TestSmallObjects();
+    if(Run("compacting")) TestCompactingPool();
+    if(Run("snapshot")) TestArenaSnapshot();
+    if(Run("ring")) TestRing();
+
+    if(failures == 0) printf("all passed\n");
+    else printf("%d checks FAILED\n", failures.load());
+    return failures;
+}
@@ -0,0 +1,231 @@
+/*
+    -- Arena Snapshot --
+
+    Big read-only data structures (navigation meshes, lookup tables, string tables...) tend to
+    get rebuilt from their source data on every startup. If they were built inside a LinearAlloc
+    instead, the arena is one contiguous run of bytes, and those bytes can be written to a file
+    as they are and mapped back in later. Loading then costs a page-in, with no parsing and no
+    pointer fix-ups.
+
+    The catch is pointers. The arena lands at a different address every time it is mapped, so a
+    raw pointer saved in the file points at garbage. OffsetPtr<T> stores the distance from
+    itself to its target instead. Both ends move together, so the distance stays right wherever
+    the bytes end up:
+
+        struct Node {
+            uint32_t id;
+            OffsetPtr<Node> left;
+            OffsetPtr<Node> right;
+            OffsetPtr<const char> name;
+        };
+
+        //build once, in a tool or on first run
+        LinearAlloc arena(64 * 1024 * 1024);
+        Node* root = BuildTree(arena);
+        SaveArenaSnapshot("tree.bin", arena, root, tree_version);
+
+        //every other run
+        ArenaSnapshot snapshot("tree.bin", tree_version);
+        const Node* root = snapshot.Root<Node>();
+        if(root == nullptr){
+            ... stale or missing, rebuild and save again
+        }
+
+    Everything inside the arena has to link with OffsetPtr and nothing may point out of it.
+    Objects keep their alignment (up to 64) because the arena is written at the same offset
+    from a 64 byte boundary as it had in memory.
+
+    The file starts with a header: a magic number (which also catches a file from a machine with
+    the other byte order), the version of this format, a version number of the caller's own
+    choosing, and a checksum of the arena. Bump the data version whenever the structs change and
+    old snapshots are turned down instead of read wrong. Checking the checksum reads the whole
+    file up front. Pass verify_checksum = false to skip it and only page in what gets touched.
+
+    The mapping is read-only, writing through the root is a crash.
+
+    Use case: Precomputed data that is built once and loaded many times.
+*/
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "virtual_memory.h"
+
+// A pointer stored as the distance from itself to the target, so it survives the memory
+// being moved or mapped somewhere else. 0 is null, so it can't point at itself.
+template<typename T>
+class OffsetPtr {
+public:
+    OffsetPtr() = default;
+    OffsetPtr(T* target) { Set(target); }
+
+    //the distance has to be worked out again from the new address
+    OffsetPtr(OffsetPtr const& other) { Set(other.Get()); }
+    OffsetPtr& operator=(OffsetPtr const& other){
+        Set(other.Get());
+        return *this;
+    }
+    OffsetPtr& operator=(T* target){
+        Set(target);
+        return *this;
+    }
+
+    T* Get() const {
+        if(offset == 0) return nullptr;
+        return (T*)((const char*)this + offset);
+    }
+
+    T* operator->() const { return Get(); }
+    T& operator*() const { return *Get(); }
+    T& operator[](size_t index) const { return Get()[index]; }
+    explicit operator bool() const { return offset != 0; }
+
+private:
+    void Set(T* target){
+        offset = target == nullptr ? 0 : (int64_t)((const char*)target - (const char*)this);
+    }
+
+    int64_t offset = 0; //fixed size so the file layout doesn't depend on the build
+};
+
+/* FILE FORMAT */
+
+struct ArenaSnapshotHeader {
+    static constexpr uint64_t magic_value = 0x544F4853414E5241ull; //"ARNASHOT" in a little endian file
+    static constexpr uint32_t current_format = 1;
+
+    uint64_t magic;
+    uint32_t format_version;
+    uint32_t data_version; //the caller's own version of what is in the arena
+    uint64_t data_offset; //where the arena starts in the file
+    uint64_t data_size;
+    uint64_t root_offset; //from the start of the arena
+    uint64_t checksum; //of the arena bytes
+    uint64_t unused[2];
+};
+static_assert(sizeof(ArenaSnapshotHeader) == 64, "the arena is placed right after the header");
+
+namespace arena_snapshot_detail {
+
+// FNV-1a over 8 bytes at a time instead of 1, a few GB/s. Catches truncated and corrupted
+// files, not tampering.
+inline uint64_t Checksum(const char* data, size_t size){
+    const uint64_t prime = 0x100000001B3ull;
+    uint64_t hash = 0xCBF29CE484222325ull;
+    size_t i = 0;
+    for(; i + 8 <= size; i += 8){
+        uint64_t word;
+        memcpy(&word, data + i, sizeof(word));
+        hash = (hash ^ word) * prime;
+    }
+    for(; i < size; i++){
+        hash = (hash ^ (unsigned char)data[i]) * prime;
+    }
+    return hash ^ size;
+}
+
+// How far past a 64 byte boundary the arena is kept, so objects keep their alignment
+static constexpr size_t max_alignment = 64;
+
+} // namespace arena_snapshot_detail
+
+// Writes [arena.Data(), arena.Data() + arena.BytesUsed()) to path, with root remembered as the
+// object to hand out on load. Returns false if root isn't in the arena or the write fails.
+// Not while another thread is allocating from arena.
+template<typename Alloc, typename T>
+bool SaveArenaSnapshot(const char* path, Alloc const& arena, T const* root, uint32_t data_version){
+    const char* data = arena.Data();
+    size_t size = arena.BytesUsed();
+    if(data == nullptr || (const char*)root < data || (const char*)root + sizeof(T) > data + size){
+        return false;
+    }
+
+    ArenaSnapshotHeader header = {};
+    header.magic = ArenaSnapshotHeader::magic_value;
+    header.format_version = ArenaSnapshotHeader::current_format;
+    header.data_version = data_version;
+    header.data_offset = sizeof(header) + (uintptr_t)data % arena_snapshot_detail::max_alignment;
+    header.data_size = size;
+    header.root_offset = (uint64_t)((const char*)root - data);
+    header.checksum = arena_snapshot_detail::Checksum(data, size);
+
+    FILE* file = fopen(path, "wb");
+    if(file == nullptr){
+        return false;
+    }
+    static const char padding[arena_snapshot_detail::max_alignment] = {};
+    bool written = fwrite(&header, sizeof(header), 1, file) == 1 &&
+        fwrite(padding, 1, header.data_offset - sizeof(header), file) == header.data_offset - sizeof(header) &&
+        fwrite(data, 1, size, file) == size;
+    return fclose(file) == 0 && written;
+}
+
+// A snapshot mapped back into memory. Stays mapped until it is destroyed, every pointer
+// into it dies with it.
+class ArenaSnapshot {
+public:
+    ArenaSnapshot(const char* path, uint32_t data_version, bool verify_checksum = true){
+        mapping = (char*)virtual_memory::MapFile(path, &mapping_size);
+        if(mapping == nullptr){
+            error = "couldn't open or map the file";
+            return;
+        }
+        error = Validate(data_version, verify_checksum);
+        if(error != nullptr){
+            virtual_memory::UnmapFile(mapping, mapping_size);
+            mapping = nullptr;
+            mapping_size = 0;
+        }
+    }
+    ~ArenaSnapshot(){
+        if(mapping != nullptr) virtual_memory::UnmapFile(mapping, mapping_size);
+    }
+
+    //owns the mapping
+    ArenaSnapshot(ArenaSnapshot const&) = delete;
+    ArenaSnapshot& operator=(ArenaSnapshot const&) = delete;
+
+    // The object passed to SaveArenaSnapshot(), nullptr if loading failed.
+    // T has to be the type it was saved as.
+    template<typename T>
+    const T* Root() const {
+        if(mapping == nullptr) return nullptr;
+        const ArenaSnapshotHeader& header = Header();
+        if(header.data_size - header.root_offset < sizeof(T)) return nullptr;
+        return (const T*)(Data() + header.root_offset);
+    }
+
+    bool Loaded() const { return mapping != nullptr; }
+    // Why loading failed, nullptr if it didn't
+    const char* Error() const { return error; }
+
+    const char* Data() const { return mapping != nullptr ? mapping + Header().data_offset : nullptr; }
+    size_t Size() const { return mapping != nullptr ? (size_t)Header().data_size : 0; }
+
+private:
+    const ArenaSnapshotHeader& Header() const { return *(const ArenaSnapshotHeader*)mapping; }
+
+    const char* Validate(uint32_t data_version, bool verify_checksum) const {
+        if(mapping_size < sizeof(ArenaSnapshotHeader)) return "file is too small to be a snapshot";
+        const ArenaSnapshotHeader& header = Header();
+        if(header.magic != ArenaSnapshotHeader::magic_value) return "not a snapshot, or the other byte order";
+        if(header.format_version != ArenaSnapshotHeader::current_format) return "snapshot format version doesn't match";
+        if(header.data_version != data_version) return "data version doesn't match";
+        if(header.data_offset < sizeof(header) || header.data_offset > mapping_size ||
+           header.data_size > mapping_size - header.data_offset){
+            return "file is truncated";
+        }
+        if(header.root_offset >= header.data_size) return "root is outside the arena";
+        if(verify_checksum && arena_snapshot_detail::Checksum(Data(), (size_t)header.data_size) != header.checksum){
+            return "checksum doesn't match, the file is corrupted";
+        }
+        return nullptr;
+    }
+
+    char* mapping = nullptr;
+    size_t mapping_size = 0;
+    const char* error = nullptr;
+};
@@ -0,0 +1,322 @@
+/*
+    -- Compacting Pool --
+
+    A pool addressed through handles instead of pointers, so it is free to move its objects
+    around. After a lot of creating and destroying, the live objects end up spread over the
+    whole pool with holes in between, and walking over them touches far more cache lines than
+    there are objects. Compact() slides them back together:
+
+        before  [ A | . | B | . | . | C | . | D ]
+        after   [ A | D | B | C | . | . | . | . ]
+
+    Each step moves the highest live object into the lowest hole with its move constructor and
+    points its handle at the new slot. Only the objects past the hole line move, the ones already
+    in place stay where they are.
+
+    Compaction is incremental: Compact(budget) stops once the time budget is used up and carries
+    on from there on the next call, so a few hundred microseconds a frame is enough to keep a pool
+    tidy without a spike. CompactSteps(n) does the same with a move count instead of a clock.
+
+    Handles work like the ones in SlotMap: 20 bits of index into a handle table, 12 bits of
+    generation to catch stale handles. The table says which slot each handle's object is in,
+    and each slot remembers its handle so a move can update it. Like in SlotMap, a handle entry
+    that has used up all its generations is retired instead of starting over at 1.
+
+    An occupancy bitmap tracks which slots are live. Create() takes the lowest free slot, which
+    keeps the pool as packed as it can be without moving anything, and ForEach() skips over
+    whole empty words of the bitmap at a time.
+
+        CompactingPool<Enemy> enemies(4096);
+        CompactingPool<Enemy>::Handle boss = enemies.Create(...);
+        ...
+        enemies.Compact(std::chrono::microseconds(200)); //once a frame
+        enemies.ForEach([](Enemy& e){ e.Update(); });
+        enemies.Get(boss)->health -= 10;
+
+    Pointers returned by Get() are only valid until the next Compact(), keep handles around instead.
+
+    Use case: Long lived objects that get iterated every frame and are created and destroyed in
+    waves, like enemies, projectiles or scene nodes.
+*/
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+#include <chrono>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "alloc_stats.h"
+
+template<typename T>
+class CompactingPool {
+    static_assert(std::is_move_constructible<T>::value, "compaction moves objects between slots");
+
+public:
+    static constexpr uint32_t index_bits = 20; //about a million live objects
+    static constexpr uint32_t generation_bits = 32 - index_bits;
+    static constexpr uint32_t max_objects = (1u << index_bits) - 1;
+
+    struct Handle {
+        uint32_t value = 0; //generation starts at 1, so 0 is never a valid handle
+
+        uint32_t Index() const { return value & max_objects; }
+        uint32_t Generation() const { return value >> index_bits; }
+
+        bool operator==(Handle const& right) const { return value == right.value; }
+        bool operator!=(Handle const& right) const { return value != right.value; }
+    };
+
+    explicit CompactingPool(uint32_t capacity) :
+        capacity(capacity < max_objects ? capacity : max_objects)
+    {
+        objects = (T*)::operator new(sizeof(T) * this->capacity, std::align_val_t(alignof(T)), std::nothrow);
+        if(objects == nullptr) this->capacity = 0;
+        occupied.assign((this->capacity + 63) / 64, 0);
+        slot_to_handle.resize(this->capacity);
+        handles.reserve(this->capacity);
+    }
+    ~CompactingPool(){
+        ForEach([](T& object){ object.~T(); });
+        ::operator delete(objects, std::align_val_t(alignof(T)));
+    }
+
+    CompactingPool(CompactingPool const&) = delete;
+    CompactingPool& operator=(CompactingPool const&) = delete;
+
+    // Returns an invalid handle if the pool is full. If T's constructor throws, the pool is
+    // left as it was.
+    template<typename... Args>
+    Handle Create(Args&&... args){
+        bool new_entry = free_handle == end_of_list;
+        if(count == capacity || (new_entry && handles.size() > max_objects)){
+            stats.RecordFailure();
+            return Handle{};
+        }
+        uint32_t slot = LowestFreeSlot();
+
+        //the object first, the handle table is only touched once it is there
+        new (&objects[slot]) T(std::forward<Args>(args)...);
+        uint32_t handle_index;
+        if(new_entry){
+            handle_index = (uint32_t)handles.size();
+            try {
+                handles.push_back(HandleEntry{0, 1});
+            } catch(...) {
+                objects[slot].~T();
+                throw;
+            }
+        } else {
+            handle_index = free_handle;
+            free_handle = handles[handle_index].slot_or_next_free;
+        }
+
+        SetOccupied(slot);
+        slot_to_handle[slot] = handle_index;
+        handles[handle_index].slot_or_next_free = slot;
+        count++;
+        stats.RecordAlloc(sizeof(T));
+        return MakeHandle(handle_index, handles[handle_index].generation);
+    }
+
+    // Returns false if the handle was already stale
+    bool Destroy(Handle handle){
+        if(!IsValid(handle)) return false;
+
+        HandleEntry& entry = handles[handle.Index()];
+        uint32_t slot = entry.slot_or_next_free;
+        objects[slot].~T();
+        ClearOccupied(slot);
+        count--;
+        stats.RecordFree(sizeof(T));
+
+        //bump the generation so outstanding handles go stale. Wrapping around would make the
+        //oldest ones match again, so an entry out of generations is retired, never to be reused
+        if(entry.generation == max_generation){
+            entry.generation = retired;
+            return true;
+        }
+        entry.generation++;
+        entry.slot_or_next_free = free_handle;
+        free_handle = handle.Index();
+        return true;
+    }
+
+    bool IsValid(Handle handle) const {
+        uint32_t handle_index = handle.Index();
+        return handle.Generation() != retired && handle_index < handles.size() &&
+            handles[handle_index].generation == handle.Generation();
+    }
+
+    // nullptr for stale handles
+    T* Get(Handle handle){
+        if(!IsValid(handle)) return nullptr;
+        return &objects[handles[handle.Index()].slot_or_next_free];
+    }
+    const T* Get(Handle handle) const {
+        if(!IsValid(handle)) return nullptr;
+        return &objects[handles[handle.Index()].slot_or_next_free];
+    }
+
+    // Moves at most max_moves objects, returns how many it moved
+    size_t CompactSteps(size_t max_moves){
+        size_t moved = 0;
+        while(moved < max_moves && CompactStep()){
+            moved++;
+        }
+        return moved;
+    }
+
+    // Moves objects until the pool is packed or budget has passed, returns how many it moved.
+    // The clock is only read every few moves, so the budget can be overshot by that much.
+    size_t Compact(std::chrono::microseconds budget){
+        using Clock = std::chrono::steady_clock;
+        Clock::time_point deadline = Clock::now() + budget;
+        size_t moved = 0;
+        for(;;){
+            size_t batch = CompactSteps(moves_per_clock_check);
+            moved += batch;
+            if(batch < moves_per_clock_check || Clock::now() >= deadline){
+                return moved;
+            }
+        }
+    }
+
+    // True when the live objects are exactly the first Size() slots
+    bool IsCompact() const { return Span() == count; }
+
+    // One past the highest live slot, what a walk over the pool has to cover
+    size_t Span() const {
+        for(size_t word = live_words; word > 0; word--){
+            if(occupied[word - 1] != 0){
+                return (word - 1) * 64 + FindLastSet(occupied[word - 1]) + 1;
+            }
+        }
+        return 0;
+    }
+
+    // Calls f(T&) on every live object in slot order. f must not Create() or Destroy().
+    template<typename Func>
+    void ForEach(Func&& f){
+        for(size_t word = 0; word < live_words; word++){
+            uint64_t bits = occupied[word];
+            while(bits != 0){
+                f(objects[word * 64 + FindFirstSet(bits)]);
+                bits &= bits - 1; //clear the lowest set bit
+            }
+        }
+    }
+
+    // The handle of a live object, for use inside ForEach()
+    Handle HandleOf(T const& object) const {
+        uint32_t handle_index = slot_to_handle[&object - objects];
+        return MakeHandle(handle_index, handles[handle_index].generation);
+    }
+
+    size_t Size() const { return count; }
+    size_t Capacity() const { return capacity; }
+
+    AllocStats const& Stats() const { return stats; }
+
+private:
+    static constexpr uint32_t end_of_list = 0xFFFFFFFF;
+    static constexpr uint32_t max_generation = (1u << generation_bits) - 1;
+    static constexpr uint32_t retired = 0; //no handle has generation 0, so nothing matches
+    static constexpr size_t moves_per_clock_check = 16;
+
+    struct HandleEntry {
+        uint32_t slot_or_next_free; //slot of the object while alive, next free entry while not
+        uint32_t generation;
+    };
+
+    static Handle MakeHandle(uint32_t handle_index, uint32_t generation){
+        Handle handle;
+        handle.value = (generation << index_bits) | handle_index;
+        return handle;
+    }
+
+    /* BIT TRICKS */
+
+    static int FindFirstSet(uint64_t value){
+#if defined(_MSC_VER)
+        unsigned long index;
+        _BitScanForward64(&index, value);
+        return (int)index;
+#else
+        return __builtin_ctzll(value);
+#endif
+    }
+    static int FindLastSet(uint64_t value){
+#if defined(_MSC_VER)
+        unsigned long index;
+        _BitScanReverse64(&index, value);
+        return (int)index;
+#else
+        return 63 - __builtin_clzll(value);
+#endif
+    }
+
+    /* OCCUPANCY */
+
+    // Only valid when the pool isn't full. Every word before first_free_word is full, so
+    // the search starts there.
+    uint32_t LowestFreeSlot(){
+        while(occupied[first_free_word] == ~(uint64_t)0){
+            first_free_word++;
+        }
+        return (uint32_t)(first_free_word * 64 + FindFirstSet(~occupied[first_free_word]));
+    }
+    uint32_t HighestLiveSlot(){
+        while(occupied[live_words - 1] == 0){
+            live_words--; //only shrinks here, Destroy() leaves it as an upper bound
+        }
+        return (uint32_t)((live_words - 1) * 64 + FindLastSet(occupied[live_words - 1]));
+    }
+
+    void SetOccupied(uint32_t slot){
+        size_t word = slot / 64;
+        occupied[word] |= (uint64_t)1 << (slot % 64);
+        if(word >= live_words) live_words = word + 1;
+    }
+    void ClearOccupied(uint32_t slot){
+        size_t word = slot / 64;
+        occupied[word] &= ~((uint64_t)1 << (slot % 64));
+        if(word < first_free_word) first_free_word = word;
+    }
+
+    // Moves the highest live object into the lowest hole, false once there is nothing to do
+    bool CompactStep(){
+        if(count == 0 || count == capacity) return false;
+        uint32_t hole = LowestFreeSlot();
+        uint32_t last = HighestLiveSlot();
+        if(hole > last) return false; //already packed
+
+        new (&objects[hole]) T(std::move(objects[last]));
+        objects[last].~T();
+        SetOccupied(hole);
+        ClearOccupied(last);
+
+        uint32_t handle_index = slot_to_handle[last];
+        slot_to_handle[hole] = handle_index;
+        handles[handle_index].slot_or_next_free = hole;
+        return true;
+    }
+
+    T* objects;
+    uint32_t capacity;
+    uint32_t count = 0;
+    std::vector<uint64_t> occupied; //a bit per slot, set while it holds an object
+    size_t first_free_word = 0; //every word before this one is full
+    size_t live_words = 0; //every word from this one on is empty
+    std::vector<uint32_t> slot_to_handle;
+    std::vector<HandleEntry> handles;
+    uint32_t free_handle = end_of_list;
+    AllocStats stats;
+};
@@ -0,0 +1,147 @@
+/*
+    -- Concurrent Linear Allocators --
+
+    LinearAlloc keeps its offset in a plain variable, so two threads allocating at once would
+    hand out the same memory. There are two ways around that without a mutex.
+
+    AtomicLinearAlloc: The offset is a std::atomic and Allocate() is a single fetch_add.
+    Every thread bumps the same offset, so there is still some contention on that one cache
+    line, but no thread ever waits on another. Good for a shared scratch buffer that a
+    bunch of jobs write into.
+    BasicLinearAlloc with the LockFree policy does the same with a compare and swap loop, which
+    costs a little more but also works with DebugChecks and VirtualGrowth.
+
+    ThreadLinearArenas: One big block cut into a slice per worker thread, each slice being
+    an ordinary LinearAlloc. A worker only touches its own slice, so there is no sharing at all.
+    ResetAll() clears every slice at once, say at the end of the frame once the jobs are done.
+
+        ThreadLinearArenas arenas(worker_count, 4 * 1024 * 1024);
+        //inside a job running on worker 'worker_index'
+        LinearAlloc& scratch = arenas.ForThread(worker_index);
+        float* temp = scratch.CreateArray<float>(256);
+
+    Use case: Scratch memory for jobs running on many threads at once.
+*/
+
+#pragma once
+
+#include <stdlib.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include <atomic>
+#include <new>
+
+#include "alloc_stats.h"
+#include "linear_alloc.h"
+
+class AtomicLinearAlloc {
+public:
+    AtomicLinearAlloc(size_t total_size) :
+        location(0),
+        total_size(total_size)
+    {
+        data = (char*)malloc(total_size);
+    }
+    ~AtomicLinearAlloc(){
+        free(data);
+    }
+
+    AtomicLinearAlloc(AtomicLinearAlloc const&) = delete;
+    AtomicLinearAlloc& operator=(AtomicLinearAlloc const&) = delete;
+
+    // Sizes get rounded up to min_alignment so that every offset stays aligned to it. Bigger
+    // alignments reserve some padding up front instead, as there is no way to know where
+    // the allocation will land before the fetch_add.
+    char* Allocate(size_t size, size_t alignment = min_alignment){
+        size_t padded = (size + (min_alignment - 1)) & ~(min_alignment - 1);
+        if(alignment > min_alignment){
+            padded += alignment - min_alignment;
+        }
+
+        size_t offset = location.fetch_add(padded, std::memory_order_relaxed);
+        if(data == nullptr || offset > total_size || padded > total_size - offset){
+            stats.RecordFailure();
+            return nullptr; //full, location stays past the end until Reset()
+        }
+        stats.RecordAlloc(padded);
+
+        uintptr_t aligned = ((uintptr_t)(data + offset) + (alignment - 1)) & ~(uintptr_t)(alignment - 1);
+        return (char*)aligned;
+    }
+
+    // Only call once no other thread is allocating anymore
+    void Reset(){
+        stats.RecordReset();
+        location.store(0, std::memory_order_relaxed);
+    }
+
+    size_t BytesUsed() const {
+        size_t used = location.load(std::memory_order_relaxed);
+        return used < total_size ? used : total_size;
+    }
+    size_t Capacity() const { return total_size; }
+
+    ConcurrentAllocStats const& Stats() const { return stats; }
+
+    static constexpr size_t min_alignment = alignof(max_align_t);
+
+private:
+    char* data;
+    std::atomic<size_t> location;
+    size_t total_size;
+    ConcurrentAllocStats stats;
+};
+
+class ThreadLinearArenas {
+public:
+    ThreadLinearArenas(int thread_count, size_t size_per_thread) :
+        thread_count(thread_count)
+    {
+        //round up so the slices are whole cache lines and neighbours don't share one
+        size_per_thread = (size_per_thread + (cache_line - 1)) & ~(cache_line - 1);
+        data = (char*)::operator new(size_per_thread * thread_count, std::align_val_t(cache_line));
+        arenas = (PaddedArena*)::operator new(sizeof(PaddedArena) * thread_count, std::align_val_t(cache_line));
+        for(int i = 0; i < thread_count; i++){
+            new (&arenas[i].alloc) LinearAlloc(data + size_per_thread * i, size_per_thread);
+        }
+    }
+    ~ThreadLinearArenas(){
+        for(int i = 0; i < thread_count; i++){
+            arenas[i].alloc.~LinearAlloc();
+        }
+        ::operator delete(arenas, std::align_val_t(cache_line));
+        ::operator delete(data, std::align_val_t(cache_line));
+    }
+
+    ThreadLinearArenas(ThreadLinearArenas const&) = delete;
+    ThreadLinearArenas& operator=(ThreadLinearArenas const&) = delete;
+
+    // Only the thread with this index may use the returned allocator, each arena
+    // keeps its own Stats()
+    LinearAlloc& ForThread(int thread_index){
+        return arenas[thread_index].alloc;
+    }
+
+    // Only call once all threads are done with their arenas
+    void ResetAll(){
+        for(int i = 0; i < thread_count; i++){
+            arenas[i].alloc.Reset();
+        }
+    }
+
+    int ThreadCount() const { return thread_count; }
+
+private:
+    static constexpr size_t cache_line = 64;
+
+    //each LinearAlloc gets its own cache line so threads bumping their offsets don't
+    //invalidate each other's cache (false sharing)
+    struct alignas(cache_line) PaddedArena {
+        LinearAlloc alloc;
+    };
+
+    char* data;
+    PaddedArena* arenas;
+    int thread_count;
+};
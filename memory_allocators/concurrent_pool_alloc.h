@@ -0,0 +1,328 @@
+/*
+    -- Concurrent Pool Allocator --
+
+    A PoolAlloc that many threads can Allocate() from and Free() into at the same time.
+
+    Global free list: A lock-free stack (a 'Treiber stack') pushed and popped with a compare and
+    swap. The classic trap here is the ABA problem: thread 1 reads head = A and next = B, gets
+    paused, thread 2 pops A, pops B, pushes A back. Thread 1 wakes up, sees head is still A, and its
+    CAS happily installs B which is in use. To catch that, the head is a slot index packed
+    together with a tag that goes up on every change, so a stale CAS always fails.
+
+    Magazines: Hitting the global stack on every call would have all threads fighting over its
+    cache line. Instead every thread keeps a small stack of free slots (a magazine) and only
+    talks to the global stack once it runs empty or overflows. Whole batches of batch_size
+    slots move at a time, linked together, so one CAS moves a whole batch.
+
+    Growth takes a mutex, which is fine as it only happens while the pool is warming up.
+
+    Threads get their magazine through a small per-thread index handed out on first use. When a
+    thread exits, whatever is left in its magazines goes back to the global stack of every pool
+    still alive, and the index is given back for the next thread to use. So any number of
+    threads can come and go, only more than max_threads at the same time is a problem: those
+    past it skip the magazine and use the global stack directly.
+
+    Use Case: Same as PoolAlloc, but with objects created and destroyed from many job threads,
+    like particles or network messages.
+*/
+#pragma once
+
+#include <stdlib.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <new>
+#include <utility>
+#include <vector>
+
+#include "alloc_stats.h"
+
+template<typename T, uint32_t batch_size = 32>
+class ConcurrentPoolAlloc {
+public:
+    static constexpr int max_threads = 64;
+
+    // max_chunks is lowered if that many slots wouldn't fit in a 32 bit index
+    ConcurrentPoolAlloc(uint32_t objects_per_chunk, uint32_t max_chunks = 1024) :
+        objects_per_chunk(RoundUpToBatch(objects_per_chunk)),
+        max_chunks(std::min(max_chunks, invalid_index / this->objects_per_chunk))
+    {
+        chunks = new std::atomic<Slot*>[this->max_chunks];
+        for(uint32_t i = 0; i < this->max_chunks; i++){
+            chunks[i].store(nullptr, std::memory_order_relaxed);
+        }
+        caches = new ThreadCache[max_threads];
+        Threads().Register(this);
+    }
+    // Objects still alive when the pool dies are not destructed, Free() them first. No other
+    // thread may be using the pool anymore.
+    ~ConcurrentPoolAlloc(){
+        Threads().Unregister(this);
+        for(uint32_t i = 0; i < max_chunks; i++){
+            Slot* chunk = chunks[i].load(std::memory_order_relaxed);
+            if(chunk != nullptr){
+                ::operator delete(chunk, std::align_val_t(alignof(Slot)));
+            }
+        }
+        delete[] chunks;
+        delete[] caches;
+    }
+
+    ConcurrentPoolAlloc(ConcurrentPoolAlloc const&) = delete;
+    ConcurrentPoolAlloc& operator=(ConcurrentPoolAlloc const&) = delete;
+
+    // Returns nullptr if the pool is out of slots and can't grow anymore
+    template<typename... Args>
+    T* Allocate(Args&&... args){
+        uint32_t index = PopSlot();
+        if(index == invalid_index){
+            stats.RecordFailure();
+            return nullptr;
+        }
+        stats.RecordAlloc(sizeof(T));
+        return new (SlotAt(index)->storage) T(std::forward<Args>(args)...);
+    }
+
+    // Can be called from any thread, not just the one that allocated elem
+    void Free(T* elem){
+        if(elem == nullptr) return;
+        uint32_t index = ((Slot*)elem)->index;
+        elem->~T();
+        PushSlot(index);
+        stats.RecordFree(sizeof(T));
+    }
+
+    ConcurrentAllocStats const& Stats() const { return stats; }
+
+private:
+    static constexpr uint32_t invalid_index = 0xFFFFFFFF;
+
+    // A free slot holds links instead of an object. 'next' chains the slots inside a batch and
+    // 'next_batch' on the first slot of a batch chains batches in the global stack. 'index' is the
+    // slot's own index so Free() doesn't need to search the chunks for it.
+    struct Slot {
+        alignas(T) alignas(uint32_t) unsigned char storage[sizeof(T) > 8 ? sizeof(T) : 8];
+        uint32_t index;
+    };
+
+    static std::atomic<uint32_t>& NextBatch(Slot* slot){
+        return *(std::atomic<uint32_t>*)slot->storage;
+    }
+    static uint32_t& Next(Slot* slot){
+        return *(uint32_t*)(slot->storage + sizeof(uint32_t));
+    }
+
+    //every thread gets its own cache line
+    struct alignas(64) ThreadCache {
+        uint32_t count = 0;
+        uint32_t slots[batch_size * 2];
+    };
+
+    static uint32_t RoundUpToBatch(uint32_t count){
+        if(count == 0) count = 1;
+        return (count + batch_size - 1) / batch_size * batch_size;
+    }
+
+    /* THREAD INDICES */
+
+    // Hands out the magazine indices and knows every pool of this type, so a thread that exits
+    // can empty its magazines into them
+    struct ThreadRegistry {
+        std::mutex lock;
+        std::vector<int> free_indices;
+        int next_index = 0;
+        std::vector<ConcurrentPoolAlloc*> pools;
+
+        // max_threads when they are all taken
+        int Acquire(){
+            std::lock_guard<std::mutex> guard(lock);
+            if(!free_indices.empty()){
+                int index = free_indices.back();
+                free_indices.pop_back();
+                return index;
+            }
+            return next_index < max_threads ? next_index++ : max_threads;
+        }
+        void Release(int index){
+            if(index >= max_threads) return;
+            std::lock_guard<std::mutex> guard(lock);
+            for(ConcurrentPoolAlloc* pool : pools){
+                pool->FlushCache(pool->caches[index]);
+            }
+            free_indices.push_back(index);
+        }
+        void Register(ConcurrentPoolAlloc* pool){
+            std::lock_guard<std::mutex> guard(lock);
+            pools.push_back(pool);
+        }
+        void Unregister(ConcurrentPoolAlloc* pool){
+            std::lock_guard<std::mutex> guard(lock);
+            pools.erase(std::find(pools.begin(), pools.end(), pool));
+        }
+    };
+
+    // Never destroyed, threads can still exit after the statics are gone
+    static ThreadRegistry& Threads(){
+        static ThreadRegistry* registry = new ThreadRegistry;
+        return *registry;
+    }
+
+    // Holds on to this thread's index until the thread exits
+    struct ThreadIndex {
+        int index = Threads().Acquire();
+        ~ThreadIndex(){ Threads().Release(index); }
+    };
+
+    static int ThisThreadIndex(){
+        thread_local ThreadIndex thread;
+        return thread.index;
+    }
+
+    // Gives every slot in cache back to the global stack, as one batch
+    void FlushCache(ThreadCache& cache){
+        if(cache.count == 0) return;
+        for(uint32_t i = 0; i + 1 < cache.count; i++){
+            Next(SlotAt(cache.slots[i])) = cache.slots[i + 1];
+        }
+        Next(SlotAt(cache.slots[cache.count - 1])) = invalid_index;
+        PushBatch(cache.slots[0]);
+        cache.count = 0;
+    }
+
+    Slot* SlotAt(uint32_t index){
+        Slot* chunk = chunks[index / objects_per_chunk].load(std::memory_order_acquire);
+        return &chunk[index % objects_per_chunk];
+    }
+
+    /* GLOBAL STACK */
+
+    // head = (tag << 32) | (first slot index + 1), 0 in the low half means empty
+    static uint64_t Pack(uint32_t index, uint32_t tag){
+        return ((uint64_t)tag << 32) | (uint64_t)(index + 1);
+    }
+
+    void PushBatch(uint32_t first){
+        Slot* slot = SlotAt(first);
+        uint64_t old_head = global_head.load(std::memory_order_relaxed);
+        uint64_t new_head;
+        do {
+            NextBatch(slot).store((uint32_t)old_head - 1, std::memory_order_relaxed);
+            new_head = Pack(first, (uint32_t)(old_head >> 32) + 1);
+        } while(!global_head.compare_exchange_weak(old_head, new_head,
+                    std::memory_order_release, std::memory_order_relaxed));
+    }
+
+    uint32_t PopBatch(){
+        uint64_t old_head = global_head.load(std::memory_order_acquire);
+        uint64_t new_head;
+        do {
+            uint32_t first = (uint32_t)old_head - 1;
+            if(first == invalid_index) return invalid_index;
+            //the slot might already be handed out by another thread, then the tag changed and the CAS fails
+            uint32_t next = NextBatch(SlotAt(first)).load(std::memory_order_relaxed);
+            new_head = Pack(next, (uint32_t)(old_head >> 32) + 1);
+        } while(!global_head.compare_exchange_weak(old_head, new_head,
+                    std::memory_order_acquire, std::memory_order_acquire));
+        return (uint32_t)old_head - 1;
+    }
+
+    // Adds a chunk and pushes its slots as batches. Returns false if max_chunks is reached.
+    bool Grow(){
+        std::lock_guard<std::mutex> guard(grow_lock);
+        if(global_head.load(std::memory_order_acquire) & 0xFFFFFFFF){
+            return true; //another thread grew the pool while we waited
+        }
+        uint32_t chunk_index = chunk_count.load(std::memory_order_relaxed);
+        if(chunk_index >= max_chunks){
+            return false;
+        }
+        Slot* slots = (Slot*)::operator new(sizeof(Slot) * objects_per_chunk,
+            std::align_val_t(alignof(Slot)), std::nothrow);
+        if(slots == nullptr){
+            return false;
+        }
+        chunks[chunk_index].store(slots, std::memory_order_release);
+        chunk_count.store(chunk_index + 1, std::memory_order_relaxed);
+
+        uint32_t base = chunk_index * objects_per_chunk;
+        for(uint32_t i = 0; i < objects_per_chunk; i++){
+            slots[i].index = base + i;
+        }
+        for(uint32_t b = 0; b < objects_per_chunk; b += batch_size){
+            for(uint32_t i = b; i < b + batch_size - 1; i++){
+                Next(&slots[i]) = base + i + 1;
+            }
+            Next(&slots[b + batch_size - 1]) = invalid_index;
+            PushBatch(base + b);
+        }
+        return true;
+    }
+
+    /* PER THREAD MAGAZINES */
+
+    uint32_t PopSlot(){
+        int thread = ThisThreadIndex();
+        if(thread >= max_threads){
+            //no magazine, take one slot and hand the rest of the batch straight back
+            uint32_t first = PopBatchOrGrow();
+            if(first == invalid_index) return invalid_index;
+            uint32_t rest = Next(SlotAt(first));
+            if(rest != invalid_index) PushBatch(rest);
+            return first;
+        }
+
+        ThreadCache& cache = caches[thread];
+        if(cache.count == 0){
+            uint32_t index = PopBatchOrGrow();
+            while(index != invalid_index){
+                cache.slots[cache.count++] = index;
+                index = Next(SlotAt(index));
+            }
+            if(cache.count == 0) return invalid_index;
+        }
+        return cache.slots[--cache.count];
+    }
+
+    void PushSlot(uint32_t index){
+        int thread = ThisThreadIndex();
+        if(thread >= max_threads){
+            Next(SlotAt(index)) = invalid_index;
+            PushBatch(index);
+            return;
+        }
+
+        ThreadCache& cache = caches[thread];
+        if(cache.count == batch_size * 2){
+            //magazine is full, link the top half into a batch and give it back
+            uint32_t first = cache.slots[batch_size];
+            for(uint32_t i = batch_size; i < batch_size * 2 - 1; i++){
+                Next(SlotAt(cache.slots[i])) = cache.slots[i + 1];
+            }
+            Next(SlotAt(cache.slots[batch_size * 2 - 1])) = invalid_index;
+            PushBatch(first);
+            cache.count = batch_size;
+        }
+        cache.slots[cache.count++] = index;
+    }
+
+    uint32_t PopBatchOrGrow(){
+        uint32_t first = PopBatch();
+        while(first == invalid_index){
+            if(!Grow()) return invalid_index;
+            first = PopBatch();
+        }
+        return first;
+    }
+
+    std::atomic<uint64_t> global_head{0};
+    std::atomic<Slot*>* chunks;
+    std::atomic<uint32_t> chunk_count{0};
+    ThreadCache* caches;
+    std::mutex grow_lock;
+    uint32_t objects_per_chunk;
+    uint32_t max_chunks;
+    ConcurrentAllocStats stats;
+};
@@ -0,0 +1,85 @@
+/*
+    -- Multi Frame Allocator --
+
+    A set of N linear allocators which take turns being the 'current' one. Every frame
+    BeginFrame() moves to the next buffer and resets only that one, which is the oldest.
+    Whatever was allocated in frame F stays valid for the next N-1 frames without being copied
+    anywhere, and is then thrown away in one go, no per-object frees needed.
+
+    With N = 2 (DoubleFrameAlloc) data from the previous frame is still readable while the
+    current frame is being built, which is exactly what one frame delayed consumers (render
+    thread, async readbacks) need.
+
+        DoubleFrameAlloc frames(16 * 1024 * 1024);
+        while(running){
+            frames.BeginFrame();
+            DrawList* list = frames.Create<DrawList>();
+            ... hand list to the render thread, it reads it during the next frame ...
+        }
+
+    Use case: Data produced in one frame but consumed in a later one.
+*/
+
+#pragma once
+
+#include <array>
+#include <utility>
+
+#include "linear_alloc.h"
+
+template<int N>
+class MultiFrameAlloc {
+    static_assert(N >= 2, "use a plain LinearAlloc for a single buffer");
+public:
+    // size_per_frame is the capacity of each of the N buffers
+    explicit MultiFrameAlloc(size_t size_per_frame) :
+        MultiFrameAlloc(size_per_frame, std::make_index_sequence<N>{})
+    {
+    }
+
+    MultiFrameAlloc(MultiFrameAlloc const&) = delete;
+    MultiFrameAlloc& operator=(MultiFrameAlloc const&) = delete;
+
+    // Swap to the oldest buffer and clear it. Anything allocated N frames ago is now invalid.
+    void BeginFrame(){
+        current = (current + 1) % N;
+        buffers[current].Reset();
+    }
+
+    char* Allocate(size_t size, size_t alignment = alignof(max_align_t)){
+        return buffers[current].Allocate(size, alignment);
+    }
+
+    template<typename T, typename... Args>
+    T* Create(Args&&... args){
+        return buffers[current].template Create<T>(std::forward<Args>(args)...);
+    }
+
+    template<typename T>
+    T* CreateArray(size_t count){
+        return buffers[current].template CreateArray<T>(count);
+    }
+
+    // The buffer being filled this frame, handy for a LinearAllocScope
+    LinearAlloc& Current(){
+        return buffers[current];
+    }
+
+    // frames_ago = 1 is last frame's buffer. Only N-1 frames back are still alive.
+    LinearAlloc& Previous(int frames_ago = 1){
+        return buffers[(current + N - (frames_ago % N)) % N];
+    }
+
+private:
+    //LinearAlloc can't be copied or moved, so the array is built in place, one buffer per index
+    template<size_t... I>
+    MultiFrameAlloc(size_t size_per_frame, std::index_sequence<I...>) :
+        buffers{{ ((void)I, LinearAlloc(size_per_frame))... }}
+    {
+    }
+
+    std::array<LinearAlloc, N> buffers;
+    int current = 0;
+};
+
+using DoubleFrameAlloc = MultiFrameAlloc<2>;
@@ -3,54 +3,451 @@
 
     A linear allocator is one of the simplest kinds of allocators out there. Its simple
     because it only ever allocates, never frees. Starting out with a big bag of memory,
-    it keeps incrementing an offset into as calls to Allocate() are made. It has the 
+    it keeps incrementing an offset into as calls to Allocate() are made. It has the
     convinient Reset() function which simply reset the offset to the start, ready for
     new allocations to be made.
 
-    Use case: A scratch space that is short-lived. Don't put persistant data structures 
+    Every allocation is aligned, by default to alignof(max_align_t), but a larger alignment
+    can be requested for SIMD types (16 for SSE, 32 for AVX). Sizes are size_t so arenas
+    bigger than 2 GB work.
+
+    Markers: GetMarker() returns the current offset, and RewindTo(marker) throws away everything
+    allocated after it. This gives nested lifetimes inside a frame. LinearAllocScope does the
+    rewind automatically when it goes out of scope:
+
+        LinearAlloc frame(64 * 1024 * 1024);
+        ...
+        {
+            LinearAllocScope scope(frame);
+            float* temp = frame.CreateArray<float>(1024);
+            ... use temp ...
+        } // temp is gone, the memory is reused by the next scope
+
+    Policies: LinearAlloc is BasicLinearAlloc with the default policies, see alloc_policies.h.
+    The growth policy decides what total_size means:
+        FixedGrowth   - one block of total_size bytes, or memory someone else owns
+        ChunkedGrowth - blocks of total_size bytes, another one is added whenever the current
+                        one is full. A single allocation can't be bigger than one block.
+        VirtualGrowth - total_size worth of address space is reserved and pages get committed
+                        as the offset moves into them. The capacity can be generous (gigabytes
+                        even) while the resident memory follows what is actually used.
+    Reset() keeps everything for the next frame, Trim() hands back what is past the offset.
+    With DebugChecks Reset() and RewindTo() check the canaries of every allocation they
+    throw away.
+
+    Use case: A scratch space that is short-lived. Don't put persistant data structures
     here, rather for intermediate computations.
 
     Disclamer: This isn't a tested (or even compiled) allocator. For illustrative purposes only
-   
+
 */
 
 #pragma once
 
 #include <stdlib.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include <atomic>
+#include <mutex>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "alloc_policies.h"
+#include "alloc_stats.h"
+#include "virtual_memory.h"
+
+/* STORAGE, one per growth policy */
+
+namespace linear_alloc_detail {
+
+static constexpr size_t no_room = SIZE_MAX;
+
+inline size_t AlignedOffset(char* base, size_t start, size_t alignment){
+    uintptr_t aligned = ((uintptr_t)base + start + (alignment - 1)) & ~(uintptr_t)(alignment - 1);
+    return (size_t)(aligned - (uintptr_t)base);
+}
 
-class LinearAlloc {
+} // namespace linear_alloc_detail
+
+// Place() finds room for size bytes at or after location with header bytes free in front,
+// aligned to alignment. It returns the offset of the memory or no_room.
+template<typename Growth>
+class LinearStorage;
+
+template<>
+class LinearStorage<FixedGrowth> {
 public:
-    LinearAlloc(int total_size) : 
-        location(0), //start at the beginning
-        total_size(total_size) //set max size
+    static constexpr bool contiguous = true;
+
+    explicit LinearStorage(size_t total_size) :
+        data((char*)malloc(total_size)),
+        total_size(data != nullptr ? total_size : 0),
+        owns_data(true)
     {
-        data = (char*)malloc(total_size);
     }
-    ~LinearAlloc(){
-        free(data); //free the data after using it
+    // Memory someone else owns, it won't be freed
+    LinearStorage(char* memory, size_t total_size) :
+        data(memory),
+        total_size(memory != nullptr ? total_size : 0),
+        owns_data(false)
+    {
+    }
+    ~LinearStorage(){
+        if(owns_data) free(data);
     }
 
-    char* Allocate(int size){
-        if(location + size >= total_size)
-        {
-            return nullptr; //can't allocate anymore! 
-        } 
-        char* cur = data + location;
-        location += size;
-        return cur;
+    size_t Place(size_t location, size_t header, size_t size, size_t alignment){
+        size_t offset = linear_alloc_detail::AlignedOffset(data, location + header, alignment);
+        if(offset > total_size || size > total_size - offset) return linear_alloc_detail::no_room;
+        return offset;
+    }
+    char* Address(size_t offset) const { return data + offset; }
+
+    void Trim(size_t) {}
+    size_t Committed() const { return total_size; }
+    size_t Capacity() const { return total_size; }
+
+private:
+    char* data;
+    size_t total_size;
+    bool owns_data;
+};
+
+template<>
+class LinearStorage<ChunkedGrowth> {
+public:
+    static constexpr bool contiguous = false; //offsets jump from one block to the next
+
+    explicit LinearStorage(size_t block_size) : block_size(block_size) {}
+    ~LinearStorage(){
+        for(char* block : blocks){
+            ::operator delete(block, std::align_val_t(block_alignment));
+        }
+    }
+
+    size_t Place(size_t location, size_t header, size_t size, size_t alignment){
+        if(size > block_size || header > block_size - size) return linear_alloc_detail::no_room; //would never fit
+        size_t block = location / block_size;
+        size_t offset = PlaceInBlock(block, location - block * block_size, header, size, alignment);
+        if(offset == linear_alloc_detail::no_room){
+            //not enough left in this block, start at the top of the next one
+            block++;
+            offset = PlaceInBlock(block, 0, header, size, alignment);
+            if(offset == linear_alloc_detail::no_room) return linear_alloc_detail::no_room;
+        }
+        return block * block_size + offset;
+    }
+    char* Address(size_t offset) const {
+        return blocks[offset / block_size] + offset % block_size;
+    }
+
+    // Frees every block past the one the offset is in
+    void Trim(size_t location){
+        size_t keep = (location + block_size - 1) / block_size;
+        if(keep == 0 && !blocks.empty()) keep = 1; //the first block is always kept
+        while(blocks.size() > keep){
+            ::operator delete(blocks.back(), std::align_val_t(block_alignment));
+            blocks.pop_back();
+        }
+    }
+    size_t Committed() const { return blocks.size() * block_size; }
+    size_t Capacity() const { return SIZE_MAX; }
+
+private:
+    // offsets line up with addresses for alignments up to this
+    static constexpr size_t block_alignment = 64;
+
+    size_t PlaceInBlock(size_t block, size_t start, size_t header, size_t size, size_t alignment){
+        if(block == blocks.size()){
+            char* mem = (char*)::operator new(block_size, std::align_val_t(block_alignment), std::nothrow);
+            if(mem == nullptr) return linear_alloc_detail::no_room;
+            blocks.push_back(mem); //blocks are kept after a Reset(), so this only happens while warming up
+        }
+        size_t offset = linear_alloc_detail::AlignedOffset(blocks[block], start + header, alignment);
+        if(offset >= block_size || size > block_size - offset) return linear_alloc_detail::no_room;
+        return offset;
+    }
+
+    size_t block_size;
+    std::vector<char*> blocks;
+};
+
+template<bool huge_pages>
+class VirtualLinearStorage {
+public:
+    static constexpr bool contiguous = true;
+
+    explicit VirtualLinearStorage(size_t total_size) :
+        total_size(virtual_memory::RoundUpToPage(total_size))
+    {
+        data = (char*)virtual_memory::Reserve(this->total_size, huge_pages);
+        if(data == nullptr) this->total_size = 0;
+    }
+    ~VirtualLinearStorage(){
+        if(data != nullptr) virtual_memory::Release(data, total_size);
+    }
+
+    size_t Place(size_t location, size_t header, size_t size, size_t alignment){
+        size_t offset = linear_alloc_detail::AlignedOffset(data, location + header, alignment);
+        if(offset > total_size || size > total_size - offset) return linear_alloc_detail::no_room;
+        if(offset + size > committed.load(std::memory_order_acquire) && !CommitUpTo(offset + size)){
+            return linear_alloc_detail::no_room; //the OS is out of memory
+        }
+        return offset;
+    }
+    char* Address(size_t offset) const { return data + offset; }
+
+    // Decommits the pages past location. Not while another thread is allocating.
+    void Trim(size_t location){
+        std::lock_guard<std::mutex> guard(commit_lock);
+        size_t keep = virtual_memory::RoundUpToPage(location);
+        size_t current = committed.load(std::memory_order_relaxed);
+        if(keep < current){
+            virtual_memory::Decommit(data + keep, current - keep);
+            committed.store(keep, std::memory_order_release);
+        }
+    }
+    size_t Committed() const { return committed.load(std::memory_order_relaxed); }
+    size_t Capacity() const { return total_size; }
+
+private:
+    // commits in steps of at least commit_step so growing isn't a syscall per page
+    static constexpr size_t commit_step = huge_pages ? 2 * 1024 * 1024 : 64 * 1024;
+
+    //the lock only matters for the LockFree policy, everyone else is already serialized
+    bool CommitUpTo(size_t end){
+        std::lock_guard<std::mutex> guard(commit_lock);
+        size_t current = committed.load(std::memory_order_relaxed);
+        if(end <= current) return true; //another thread beat us to it
+        size_t new_committed = (end + commit_step - 1) / commit_step * commit_step;
+        if(new_committed > total_size) new_committed = total_size;
+        if(!virtual_memory::Commit(data + current, new_committed - current)){
+            return false;
+        }
+        committed.store(new_committed, std::memory_order_release);
+        return true;
+    }
+
+    char* data;
+    size_t total_size;
+    std::atomic<size_t> committed{0}; //everything before this is usable memory
+    std::mutex commit_lock;
+};
+
+template<>
+class LinearStorage<VirtualGrowth> : public VirtualLinearStorage<false> {
+    using VirtualLinearStorage<false>::VirtualLinearStorage;
+};
+template<>
+class LinearStorage<VirtualHugePageGrowth> : public VirtualLinearStorage<true> {
+    using VirtualLinearStorage<true>::VirtualLinearStorage;
+};
+
+/* ALLOCATOR */
+
+template<typename Checks = DefaultChecks, typename Threading = SingleThreaded, typename Growth = FixedGrowth,
+         size_t min_alignment = alignof(max_align_t)>
+class BasicLinearAlloc {
+    static_assert((min_alignment & (min_alignment - 1)) == 0, "min_alignment must be a power of two");
+    static_assert(!(Threading::lock_free && std::is_same<Growth, ChunkedGrowth>::value),
+        "adding blocks needs a lock, use MutexLocked with ChunkedGrowth");
+
+public:
+    // A marker is just the offset at the time GetMarker() was called
+    using Marker = size_t;
+    using StatsType = typename std::conditional<Threading::lock_free, ConcurrentAllocStats, AllocStats>::type;
+
+    explicit BasicLinearAlloc(size_t total_size) : storage(total_size) {}
+    // Suballocate out of memory someone else owns, it won't be freed by this allocator.
+    // FixedGrowth only.
+    BasicLinearAlloc(char* memory, size_t total_size) : storage(memory, total_size) {}
+
+    //owns its memory, so copying would double free
+    BasicLinearAlloc(BasicLinearAlloc const&) = delete;
+    BasicLinearAlloc& operator=(BasicLinearAlloc const&) = delete;
+
+    // alignment must be a power of two
+    char* Allocate(size_t size, size_t alignment = min_alignment){
+        if(alignment < min_alignment) alignment = min_alignment;
+        if constexpr(Checks::trailer_size != 0){
+            if(size > SIZE_MAX - Checks::trailer_size){
+                stats.RecordFailure();
+                return nullptr;
+            }
+        }
+        size_t padded_size = size + Checks::trailer_size;
+
+        if constexpr(Threading::lock_free){
+            size_t old = location.load(std::memory_order_relaxed);
+            size_t offset;
+            do {
+                offset = storage.Place(old, Checks::header_size, padded_size, alignment);
+                if(offset == linear_alloc_detail::no_room){
+                    stats.RecordFailure();
+                    return nullptr; //can't allocate anymore!
+                }
+            } while(!location.compare_exchange_weak(old, offset + padded_size, std::memory_order_relaxed));
+            stats.RecordAlloc(offset + padded_size - old); //padding counts as used
+            char* mem = storage.Address(offset);
+            if constexpr(Checks::enabled){
+                Checks::OnAllocate(mem, size, last_allocation.exchange(offset, std::memory_order_relaxed));
+            }
+            return mem;
+        } else {
+            std::lock_guard<typename Threading::Mutex> guard(lock);
+            size_t offset = storage.Place(location, Checks::header_size, padded_size, alignment);
+            if(offset == linear_alloc_detail::no_room){
+                stats.RecordFailure();
+                return nullptr; //can't allocate anymore!
+            }
+            stats.RecordAlloc(offset + padded_size - location); //padding counts as used
+            location = offset + padded_size;
+            char* mem = storage.Address(offset);
+            if constexpr(Checks::enabled){
+                Checks::OnAllocate(mem, size, last_allocation);
+                last_allocation = offset;
+            }
+            return mem;
+        }
     }
 
     void Free() {
         // Does nothing!
     }
 
-    // Make the current location the start again.
+    // Constructs a T in the arena. The destructor is never run, so only types which
+    // don't need one are allowed here.
+    template<typename T, typename... Args>
+    T* Create(Args&&... args){
+        static_assert(std::is_trivially_destructible<T>::value, "LinearAlloc never runs destructors");
+        char* mem = Allocate(sizeof(T), alignof(T));
+        if(mem == nullptr) return nullptr;
+        return new (mem) T(std::forward<Args>(args)...);
+    }
+
+    // Default constructs count T's next to each other
+    template<typename T>
+    T* CreateArray(size_t count){
+        static_assert(std::is_trivially_destructible<T>::value, "LinearAlloc never runs destructors");
+        if(count > SIZE_MAX / sizeof(T)) return nullptr; //size would overflow
+        char* mem = Allocate(sizeof(T) * count, alignof(T));
+        if(mem == nullptr) return nullptr;
+        T* arr = (T*)mem;
+        for(size_t i = 0; i < count; i++){
+            new (&arr[i]) T();
+        }
+        return arr;
+    }
+
+    Marker GetMarker() const {
+        return BytesUsed();
+    }
+
+    // Everything allocated after marker is thrown away. Markers from 'the future' are ignored.
+    // The stats only find out how many objects that was on the next Reset().
+    // Not while another thread is allocating.
+    void RewindTo(Marker marker){
+        std::lock_guard<typename Threading::Mutex> guard(lock);
+        size_t current = Load(location);
+        if(marker <= current){
+            stats.RecordRelease(current - marker, 0);
+            CheckAllocationsFrom(marker);
+            Store(location, marker);
+        }
+    }
+
+    // Make the current location the start again. Not while another thread is allocating.
     void Reset(){
-        location = 0; 
+        std::lock_guard<typename Threading::Mutex> guard(lock);
+        stats.RecordReset();
+        CheckAllocationsFrom(0);
+        Store(location, 0);
     }
 
+    // Hands back the memory past the current offset: decommits pages with VirtualGrowth,
+    // frees blocks with ChunkedGrowth. Not while another thread is allocating.
+    void Trim(){
+        std::lock_guard<typename Threading::Mutex> guard(lock);
+        storage.Trim(Load(location));
+    }
+
+    // Start of the arena, every allocation is in [Data(), Data() + BytesUsed()). Offsets from
+    // Data() stay the same wherever the bytes end up, which is what arena_snapshot.h relies on.
+    char* Data() const {
+        static_assert(LinearStorage<Growth>::contiguous, "ChunkedGrowth blocks aren't next to each other");
+        return storage.Address(0);
+    }
+
+    size_t BytesUsed() const {
+        std::lock_guard<typename Threading::Mutex> guard(lock);
+        return Load(location);
+    }
+    size_t BytesCommitted() const { return storage.Committed(); }
+    size_t Capacity() const { return storage.Capacity(); }
+
+    StatsType const& Stats() const { return stats; }
+
 private:
-    char* data;
-    int location;
-    int total_size;
-};
\ No newline at end of file
+    using Offset = typename std::conditional<Threading::lock_free, std::atomic<size_t>, size_t>::type;
+
+    static size_t Load(size_t const& value) { return value; }
+    static size_t Load(std::atomic<size_t> const& value) { return value.load(std::memory_order_relaxed); }
+    static void Store(size_t& value, size_t new_value) { value = new_value; }
+    static void Store(std::atomic<size_t>& value, size_t new_value) { value.store(new_value, std::memory_order_relaxed); }
+
+    // Walks the chain of allocations made by DebugChecks, checking and poisoning every one
+    // at or after marker and unlinking them
+    void CheckAllocationsFrom(size_t marker){
+        if constexpr(Checks::enabled){
+            size_t kept = linear_alloc_detail::no_room;
+            size_t* tail = &kept;
+            size_t offset = Load(last_allocation);
+            while(offset != linear_alloc_detail::no_room){
+                char* mem = storage.Address(offset);
+                if(offset >= marker){
+                    offset = Checks::OnFree(mem);
+                    continue;
+                }
+                *tail = offset;
+                //one thread at a time means the chain is in address order, the rest is below marker too
+                if constexpr(!Threading::lock_free) break;
+                tail = &((typename Checks::Header*)mem - 1)->previous;
+                offset = *tail;
+            }
+            if constexpr(Threading::lock_free) *tail = linear_alloc_detail::no_room;
+            Store(last_allocation, kept);
+        } else {
+            (void)marker;
+        }
+    }
+
+    LinearStorage<Growth> storage;
+    Offset location{0};
+    Offset last_allocation{linear_alloc_detail::no_room}; //DebugChecks only, the newest allocation
+    mutable typename Threading::Mutex lock;
+    StatsType stats;
+};
+
+using LinearAlloc = BasicLinearAlloc<>;
+using VirtualLinearAlloc = BasicLinearAlloc<DefaultChecks, SingleThreaded, VirtualGrowth>;
+
+// Takes a marker on construction and rewinds to it on destruction, so everything
+// allocated inside the scope is released at the closing brace.
+template<typename Alloc = LinearAlloc>
+class LinearAllocScope {
+public:
+    explicit LinearAllocScope(Alloc& alloc) : alloc(alloc), marker(alloc.GetMarker()) {}
+    ~LinearAllocScope(){
+        alloc.RewindTo(marker);
+    }
+
+    LinearAllocScope(LinearAllocScope const&) = delete;
+    LinearAllocScope& operator=(LinearAllocScope const&) = delete;
+
+private:
+    Alloc& alloc;
+    typename Alloc::Marker marker;
+};
@@ -2,56 +2,658 @@
     -- Pool Allocator --
 
     A pool allocator works by preallocating a chunks of memory all in the same size, then
-    uses a free_list to suballocate out of it. It does not suffer from fragmentation but 
-    is limited by the need to have all the objects of the same size. 
+    uses a free_list to suballocate out of it. It does not suffer from fragmentation but
+    is limited by the need to have all the objects of the same size.
 
-    Use Case: There are a lot of the same object with a high rate of creation/destruction. As the 
-    memory is already allocated, its cheap to add/remove (no OS calls to get more memory)
+    The free list is intrusive: a slot that isn't holding an object holds a pointer to the next
+    free slot instead, so it costs no memory on top of the objects themselves. Allocate() pops
+    the head of the list and Free() pushes onto it, both O(1).
+
+    Policies: PoolAlloc<T> uses the default policies, see alloc_policies.h. The growth policy
+    decides what happens when the free list runs dry:
+        ChunkedGrowth - the default, the pool grows by another chunk of objects_per_chunk slots
+        FixedGrowth   - one chunk only, or memory someone else owns
+        VirtualGrowth - the address space for all max_chunks chunks is reserved up front and each
+                        chunk is only committed when the pool grows into it. The pool's memory
+                        ends up in one contiguous range.
+    Chunks are never moved or released until the pool is destroyed, so pointers handed out
+    earlier stay valid. Once the pool has grown to its working size no more memory is requested.
+
+    With DebugChecks every slot gets a header and a trailer, Free() catches double frees and
+    overruns. With LockFree the free list is a Treiber stack with a 16 bit ABA tag packed into
+    the top of the head pointer, which relies on user space addresses fitting in 48 bits (true
+    for x64 and ARM64). Growing still takes a lock, but that only happens while warming up.
 
-    Disclamer: This isn't a tested (or even compiled) allocator. For illustrative purposes only
+    Use Case: There are a lot of the same object with a high rate of creation/destruction. As the
+    memory is already allocated, its cheap to add/remove (no OS calls to get more memory)
 */
 #pragma once
 
 #include <stdlib.h>
+#include <stddef.h>
+#include <stdint.h>
 
-template<typename T>
-class PoolAlloc {
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+#include <atomic>
+#include <mutex>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "alloc_policies.h"
+#include "alloc_stats.h"
+#include "virtual_memory.h"
+
+/* CHUNKS, one source per growth policy */
+
+// Add() returns the memory for one more chunk or nullptr, ChunkBytes() is the size of each.
+// Called from one thread at a time. ChunkOf() finds the chunk an address inside it belongs to.
+template<typename Growth>
+class PoolChunks;
+
+template<>
+class PoolChunks<FixedGrowth> {
 public:
-    PoolAlloc(int max_objects) : max_objects(max_objects){
-        data = (T*)malloc(sizeof(T) * max_objects);
-        free_list = (int*)malloc(sizeof(int) * max_objects);
+    PoolChunks(size_t chunk_bytes, size_t, size_t alignment) :
+        data(nullptr),
+        chunk_bytes(chunk_bytes),
+        alignment(alignment),
+        owns_data(true)
+    {
+    }
+    // Memory someone else owns, it won't be freed
+    PoolChunks(void* memory, size_t size, size_t alignment) :
+        data(nullptr),
+        chunk_bytes(0),
+        alignment(alignment),
+        owns_data(false)
+    {
+        uintptr_t start = ((uintptr_t)memory + (alignment - 1)) & ~(uintptr_t)(alignment - 1);
+        uintptr_t end = (uintptr_t)memory + size;
+        if(memory != nullptr && end > start){
+            data = (char*)start;
+            chunk_bytes = (size_t)(end - start);
+        }
+    }
+    ~PoolChunks(){
+        if(owns_data && data != nullptr) ::operator delete(data, std::align_val_t(alignment));
+    }
 
-        for(int i = 0; i < max_objects-1;i++){
-            free_list[i] = i+1; 
+    char* Add(){
+        if(count.load(std::memory_order_relaxed) != 0) return nullptr;
+        if(owns_data){
+            data = (char*)::operator new(chunk_bytes, std::align_val_t(alignment), std::nothrow);
         }
-        free_list[max_objects - 1] = 0; //loop it back
+        if(data == nullptr) return nullptr;
+        count.store(1, std::memory_order_relaxed);
+        return data;
+    }
+    char* At(size_t) const { return data; }
+    char* ChunkOf(char*) const { return data; }
+    size_t Count() const { return count.load(std::memory_order_relaxed); }
+    size_t ChunkBytes() const { return chunk_bytes; }
+
+private:
+    char* data;
+    size_t chunk_bytes;
+    size_t alignment;
+    bool owns_data;
+    std::atomic<size_t> count{0};
+};
 
+template<>
+class PoolChunks<ChunkedGrowth> {
+public:
+    // max_chunks = 0 means no limit
+    PoolChunks(size_t chunk_bytes, size_t max_chunks, size_t alignment) :
+        chunk_bytes(chunk_bytes),
+        max_chunks(max_chunks),
+        alignment(alignment)
+    {
+    }
+    ~PoolChunks(){
+        for(char* chunk : chunks){
+            ::operator delete(chunk, std::align_val_t(alignment));
+        }
     }
 
-    template<typename... Args>
-    T* Allocate(Args&&... args){
+    char* Add(){
+        if(max_chunks != 0 && chunks.size() >= max_chunks) return nullptr;
+        char* mem = (char*)::operator new(chunk_bytes, std::align_val_t(alignment), std::nothrow);
+        if(mem == nullptr) return nullptr;
+        chunks.push_back(mem);
+        count.store(chunks.size(), std::memory_order_relaxed);
+        return mem;
+    }
+    char* At(size_t index) const { return chunks[index]; }
+    // Only when chunk_bytes is a power of two and chunks are aligned to it
+    char* ChunkOf(char* mem) const { return (char*)((uintptr_t)mem & ~(uintptr_t)(chunk_bytes - 1)); }
+    size_t Count() const { return count.load(std::memory_order_relaxed); }
+    size_t ChunkBytes() const { return chunk_bytes; }
+
+private:
+    size_t chunk_bytes;
+    size_t max_chunks;
+    size_t alignment;
+    std::vector<char*> chunks;
+    std::atomic<size_t> count{0};
+};
+
+template<bool huge_pages>
+class VirtualPoolChunks {
+public:
+    // There has to be some limit to reserve for, so max_chunks = 0 picks default_virtual_chunks.
+    // Chunks are whole pages, which is always enough alignment.
+    VirtualPoolChunks(size_t chunk_bytes, size_t max_chunks, size_t) :
+        chunk_bytes(virtual_memory::RoundUpToPage(chunk_bytes)),
+        max_chunks(max_chunks != 0 ? max_chunks : default_virtual_chunks)
+    {
+        reserved = (char*)virtual_memory::Reserve(this->chunk_bytes * this->max_chunks, huge_pages);
+    }
+    ~VirtualPoolChunks(){
+        if(reserved != nullptr) virtual_memory::Release(reserved, chunk_bytes * max_chunks);
+    }
+
+    char* Add(){
+        size_t index = count.load(std::memory_order_relaxed);
+        if(reserved == nullptr || index >= max_chunks) return nullptr;
+        //the next chunk is simply the next piece of the reserved range
+        char* mem = reserved + chunk_bytes * index;
+        if(!virtual_memory::Commit(mem, chunk_bytes)) return nullptr;
+        count.store(index + 1, std::memory_order_relaxed);
+        return mem;
+    }
+    char* At(size_t index) const { return reserved + chunk_bytes * index; }
+    // Only when chunk_bytes is a power of two
+    char* ChunkOf(char* mem) const { return reserved + ((size_t)(mem - reserved) & ~(chunk_bytes - 1)); }
+    size_t Count() const { return count.load(std::memory_order_relaxed); }
+    size_t ChunkBytes() const { return chunk_bytes; }
+
+private:
+    static constexpr size_t default_virtual_chunks = 1 << 16;
 
-        int next_free = free_list[current_free_node];
+    char* reserved;
+    size_t chunk_bytes;
+    size_t max_chunks;
+    std::atomic<size_t> count{0};
+};
+
+template<>
+class PoolChunks<VirtualGrowth> : public VirtualPoolChunks<false> {
+    using VirtualPoolChunks<false>::VirtualPoolChunks;
+};
+template<>
+class PoolChunks<VirtualHugePageGrowth> : public VirtualPoolChunks<true> {
+    using VirtualPoolChunks<true>::VirtualPoolChunks;
+};
+
+/* ALLOCATOR */
+
+template<typename T, typename Checks = DefaultChecks, typename Threading = SingleThreaded,
+         typename Growth = ChunkedGrowth, typename Tracking = NoLiveTracking, size_t min_alignment = alignof(T)>
+class PoolAlloc {
+    static_assert((min_alignment & (min_alignment - 1)) == 0, "min_alignment must be a power of two");
+    static_assert(!Threading::lock_free || sizeof(void*) == 8, "the ABA tag needs 64 bit pointers");
+
+public:
+    using StatsType = typename std::conditional<Threading::lock_free, ConcurrentAllocStats, AllocStats>::type;
+    class Iterator;
 
+    // max_chunks = 0 lets the pool grow without a limit. FixedGrowth always has one chunk.
+    PoolAlloc(size_t objects_per_chunk, size_t max_chunks = 0) :
+        chunks(ChunkBytesFor(objects_per_chunk), max_chunks, ChunkAlignmentFor(ChunkBytesFor(objects_per_chunk)))
+    {
+        //the chunk may have been rounded up, fill that space with more slots
+        Layout(chunks.ChunkBytes());
+        Grow(); //have the first chunk ready to go
+    }
+    // Carve the slots out of memory someone else owns. The pool can't grow past it and
+    // won't free it. FixedGrowth only.
+    PoolAlloc(void* memory, size_t size) :
+        chunks(memory, size, slot_alignment)
+    {
+        Layout(chunks.ChunkBytes());
+        Grow();
+    }
+    // Objects still alive when the pool dies are not destructed, Free() them first. With
+    // LiveBitmap the pool knows where they are and destructs them itself.
+    ~PoolAlloc(){
+        if constexpr(Tracking::enabled && !std::is_trivially_destructible<T>::value){
+            for(T& object : *this){
+                object.~T();
+            }
+        }
+    }
+
+    PoolAlloc(PoolAlloc const&) = delete;
+    PoolAlloc& operator=(PoolAlloc const&) = delete;
+
+    // Returns nullptr if the pool is out of slots and can't grow anymore
+    template<typename... Args>
+    T* Allocate(Args&&... args){
+        void* slot = AllocateSlot();
+        if(slot == nullptr){
+            return nullptr;
+        }
         //fancy way of constructing objects in place
-        T* ret = new (&data[current_free_node])T(std::forward<Args>(args)...)
-        current_free_node = next_free;
-        current_objects_allocated++; //maybe check if its over the max?
-        return ret;
+        return new (slot) T(std::forward<Args>(args)...);
     }
 
     void Free(T* elem){
-        //Calculate which index this is: (elem - data)/sizeof(T);
-        //This index should be added to the free list
-        //in place destroy: elem->~T();
+        if(elem == nullptr) return;
+        elem->~T(); //in place destroy
+        FreeSlot(elem);
+    }
+
+    // Raw, uninitialized slots with room for a T, for when something else does the
+    // constructing (like a std container through one of the adapters in std_allocators.h)
+    void* AllocateSlot(){
+        void* slot;
+        return AllocateSlots(&slot, 1) == 1 ? slot : nullptr;
+    }
+
+    void FreeSlot(void* mem){
+        FreeSlots(&mem, 1);
+    }
+
+    // Allocates count objects into out[0 .. count), each one constructed from args. Returns how
+    // many it got, which is only less than count when the pool ran out and can't grow.
+    template<typename... Args>
+    size_t AllocateN(T** out, size_t count, Args const&... args){
+        size_t allocated = AllocateSlots((void**)out, count);
+        for(size_t i = 0; i < allocated; i++){
+            new (out[i]) T(args...);
+        }
+        return allocated;
+    }
+
+    // Destructs and frees count objects, nullptrs are skipped
+    void FreeN(T* const* objects, size_t count){
+        for(size_t i = 0; i < count; i++){
+            if(objects[i] != nullptr) objects[i]->~T();
+        }
+        FreeSlots((void* const*)objects, count);
+    }
+
+    // The raw slot versions of AllocateN and FreeN. The lock is taken once and the free slots are
+    // pushed back as one linked run, with LockFree that is a single compare and swap.
+    size_t AllocateSlots(void** out, size_t count){
+        size_t allocated = 0;
+        if constexpr(Threading::lock_free){
+            while(allocated < count){
+                char* slot = Pop();
+                if(slot == nullptr){
+                    if(Grow(true)) continue;
+                    stats.RecordFailure();
+                    break;
+                }
+                out[allocated++] = TakeSlot(slot);
+            }
+            current_objects_allocated += allocated;
+        } else {
+            std::lock_guard<typename Threading::Mutex> guard(lock);
+            char* slot = free_list;
+            while(allocated < count){
+                if(slot == nullptr){
+                    free_list = nullptr;
+                    if(!Grow()){
+                        stats.RecordFailure();
+                        break;
+                    }
+                    slot = free_list;
+                }
+                char* next = Next(slot);
+                out[allocated++] = TakeSlot(slot);
+                slot = next;
+            }
+            free_list = slot;
+            current_objects_allocated += allocated;
+        }
+        return allocated;
+    }
+
+    void FreeSlots(void* const* slots, size_t count){
+        //link them up first, outside of any lock
+        char* first = nullptr;
+        char* last = nullptr;
+        size_t freed = 0;
+        for(size_t i = 0; i < count; i++){
+            char* slot = (char*)slots[i];
+            if(slot == nullptr) continue;
+            Checks::OnFree(slot);
+            //the bitmap words are plain integers unless LockFree, those bits change under the lock
+            if constexpr(Threading::lock_free) MarkFree(slot);
+            //the slot now holds the free list link instead of the object
+            if(last != nullptr) SetNext(last, slot);
+            else first = slot;
+            last = slot;
+            freed++;
+        }
+        if(freed == 0) return;
 
+        if constexpr(Threading::lock_free){
+            Push(first, last);
+            current_objects_allocated -= freed;
+            for(size_t i = 0; i < freed; i++) stats.RecordFree(slot_size);
+        } else {
+            std::lock_guard<typename Threading::Mutex> guard(lock);
+            if constexpr(Tracking::enabled){
+                for(size_t i = 0; i < count; i++){
+                    if(slots[i] != nullptr) MarkFree((char*)slots[i]);
+                }
+            }
+            SetNext(last, free_list);
+            free_list = first;
+            current_objects_allocated -= freed;
+            for(size_t i = 0; i < freed; i++) stats.RecordFree(slot_size);
+        }
+    }
+
+    // Destructs every object and puts every slot back on the free list, a single pass over
+    // the chunks. Needs LiveBitmap to find the objects, unless there is nothing to destruct.
+    // With DebugChecks, freeing an object from before the Clear() is caught as a double free.
+    // Not while another thread is using the pool.
+    void Clear(){
+        static_assert(Tracking::enabled || std::is_trivially_destructible<T>::value,
+            "Clear() needs LiveBitmap to find the objects to destruct");
+        std::lock_guard<typename Threading::Mutex> guard(lock);
+        if constexpr(Tracking::enabled){
+            for(T& object : *this){
+                object.~T();
+                Checks::OnFree((char*)&object);
+            }
+        }
+        free_list = nullptr;
+        //empty the list but keep the tag counting up, a stale Pop() must not see an old head again
+        free_head.store(NewHead(nullptr, free_head.load(std::memory_order_relaxed)), std::memory_order_relaxed);
+        for(size_t i = 0; i < chunks.Count(); i++){
+            char* chunk = chunks.At(i);
+            if constexpr(Checks::enabled && !Tracking::enabled){
+                //no telling which slots were live, poison them all so a stale Free() is caught
+                for(size_t slot = 0; slot < objects_per_chunk; slot++){
+                    Checks::OnRelease(SlotAt(chunk, slot), sizeof(T));
+                }
+            }
+            ClearBitmap(chunk);
+            LinkSlots(chunk + bitmap_bytes + storage_offset);
+        }
+        size_t released = current_objects_allocated;
+        stats.RecordRelease(released * slot_size, released);
+        current_objects_allocated = 0;
     }
 
+    // Grow until there is room for at least count objects without allocating more memory
+    bool Reserve(size_t count){
+        std::lock_guard<typename Threading::Mutex> guard(lock);
+        while(Capacity() < count){
+            if(!Grow()) return false;
+        }
+        return true;
+    }
+
+    // Every live object, in address order within each chunk. LiveBitmap only. Whole words
+    // of free slots are skipped at once. Not while another thread is allocating or freeing.
+    //
+    //     for(Particle& p : particles) { ... }
+    Iterator begin() { return Iterator(this, 0); }
+    Iterator end() { return Iterator(this, chunks.Count()); }
+
+    size_t ObjectsAllocated() const { return current_objects_allocated; }
+    size_t Capacity() const { return chunks.Count() * objects_per_chunk; }
+
+    StatsType const& Stats() const { return stats; }
+
 private:
-    T* data;
-    int* free_list;
-    int current_free_node = 0;
-    int max_objects;
-    int current_objects_allocated = 0;
-    
+    static constexpr size_t Max(size_t a, size_t b) { return a > b ? a : b; }
+    static constexpr size_t RoundUp(size_t size, size_t alignment) { return (size + alignment - 1) & ~(alignment - 1); }
+
+    // A slot is [ checks header | storage for a T or the free list link | checks trailer ],
+    // with no checks it is just the storage
+    static constexpr size_t slot_alignment = Max(Max(alignof(T), min_alignment), alignof(void*));
+    static constexpr size_t storage_offset = RoundUp(Checks::header_size, slot_alignment);
+    static constexpr size_t slot_size = RoundUp(storage_offset + Max(sizeof(T), sizeof(void*)) + Checks::trailer_size, slot_alignment);
+
+    using Counter = typename std::conditional<Threading::lock_free, std::atomic<size_t>, size_t>::type;
+    //growing is the only thing LockFree has to lock for
+    using GrowMutex = typename std::conditional<Threading::lock_free, std::mutex, SingleThreaded::Mutex>::type;
+
+    /* CHUNK LAYOUT */
+
+    // With LiveBitmap a chunk starts with a bit per slot: [ bitmap | slot | slot | ... ]
+    // A slot finds its chunk by masking its address, so chunks are a power of two in size and
+    // aligned to it. FixedGrowth only has the one chunk and doesn't need that.
+    static constexpr bool masked_chunks = Tracking::enabled && !std::is_same<Growth, FixedGrowth>::value;
+
+    static size_t BitmapBytes(size_t objects){
+        if constexpr(Tracking::enabled) return RoundUp((objects + 63) / 64 * sizeof(uint64_t), slot_alignment);
+        else return 0;
+    }
+    static size_t ChunkBytesFor(size_t objects){
+        size_t bytes = BitmapBytes(objects) + slot_size * objects;
+        if constexpr(masked_chunks){
+            size_t power = slot_alignment;
+            while(power < bytes) power *= 2;
+            return power;
+        }
+        return bytes;
+    }
+    static size_t ChunkAlignmentFor(size_t chunk_bytes){
+        return masked_chunks ? chunk_bytes : slot_alignment;
+    }
+
+    void Layout(size_t chunk_bytes){
+        bitmap_bytes = BitmapBytes(chunk_bytes / slot_size);
+        objects_per_chunk = chunk_bytes > bitmap_bytes ? (chunk_bytes - bitmap_bytes) / slot_size : 0;
+        bitmap_words = (objects_per_chunk + 63) / 64;
+    }
+
+    /* LIVE TRACKING */
+
+    using BitmapWord = typename std::conditional<Threading::lock_free, std::atomic<uint64_t>, uint64_t>::type;
+
+    static uint64_t LoadBits(uint64_t const& word) { return word; }
+    static uint64_t LoadBits(std::atomic<uint64_t> const& word) { return word.load(std::memory_order_relaxed); }
+    static void SetBits(uint64_t& word, uint64_t bits) { word |= bits; }
+    static void SetBits(std::atomic<uint64_t>& word, uint64_t bits) { word.fetch_or(bits, std::memory_order_relaxed); }
+    static void ClearBits(uint64_t& word, uint64_t bits) { word &= ~bits; }
+    static void ClearBits(std::atomic<uint64_t>& word, uint64_t bits) { word.fetch_and(~bits, std::memory_order_relaxed); }
+
+    static int FindFirstSet(uint64_t value){
+#if defined(_MSC_VER)
+        unsigned long index;
+        _BitScanForward64(&index, value);
+        return (int)index;
+#else
+        return __builtin_ctzll(value);
+#endif
+    }
+
+    BitmapWord* Bitmap(char* chunk) const { return (BitmapWord*)chunk; }
+    char* SlotAt(char* chunk, size_t index) const { return chunk + bitmap_bytes + slot_size * index + storage_offset; }
+
+    // bookkeeping for a slot just off the free list
+    char* TakeSlot(char* slot){
+        MarkLive(slot);
+        Checks::OnAllocate(slot, sizeof(T), 0);
+        stats.RecordAlloc(slot_size);
+        return slot;
+    }
+
+    void MarkLive(char* slot){
+        if constexpr(Tracking::enabled){
+            char* chunk = chunks.ChunkOf(slot);
+            size_t index = (size_t)(slot - storage_offset - bitmap_bytes - chunk) / slot_size;
+            SetBits(Bitmap(chunk)[index / 64], (uint64_t)1 << (index % 64));
+        }
+    }
+    void MarkFree(char* slot){
+        if constexpr(Tracking::enabled){
+            char* chunk = chunks.ChunkOf(slot);
+            size_t index = (size_t)(slot - storage_offset - bitmap_bytes - chunk) / slot_size;
+            ClearBits(Bitmap(chunk)[index / 64], (uint64_t)1 << (index % 64));
+        }
+    }
+    void ClearBitmap(char* chunk){
+        if constexpr(Tracking::enabled){
+            for(size_t i = 0; i < bitmap_words; i++){
+                new (&Bitmap(chunk)[i]) BitmapWord(0);
+            }
+        }
+    }
+
+    /* FREE LIST */
+
+    //slots are handed around as pointers to their storage
+    static char* Next(char* slot){
+        if constexpr(Threading::lock_free) return ((std::atomic<char*>*)slot)->load(std::memory_order_relaxed);
+        else return *(char**)slot;
+    }
+    static void SetNext(char* slot, char* next){
+        if constexpr(Threading::lock_free) ((std::atomic<char*>*)slot)->store(next, std::memory_order_relaxed);
+        else *(char**)slot = next;
+    }
+
+    // The tag goes up with every change to the head, so a head that was popped and pushed back
+    // in between doesn't look unchanged to a compare and swap (the ABA problem)
+    static constexpr int tag_shift = 48;
+    static constexpr uint64_t pointer_mask = ((uint64_t)1 << tag_shift) - 1;
+
+    static char* HeadSlot(uint64_t head) { return (char*)(uintptr_t)(head & pointer_mask); }
+    static uint64_t NewHead(char* slot, uint64_t old_head){
+        return (((old_head >> tag_shift) + 1) << tag_shift) | ((uint64_t)(uintptr_t)slot & pointer_mask);
+    }
+
+    char* Pop(){
+        uint64_t head = free_head.load(std::memory_order_acquire);
+        for(;;){
+            char* slot = HeadSlot(head);
+            if(slot == nullptr) return nullptr;
+            //slot may already be someone else's by now, the tag makes the swap fail if it is
+            uint64_t new_head = NewHead(Next(slot), head);
+            if(free_head.compare_exchange_weak(head, new_head, std::memory_order_acquire, std::memory_order_acquire)){
+                return slot;
+            }
+        }
+    }
+    // Pushes the already linked slots first ... last
+    void Push(char* first, char* last){
+        uint64_t head = free_head.load(std::memory_order_relaxed);
+        do {
+            SetNext(last, HeadSlot(head));
+        } while(!free_head.compare_exchange_weak(head, NewHead(first, head), std::memory_order_release, std::memory_order_relaxed));
+    }
+
+    bool Grow(bool only_if_empty = false){
+        std::lock_guard<GrowMutex> guard(grow_lock);
+        if constexpr(Threading::lock_free){
+            if(only_if_empty && HeadSlot(free_head.load(std::memory_order_acquire)) != nullptr){
+                return true; //another thread grew the pool while we were waiting
+            }
+        }
+        if(objects_per_chunk == 0){
+            return false;
+        }
+        char* mem = chunks.Add();
+        if(mem == nullptr){
+            return false;
+        }
+        ClearBitmap(mem);
+        LinkSlots(mem + bitmap_bytes + storage_offset);
+        return true;
+    }
+
+    //thread a chunk's slots onto the free list in address order
+    void LinkSlots(char* first){
+        char* last = first + slot_size * (objects_per_chunk - 1);
+        for(char* slot = first; slot != last; slot += slot_size){
+            SetNext(slot, slot + slot_size);
+        }
+        if constexpr(Threading::lock_free){
+            Push(first, last);
+        } else {
+            SetNext(last, free_list);
+            free_list = first;
+        }
+    }
+
+    PoolChunks<Growth> chunks;
+    size_t objects_per_chunk;
+    size_t bitmap_bytes; //LiveBitmap only, room taken by the bitmap at the start of each chunk
+    size_t bitmap_words;
+    char* free_list = nullptr; //the head for everything but LockFree
+    std::atomic<uint64_t> free_head{0}; //the tagged head for LockFree
+    Counter current_objects_allocated{0};
+    typename Threading::Mutex lock;
+    GrowMutex grow_lock;
+    StatsType stats;
+
+public:
+    class Iterator {
+    public:
+        T& operator*() const { return *(T*)pool->SlotAt(memory, word * 64 + bit); }
+        T* operator->() const { return &**this; }
+
+        Iterator& operator++(){
+            bits &= bits - 1; //clear the lowest set bit
+            if(bits != 0) bit = FindFirstSet(bits);
+            else NextWord();
+            return *this;
+        }
+
+        bool operator==(Iterator const& right) const {
+            return chunk == right.chunk && word == right.word && bits == right.bits;
+        }
+        bool operator!=(Iterator const& right) const { return !(*this == right); }
+
+    private:
+        friend class PoolAlloc;
+
+        Iterator(PoolAlloc* pool, size_t chunk) : pool(pool), chunk(chunk), word(0), bits(0), bit(0) {
+            static_assert(Tracking::enabled, "iterating needs the LiveBitmap policy");
+            if(chunk < pool->chunks.Count() && pool->bitmap_words > 0){
+                memory = pool->chunks.At(chunk);
+                bits = LoadBits(pool->Bitmap(memory)[0]);
+                if(bits != 0) bit = FindFirstSet(bits);
+                else NextWord();
+            } else {
+                this->chunk = pool->chunks.Count();
+            }
+        }
+
+        // On to the next word with a live slot in it, or to end(). Empty words only cost a
+        // load and a compare, the slot within a word comes from counting trailing zeros.
+        void NextWord(){
+            size_t chunk_count = pool->chunks.Count();
+            size_t words = pool->bitmap_words;
+            for(;;){
+                BitmapWord const* bitmap = pool->Bitmap(memory);
+                while(++word < words){
+                    bits = LoadBits(bitmap[word]);
+                    if(bits != 0){
+                        bit = FindFirstSet(bits);
+                        return;
+                    }
+                }
+                word = 0;
+                if(++chunk == chunk_count) return;
+                memory = pool->chunks.At(chunk);
+                bits = LoadBits(pool->Bitmap(memory)[0]);
+                if(bits != 0){
+                    bit = FindFirstSet(bits);
+                    return;
+                }
+            }
+        }
+
+        PoolAlloc* pool;
+        char* memory = nullptr; //the current chunk
+        size_t chunk;
+        size_t word;
+        uint64_t bits; //the live slots in word not visited yet
+        int bit; //the lowest of them
+    };
 };
@@ -0,0 +1,224 @@
+/*
+    -- Ring Allocator --
+
+    A linear allocator that wraps around. Like LinearAlloc, allocating just moves an offset
+    forward. Unlike LinearAlloc, nothing waits for a Reset(): memory comes back piece by piece,
+    oldest first, as the consumer finishes with it.
+
+    Every allocation is tagged with a fence value, the number the consumer will signal once it
+    is done with that memory. For a GPU upload that is the value the queue signals after the
+    copy. For a job pipeline it is whatever counter the consumer bumps. The ring keeps a short
+    list of (fence, end offset) pairs, and Reclaim() drops every pair whose fence has completed
+    and moves the tail up to where it ends:
+
+        tail                  head
+         v                     v
+        [ . . | 5 5 5 | 6 6 | 7 . . . . . ]   fence 5 completes
+        [ . . . . . . | 6 6 | 7 . . . . . ]   its bytes are free again
+
+    When an allocation doesn't fit before the end of the buffer the rest of the buffer is skipped
+    and it starts again at the beginning, so every allocation is one contiguous block. The skipped
+    bytes belong to the allocation and come back with it.
+
+    The Fence type only needs a CompletedValue() that returns the highest fence value signaled so
+    far. A wrapper around ID3D12Fence::GetCompletedValue() or a Vulkan timeline semaphore fits,
+    CpuFence is a stand-in for testing and for pipelines that stay on the CPU.
+
+        CpuFence uploaded;
+        RingAlloc<> ring(8 * 1024 * 1024, uploaded);
+        uint64_t frame = 0;
+        while(running){
+            frame++;
+            char* staging = ring.Allocate(texture_size, frame, 256);
+            if(staging == nullptr) ... ring is full of work still in flight, wait on the fence and retry
+            ... fill staging and queue the copy, the consumer calls uploaded.Signal(frame) when done ...
+        }
+
+    Fence values start at 1 and must never go down. An allocation with a lower value than the one
+    before it is kept until the higher one completes, which is safe but holds on longer.
+
+    One thread allocates. The consumer can be anywhere, it only ever touches the fence.
+    Nothing touches the heap after the constructor.
+
+    Use case: Streaming data to a consumer that runs behind the producer, like uploads to the
+    GPU, or the stages of a producer/consumer pipeline.
+*/
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#include <atomic>
+#include <new>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "alloc_stats.h"
+
+// A fence the consumer signals from the CPU
+class CpuFence {
+public:
+    // value must be higher than anything signaled before
+    void Signal(uint64_t value){
+        completed.store(value, std::memory_order_release);
+    }
+    uint64_t CompletedValue() const {
+        return completed.load(std::memory_order_acquire);
+    }
+    void Wait(uint64_t value) const {
+        while(CompletedValue() < value){
+            std::this_thread::yield();
+        }
+    }
+
+private:
+    std::atomic<uint64_t> completed{0};
+};
+
+template<typename Fence = CpuFence>
+class RingAlloc {
+public:
+    // max_pending_fences is how many different fence values can be outstanding at once. Past
+    // that, new allocations are added to the newest one, see AddToFence().
+    RingAlloc(size_t capacity, Fence const& fence, size_t max_pending_fences = 64) :
+        RingAlloc((char*)malloc(capacity), capacity, fence, max_pending_fences)
+    {
+        owns_data = true;
+    }
+    // Memory someone else owns, like a persistently mapped upload buffer. It won't be freed.
+    RingAlloc(char* memory, size_t capacity, Fence const& fence, size_t max_pending_fences = 64) :
+        data(memory),
+        capacity(memory != nullptr ? capacity : 0),
+        fence(fence),
+        pending(max_pending_fences > 0 ? max_pending_fences : 1)
+    {
+    }
+    ~RingAlloc(){
+        if(owns_data) free(data);
+    }
+
+    RingAlloc(RingAlloc const&) = delete;
+    RingAlloc& operator=(RingAlloc const&) = delete;
+
+    // Returns nullptr when the ring is full of memory whose fences haven't completed, or when
+    // size can never fit. alignment must be a power of two.
+    char* Allocate(size_t size, uint64_t fence_value, size_t alignment = alignof(max_align_t)){
+        size_t start = 0;
+        size_t consumed = Place(size, alignment, &start);
+        if(consumed > capacity - (head - tail)){
+            Reclaim(); //only ask the fence when we have to
+            consumed = Place(size, alignment, &start); //may start over at 0 now it's empty
+            if(consumed > capacity - (head - tail)){
+                stats.RecordFailure();
+                return nullptr;
+            }
+        }
+        head += consumed;
+        head_position = start + size;
+        AddToFence(fence_value);
+        stats.RecordAlloc(consumed); //padding and skipped bytes count as used
+        return data + start;
+    }
+
+    // Constructs a T in the ring. The destructor is never run, so only types which don't need
+    // one are allowed here.
+    template<typename T, typename... Args>
+    T* Create(uint64_t fence_value, Args&&... args){
+        static_assert(std::is_trivially_destructible<T>::value, "RingAlloc never runs destructors");
+        char* mem = Allocate(sizeof(T), fence_value, alignof(T));
+        if(mem == nullptr) return nullptr;
+        return new (mem) T(std::forward<Args>(args)...);
+    }
+
+    // Frees everything tagged with a completed fence, returns how many bytes came back.
+    // Allocate() calls this itself when it runs out of room.
+    size_t Reclaim(){
+        uint64_t completed = fence.CompletedValue();
+        size_t old_tail = tail;
+        while(pending_count > 0){
+            PendingFence& oldest = pending[pending_first];
+            if(oldest.value > completed) break;
+            stats.RecordRelease(oldest.end - tail, oldest.allocations);
+            tail = oldest.end;
+            pending_first = (pending_first + 1) % pending.size();
+            pending_count--;
+        }
+        if(head == tail) head_position = 0; //empty, start over at the top, fewer wraps
+        return tail - old_tail;
+    }
+
+    // Where ptr is from the start of the ring, for handing to an API that wants buffer offsets
+    size_t OffsetOf(const void* ptr) const { return (size_t)((const char*)ptr - data); }
+
+    char* Data() const { return data; }
+    size_t BytesUsed() const { return head - tail; }
+    size_t Capacity() const { return capacity; }
+    // How many different fence values are still holding on to memory
+    size_t PendingFences() const { return pending_count; }
+
+    AllocStats const& Stats() const { return stats; }
+
+private:
+    struct PendingFence {
+        uint64_t value;
+        size_t end; //head after the last allocation with this fence
+        size_t allocations;
+    };
+
+    static size_t AlignUp(char* base, size_t offset, size_t alignment){
+        uintptr_t aligned = ((uintptr_t)base + offset + (alignment - 1)) & ~(uintptr_t)(alignment - 1);
+        return (size_t)(aligned - (uintptr_t)base);
+    }
+
+    // Finds where size bytes would go and returns how far head has to move for them, which
+    // includes the padding and, if it wraps, the skipped end of the buffer. SIZE_MAX if it
+    // could never fit.
+    size_t Place(size_t size, size_t alignment, size_t* start) const {
+        size_t offset = AlignUp(data, head_position, alignment);
+        if(offset <= capacity && size <= capacity - offset){
+            *start = offset;
+            return offset - head_position + size;
+        }
+        offset = AlignUp(data, 0, alignment); //wrap around to the beginning
+        if(offset > capacity || size > capacity - offset) return SIZE_MAX;
+        *start = offset;
+        return (capacity - head_position) + offset + size;
+    }
+
+    // Allocations with the same fence as the newest pending one share its entry. When the list
+    // is full a new fence takes over the newest entry instead, which holds its memory back until
+    // the later fence completes.
+    void AddToFence(uint64_t fence_value){
+        if(pending_count == pending.size()) Reclaim();
+        if(pending_count > 0){
+            PendingFence& newest = pending[(pending_first + pending_count - 1) % pending.size()];
+            if(fence_value <= newest.value || pending_count == pending.size()){
+                if(fence_value > newest.value) newest.value = fence_value;
+                newest.end = head;
+                newest.allocations++;
+                return;
+            }
+        }
+        pending[(pending_first + pending_count) % pending.size()] = PendingFence{fence_value, head, 1};
+        pending_count++;
+    }
+
+    char* data;
+    size_t capacity;
+    bool owns_data = false;
+    Fence const& fence;
+
+    //head and tail only ever go up, the bytes in use are head - tail
+    size_t head = 0;
+    size_t tail = 0;
+    size_t head_position = 0; //where head is in the buffer
+
+    std::vector<PendingFence> pending; //a ring of its own, oldest at pending_first
+    size_t pending_first = 0;
+    size_t pending_count = 0;
+
+    AllocStats stats;
+};
@@ -0,0 +1,180 @@
+/*
+    -- Slot Map --
+
+    The 'manager owns the data, elements refer to each other by id' idea from the smart pointer
+    section of the c++ tutorial. Instead of a shared_ptr (with its reference counted control block)
+    you get a Handle: a 32 bit value made of an index into a table plus a generation counter.
+
+    Lookup: handle.index picks an entry in the slot table, which says where the object currently
+    lives in the dense array. O(1), no hashing.
+
+    Stale handles: every time a slot is freed its generation goes up. A handle with an old
+    generation no longer matches and Get() returns nullptr instead of someone else's object.
+    Once a slot has used up all its generations it is retired instead of starting over, so an
+    old handle can never match again. That costs one slot table entry (8 bytes) per 4095
+    removes of the same slot, and retired slots count towards max_objects.
+
+    Dense storage: the objects themselves sit packed at the front of one array. Removing an
+    object moves the last one into the hole, so iterating with begin()/end() walks memory in order
+    with no gaps.
+
+    Free slot table entries are chained into a free list through the entries themselves, the same
+    trick PoolAlloc uses for its slots.
+
+        SlotMap<Node> nodes;
+        SlotMap<Node>::Handle a = nodes.Insert(...);
+        SlotMap<Node>::Handle b = nodes.Insert(...);
+        nodes.Get(a)->neighbour = b; //no pointer, so no dangling if b gets removed
+        for(Node& n : nodes) { ... }
+
+    Pointers returned by Get() are only valid until the next Insert() or Remove(), keep handles
+    around instead.
+
+    Use case: Graphs and other highly connected data, entity/component storage.
+*/
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <utility>
+#include <vector>
+
+template<typename T>
+class SlotMap {
+public:
+    static constexpr uint32_t index_bits = 20; //about a million live objects
+    static constexpr uint32_t generation_bits = 32 - index_bits;
+    static constexpr uint32_t max_objects = (1u << index_bits) - 1;
+
+    struct Handle {
+        uint32_t value = 0; //generation starts at 1, so 0 is never a valid handle
+
+        uint32_t Index() const { return value & max_objects; }
+        uint32_t Generation() const { return value >> index_bits; }
+
+        bool operator==(Handle const& right) const { return value == right.value; }
+        bool operator!=(Handle const& right) const { return value != right.value; }
+    };
+
+    SlotMap(size_t reserve_count = 0){
+        objects.reserve(reserve_count);
+        dense_to_slot.reserve(reserve_count);
+        slots.reserve(reserve_count);
+    }
+
+    // Returns an invalid handle if all max_objects slots are in use. If T's constructor (or
+    // growing one of the arrays) throws, the map is left as it was.
+    template<typename... Args>
+    Handle Insert(Args&&... args){
+        bool new_slot = free_head == end_of_list;
+        if(new_slot && slots.size() >= max_objects){
+            return Handle{};
+        }
+        uint32_t slot_index = new_slot ? (uint32_t)slots.size() : free_head;
+        uint32_t dense_index = (uint32_t)objects.size();
+
+        //the object first, the free list is only touched once nothing can throw anymore
+        objects.emplace_back(std::forward<Args>(args)...);
+        try {
+            dense_to_slot.push_back(slot_index);
+            if(new_slot) slots.push_back(Slot{0, 1});
+        } catch(...) {
+            if(dense_to_slot.size() > dense_index) dense_to_slot.pop_back();
+            objects.pop_back();
+            throw;
+        }
+
+        Slot& slot = slots[slot_index];
+        if(!new_slot) free_head = slot.dense_or_next_free;
+        slot.dense_or_next_free = dense_index;
+        return MakeHandle(slot_index, slot.generation);
+    }
+
+    // Returns false if the handle was already stale
+    bool Remove(Handle handle){
+        if(!IsValid(handle)) return false;
+
+        uint32_t slot_index = handle.Index();
+        uint32_t dense_index = slots[slot_index].dense_or_next_free;
+        uint32_t last = (uint32_t)objects.size() - 1;
+
+        //move the last object into the hole to keep things packed
+        if(dense_index != last){
+            objects[dense_index] = std::move(objects[last]);
+            dense_to_slot[dense_index] = dense_to_slot[last];
+            slots[dense_to_slot[dense_index]].dense_or_next_free = dense_index;
+        }
+        objects.pop_back();
+        dense_to_slot.pop_back();
+
+        //bump the generation so outstanding handles go stale. Wrapping around would make the
+        //oldest ones match again, so a slot out of generations is retired, never to be reused
+        Slot& slot = slots[slot_index];
+        if(slot.generation == max_generation){
+            slot.generation = retired;
+            return true;
+        }
+        slot.generation++;
+        slot.dense_or_next_free = free_head;
+        free_head = slot_index;
+        return true;
+    }
+
+    bool IsValid(Handle handle) const {
+        uint32_t slot_index = handle.Index();
+        return handle.Generation() != retired && slot_index < slots.size() &&
+            slots[slot_index].generation == handle.Generation();
+    }
+
+    // nullptr for stale handles
+    T* Get(Handle handle){
+        if(!IsValid(handle)) return nullptr;
+        return &objects[slots[handle.Index()].dense_or_next_free];
+    }
+    const T* Get(Handle handle) const {
+        if(!IsValid(handle)) return nullptr;
+        return &objects[slots[handle.Index()].dense_or_next_free];
+    }
+
+    // The handle of the object at position dense_index while iterating
+    Handle HandleAt(size_t dense_index) const {
+        uint32_t slot_index = dense_to_slot[dense_index];
+        return MakeHandle(slot_index, slots[slot_index].generation);
+    }
+
+    void Clear(){
+        while(!objects.empty()){
+            Remove(HandleAt(objects.size() - 1));
+        }
+    }
+
+    size_t Size() const { return objects.size(); }
+    bool Empty() const { return objects.empty(); }
+
+    T* begin() { return objects.data(); }
+    T* end() { return objects.data() + objects.size(); }
+    const T* begin() const { return objects.data(); }
+    const T* end() const { return objects.data() + objects.size(); }
+
+private:
+    static constexpr uint32_t end_of_list = 0xFFFFFFFF;
+    static constexpr uint32_t max_generation = (1u << generation_bits) - 1;
+    static constexpr uint32_t retired = 0; //no handle has generation 0, so nothing matches
+
+    struct Slot {
+        uint32_t dense_or_next_free; //index into objects while alive, next free slot while not
+        uint32_t generation;
+    };
+
+    static Handle MakeHandle(uint32_t slot_index, uint32_t generation){
+        Handle handle;
+        handle.value = (generation << index_bits) | slot_index;
+        return handle;
+    }
+
+    std::vector<T> objects;
+    std::vector<uint32_t> dense_to_slot;
+    std::vector<Slot> slots;
+    uint32_t free_head = end_of_list;
+};
@@ -0,0 +1,156 @@
+/*
+    -- Small Object Allocator --
+
+    Most heap traffic in a game is small objects of assorted sizes. A PoolAlloc handles one size
+    really well, so this allocator keeps a pool per size class (16, 32, 48, 64, 96, 128, 192 and
+    256 bytes) and rounds every request up to the nearest class. Anything bigger than the largest
+    class goes down the large block path, which is plain malloc.
+
+    Free() only gets the pointer, not the size. To find the right pool without a header per
+    allocation, all the pools live side by side in one region, each pool getting an equal share:
+
+        [ 16 byte pool | 32 byte pool | 48 byte pool | ... | 256 byte pool ]
+
+    A pointer inside the region belongs to pool (pointer - region start) / share. A pointer
+    outside of it came from malloc. If a size class runs out of room it falls back to malloc
+    too, so the region size is a performance knob and not a hard limit. Allocations from malloc
+    get a 16 byte header in front that remembers their size, for the stats.
+
+        SmallObjectAlloc small(1024 * 1024); //1 MB per size class
+        void* p = small.Allocate(40); //comes out of the 48 byte pool
+        small.Free(p);
+
+    Use case: Lots of small, variable size, individually freed objects.
+*/
+#pragma once
+
+#include <stdlib.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include <tuple>
+
+#include "alloc_stats.h"
+#include "pool_alloc.h"
+
+class SmallObjectAlloc {
+public:
+    static constexpr size_t max_small_size = 256;
+
+    SmallObjectAlloc(size_t bytes_per_class) :
+        bytes_per_class(bytes_per_class),
+        region((char*)malloc(bytes_per_class * class_count)),
+        pools(Share(0), Share(1), Share(2), Share(3), Share(4), Share(5), Share(6), Share(7))
+    {
+    }
+    ~SmallObjectAlloc(){
+        free(region);
+    }
+
+    SmallObjectAlloc(SmallObjectAlloc const&) = delete;
+    SmallObjectAlloc& operator=(SmallObjectAlloc const&) = delete;
+
+    // Small results are 16 byte aligned, like malloc
+    void* Allocate(size_t size){
+        if(size > max_small_size){
+            return AllocateLarge(size);
+        }
+        int size_class = size_to_class[(size + 15) / 16];
+        void* mem = AllocateFromClass(size_class);
+        if(mem == nullptr){
+            return AllocateLarge(size); //this class is full
+        }
+        stats.RecordAlloc(class_sizes[size_class]);
+        return mem;
+    }
+
+    void Free(void* mem){
+        if(mem == nullptr) return;
+        uintptr_t offset = (uintptr_t)mem - (uintptr_t)region; //wraps around when below the region
+        if(region == nullptr || offset >= bytes_per_class * class_count){
+            FreeLarge(mem); //not from any pool
+            return;
+        }
+        int size_class = (int)(offset / bytes_per_class);
+        FreeToClass(size_class, mem);
+        stats.RecordFree(class_sizes[size_class]);
+    }
+
+    AllocStats const& Stats() const { return stats; }
+
+private:
+    static constexpr int class_count = 8;
+
+    static constexpr size_t class_sizes[class_count] = {16, 32, 48, 64, 96, 128, 192, 256};
+    static constexpr size_t large_header = 16; //keeps the result 16 byte aligned
+
+    // the size of an allocation in 16 byte steps -> size class
+    static constexpr unsigned char size_to_class[max_small_size / 16 + 1] = {
+        0, 0, 1, 2, 3, 4, 4, 5, 5, 6, 6, 6, 6, 7, 7, 7, 7
+    };
+
+    template<size_t size>
+    struct alignas(16) Block {
+        unsigned char bytes[size];
+    };
+
+    // a pool over one share of the region, the memory is owned by SmallObjectAlloc
+    struct Range {
+        char* memory;
+        size_t size;
+    };
+    template<size_t size>
+    using FixedPool = PoolAlloc<Block<size>, DefaultChecks, SingleThreaded, FixedGrowth>;
+    template<size_t size>
+    struct ClassPool : FixedPool<size> {
+        ClassPool(Range range) : FixedPool<size>(range.memory, range.size) {}
+    };
+
+    void* AllocateLarge(size_t size){
+        char* mem = (size <= SIZE_MAX - large_header) ? (char*)malloc(size + large_header) : nullptr;
+        if(mem == nullptr){
+            stats.RecordFailure();
+            return nullptr;
+        }
+        *(size_t*)mem = size;
+        stats.RecordAlloc(size);
+        return mem + large_header;
+    }
+    void FreeLarge(void* mem){
+        char* start = (char*)mem - large_header;
+        stats.RecordFree(*(size_t*)start);
+        free(start);
+    }
+
+    Range Share(int size_class){
+        if(region == nullptr) return Range{nullptr, 0};
+        return Range{region + bytes_per_class * size_class, bytes_per_class};
+    }
+
+    //walks the tuple at compile time, the compiler turns it into a jump table or a few compares
+    template<int index = 0>
+    void* AllocateFromClass(int size_class){
+        if constexpr(index < class_count){
+            if(size_class == index) return std::get<index>(pools).AllocateSlot();
+            return AllocateFromClass<index + 1>(size_class);
+        } else {
+            return nullptr;
+        }
+    }
+    template<int index = 0>
+    void FreeToClass(int size_class, void* mem){
+        if constexpr(index < class_count){
+            if(size_class == index){
+                std::get<index>(pools).FreeSlot(mem);
+                return;
+            }
+            FreeToClass<index + 1>(size_class, mem);
+        }
+    }
+
+    size_t bytes_per_class;
+    char* region;
+    std::tuple<ClassPool<16>, ClassPool<32>, ClassPool<48>, ClassPool<64>,
+               ClassPool<96>, ClassPool<128>, ClassPool<192>, ClassPool<256>> pools;
+    AllocStats stats;
+};
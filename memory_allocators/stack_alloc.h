@@ -0,0 +1,135 @@
+/*
+    -- Stack Allocator --
+
+    Sits between the linear allocator and a general purpose one. It bumps an offset just like
+    LinearAlloc, but every allocation gets a small header placed right in front of it:
+
+        [ padding | Header | user memory ... ][ padding | Header | user memory ... ]
+                                               ^ top
+
+    The header remembers how many bytes the allocation moved the offset by (the padding
+    for alignment plus the header itself) and where the previous allocation started. That makes
+    Free() possible, as long as allocations are freed in the reverse order they were made (LIFO),
+    just like the call stack. Freeing rolls the offset back, so there is never any fragmentation.
+
+    In debug builds (NDEBUG not defined) freeing anything other than the most recent allocation
+    trips an assert, since that would silently throw away everything allocated after it.
+
+    Markers work like LinearAlloc's: GetMarker() remembers the top of the stack and RewindTo()
+    frees everything allocated after it in one go, without the individual Free() calls.
+
+    Use case: Scratch memory with strictly nested lifetimes where individual allocations still
+    need to be given back, like temporaries in a recursive algorithm.
+*/
+#pragma once
+
+#include <assert.h>
+#include <stdlib.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "alloc_stats.h"
+
+class StackAlloc {
+public:
+    StackAlloc(size_t total_size) :
+        location(0),
+        top(no_allocation),
+        total_size(total_size)
+    {
+        data = (char*)malloc(total_size);
+    }
+    ~StackAlloc(){
+        free(data);
+    }
+
+    StackAlloc(StackAlloc const&) = delete;
+    StackAlloc& operator=(StackAlloc const&) = delete;
+
+    // alignment must be a power of two
+    char* Allocate(size_t size, size_t alignment = alignof(max_align_t)){
+        if(alignment < alignof(Header)) alignment = alignof(Header);
+
+        //leave room for the header, then align what comes after it
+        uintptr_t base = (uintptr_t)data;
+        uintptr_t user = (base + location + sizeof(Header) + (alignment - 1)) & ~(uintptr_t)(alignment - 1);
+        size_t offset = (size_t)(user - base);
+
+        if(data == nullptr || offset > total_size || size > total_size - offset){
+            stats.RecordFailure();
+            return nullptr; //out of space
+        }
+        stats.RecordAlloc(offset + size - location);
+
+        Header* header = (Header*)(data + offset) - 1;
+        header->adjustment = (uint32_t)(offset - location);
+        header->previous_top = top;
+
+        top = offset;
+        location = offset + size;
+        return data + offset;
+    }
+
+    // Must be the most recent allocation that hasn't been freed yet
+    void Free(void* mem){
+        if(mem == nullptr) return;
+
+        size_t offset = (size_t)((char*)mem - data);
+        assert(offset == top && "StackAlloc::Free called out of LIFO order");
+
+        Header* header = (Header*)mem - 1;
+        size_t new_location = offset - header->adjustment;
+        stats.RecordFree(location - new_location);
+        location = new_location;
+        top = header->previous_top;
+    }
+
+    // The top of the stack, to RewindTo() later
+    struct Marker {
+        size_t location;
+        size_t top;
+    };
+
+    Marker GetMarker() const {
+        return Marker{location, top};
+    }
+
+    // Frees everything allocated after marker. Markers from 'the future', taken while the stack
+    // was higher than it is now, are ignored.
+    void RewindTo(Marker marker){
+        if(marker.location > location) return;
+        size_t objects = 0;
+        for(size_t offset = top; offset != marker.top && offset != no_allocation; objects++){
+            offset = ((Header*)(data + offset) - 1)->previous_top;
+        }
+        stats.RecordRelease(location - marker.location, objects);
+        location = marker.location;
+        top = marker.top;
+    }
+
+    // Throws away every allocation at once
+    void Reset(){
+        stats.RecordReset();
+        location = 0;
+        top = no_allocation;
+    }
+
+    size_t BytesUsed() const { return location; }
+    size_t Capacity() const { return total_size; }
+
+    AllocStats const& Stats() const { return stats; }
+
+private:
+    static constexpr size_t no_allocation = SIZE_MAX;
+
+    struct Header {
+        size_t previous_top; //offset of the allocation made before this one
+        uint32_t adjustment; //how far the offset moved before the user memory: padding + header
+    };
+
+    char* data;
+    size_t location;
+    size_t top; //offset of the most recent allocation's user memory
+    size_t total_size;
+    AllocStats stats;
+};
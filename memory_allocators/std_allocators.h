@@ -0,0 +1,186 @@
+/*
+    -- Standard Library Adapters --
+
+    Lets std containers get their memory from LinearAlloc and PoolAlloc instead of the global
+    operator new. There are two flavours, both do the same thing.
+
+    std::pmr (C++17): LinearMemoryResource and PoolMemoryResource derive from
+    std::pmr::memory_resource, so they plug into std::pmr::vector, std::pmr::string,
+    std::pmr::unordered_map and friends. The allocator is picked at runtime and doesn't change the
+    container type, at the cost of a virtual call per allocation.
+
+        LinearAlloc frame(1024 * 1024);
+        LinearMemoryResource frame_resource(frame);
+        std::pmr::vector<int> visible(&frame_resource);
+
+    Classic allocators: LinearStlAllocator<T> and PoolStlAllocator<T> fill in the Allocator
+    requirements, so they go in the container's template arguments. No virtual calls, but the
+    allocator becomes part of the type.
+
+        PoolMemoryResource<64> node_pool(1024);
+        std::list<Node, PoolStlAllocator<Node, 64>> nodes(PoolStlAllocator<Node, 64>(node_pool));
+
+    Frame containers go in the linear allocator: nothing is freed until the arena is Reset(),
+    so a vector that grows leaves its old buffers behind. Node based containers (std::list, std::map,
+    std::unordered_map nodes) fit a pool, one node per block. Requests that don't fit in a pool
+    block, like the bucket array of an unordered_map, are passed on to an upstream resource.
+*/
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <memory_resource>
+#include <new>
+
+#include "linear_alloc.h"
+#include "pool_alloc.h"
+
+/* LINEAR ALLOCATOR */
+
+class LinearMemoryResource : public std::pmr::memory_resource {
+public:
+    explicit LinearMemoryResource(LinearAlloc& arena) : arena(arena) {}
+
+    LinearAlloc& Arena() { return arena; }
+
+private:
+    void* do_allocate(size_t bytes, size_t alignment) override {
+        void* mem = arena.Allocate(bytes, alignment);
+        if(mem == nullptr){
+            throw std::bad_alloc(); //memory resources must not return nullptr
+        }
+        return mem;
+    }
+    void do_deallocate(void*, size_t, size_t) override {
+        // Does nothing! The arena gets Reset() as a whole
+    }
+    bool do_is_equal(std::pmr::memory_resource const& other) const noexcept override {
+        return this == &other;
+    }
+
+    LinearAlloc& arena;
+};
+
+template<typename T>
+class LinearStlAllocator {
+public:
+    using value_type = T;
+
+    explicit LinearStlAllocator(LinearAlloc& arena) : arena(&arena) {}
+
+    //containers rebind the allocator to their internal node types
+    template<typename U>
+    LinearStlAllocator(LinearStlAllocator<U> const& other) : arena(other.arena) {}
+
+    T* allocate(size_t count){
+        if(count > SIZE_MAX / sizeof(T)) throw std::bad_array_new_length();
+        void* mem = arena->Allocate(sizeof(T) * count, alignof(T));
+        if(mem == nullptr){
+            throw std::bad_alloc();
+        }
+        return (T*)mem;
+    }
+    void deallocate(T*, size_t){
+        // Does nothing!
+    }
+
+    template<typename U>
+    bool operator==(LinearStlAllocator<U> const& right) const { return arena == right.arena; }
+    template<typename U>
+    bool operator!=(LinearStlAllocator<U> const& right) const { return arena != right.arena; }
+
+private:
+    template<typename U> friend class LinearStlAllocator;
+    LinearAlloc* arena;
+};
+
+/* POOL ALLOCATOR */
+
+// A pool of raw blocks of block_size bytes. Anything bigger, or more aligned, goes upstream.
+template<size_t block_size, size_t block_alignment = alignof(max_align_t)>
+class PoolMemoryResource : public std::pmr::memory_resource {
+public:
+    PoolMemoryResource(size_t blocks_per_chunk,
+        std::pmr::memory_resource* upstream = std::pmr::get_default_resource()) :
+        pool(blocks_per_chunk),
+        upstream(upstream)
+    {
+    }
+
+    // Non virtual versions, used directly by PoolStlAllocator
+    void* Allocate(size_t bytes, size_t alignment){
+        if(!FitsBlock(bytes, alignment)){
+            return upstream->allocate(bytes, alignment);
+        }
+        void* mem = pool.AllocateSlot();
+        if(mem == nullptr){
+            throw std::bad_alloc();
+        }
+        return mem;
+    }
+    void Deallocate(void* mem, size_t bytes, size_t alignment){
+        if(!FitsBlock(bytes, alignment)){
+            upstream->deallocate(mem, bytes, alignment);
+            return;
+        }
+        pool.FreeSlot(mem);
+    }
+
+    static bool FitsBlock(size_t bytes, size_t alignment){
+        return bytes <= block_size && alignment <= block_alignment;
+    }
+
+private:
+    struct alignas(block_alignment) Block {
+        unsigned char bytes[block_size];
+    };
+
+    void* do_allocate(size_t bytes, size_t alignment) override {
+        return Allocate(bytes, alignment);
+    }
+    void do_deallocate(void* mem, size_t bytes, size_t alignment) override {
+        Deallocate(mem, bytes, alignment);
+    }
+    bool do_is_equal(std::pmr::memory_resource const& other) const noexcept override {
+        return this == &other;
+    }
+
+    PoolAlloc<Block> pool;
+    std::pmr::memory_resource* upstream;
+};
+
+template<typename T, size_t block_size, size_t block_alignment = alignof(max_align_t)>
+class PoolStlAllocator {
+public:
+    using value_type = T;
+    using Resource = PoolMemoryResource<block_size, block_alignment>;
+
+    //the block size is part of the template arguments, so rebind has to be spelled out
+    template<typename U>
+    struct rebind {
+        using other = PoolStlAllocator<U, block_size, block_alignment>;
+    };
+
+    explicit PoolStlAllocator(Resource& resource) : resource(&resource) {}
+
+    template<typename U>
+    PoolStlAllocator(PoolStlAllocator<U, block_size, block_alignment> const& other) : resource(other.resource) {}
+
+    T* allocate(size_t count){
+        if(count > SIZE_MAX / sizeof(T)) throw std::bad_array_new_length();
+        return (T*)resource->Allocate(sizeof(T) * count, alignof(T));
+    }
+    void deallocate(T* mem, size_t count){
+        resource->Deallocate(mem, sizeof(T) * count, alignof(T));
+    }
+
+    template<typename U>
+    bool operator==(PoolStlAllocator<U, block_size, block_alignment> const& right) const { return resource == right.resource; }
+    template<typename U>
+    bool operator!=(PoolStlAllocator<U, block_size, block_alignment> const& right) const { return resource != right.resource; }
+
+private:
+    template<typename U, size_t, size_t> friend class PoolStlAllocator;
+    Resource* resource;
+};
@@ -0,0 +1,312 @@
+/*
+    -- TLSF Allocator --
+
+    Two Level Segregated Fit, a general purpose allocator for blocks of any size where both
+    Allocate() and Free() take a bounded, constant amount of time. malloc is usually faster on
+    average but every now and then takes a long detour, TLSF never does. When the worst frame
+    matters more than the average one, that is the better trade.
+
+    Free blocks are sorted into size classes in two levels. The first level is the power of two
+    (512-1023, 1024-2047, ...) and the second level splits each of those into 32 equal steps.
+    Every class has its own list of free blocks, and two levels of bitmaps record which lists are
+    non-empty. Finding a big enough block is then two 'find first set bit' instructions instead
+    of a search.
+
+    Every block starts with a header holding its size and a pointer to the block physically before
+    it. Free blocks also keep their free list links where the user data would be. On Free() the
+    block is merged with free neighbours on both sides (coalescing), so free memory doesn't get
+    chopped up into pieces too small to use.
+
+    The memory comes from the caller, TLSF never asks the OS for anything:
+
+        static char heap_memory[16 * 1024 * 1024];
+        TlsfAlloc heap(heap_memory, sizeof(heap_memory));
+        void* p = heap.Allocate(300);
+        heap.Free(p);
+
+    Use case: Long lived objects of all sorts of sizes, where latency spikes are not acceptable.
+*/
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+#include "alloc_stats.h"
+
+class TlsfAlloc {
+public:
+    TlsfAlloc(void* memory, size_t size){
+        first_level_bitmap = 0;
+        memset(second_level_bitmap, 0, sizeof(second_level_bitmap));
+        memset(free_lists, 0, sizeof(free_lists));
+
+        //line the start up and leave room for the first header and the end sentinel
+        uintptr_t start = ((uintptr_t)memory + (alignment - 1)) & ~(uintptr_t)(alignment - 1);
+        uintptr_t end = ((uintptr_t)memory + size) & ~(uintptr_t)(alignment - 1);
+        if(memory == nullptr || end < start + 2 * header_size + min_block_size){
+            return; //too small to hold anything, every Allocate() fails
+        }
+        size_t usable = (size_t)(end - start) - 2 * header_size;
+        if(usable > max_block_size){
+            usable = max_block_size;
+        }
+
+        Block* block = (Block*)start;
+        block->prev_physical = nullptr;
+        block->size = usable; //not free yet, so not marked free
+        InsertFree(block);
+
+        //a zero sized block at the end that is never free, so every block has a next neighbour
+        Block* sentinel = NextPhysical(block);
+        sentinel->prev_physical = block;
+        sentinel->size = 0 | prev_free_bit;
+    }
+
+    TlsfAlloc(TlsfAlloc const&) = delete;
+    TlsfAlloc& operator=(TlsfAlloc const&) = delete;
+
+    // Returns nullptr when no free block is big enough. alignment must be a power of two
+    void* Allocate(size_t size, size_t align = alignment){
+        void* mem = AllocateBlock(size, align);
+        if(mem == nullptr){
+            stats.RecordFailure();
+        }
+        return mem;
+    }
+
+    void Free(void* mem){
+        if(mem == nullptr) return;
+
+        Block* block = (Block*)((char*)mem - header_size);
+        bytes_used -= BlockSize(block);
+        stats.RecordFree(BlockSize(block));
+        block->size |= free_bit;
+        Block* next = NextPhysical(block);
+        next->size |= prev_free_bit;
+
+        //merge with the neighbours if they are free too
+        if(block->size & prev_free_bit){
+            Block* prev = block->prev_physical;
+            RemoveFree(prev);
+            prev->size += header_size + BlockSize(block);
+            block = prev;
+            next->prev_physical = block;
+        }
+        if(next->size & free_bit){
+            RemoveFree(next);
+            block->size += header_size + BlockSize(next);
+            NextPhysical(block)->prev_physical = block;
+        }
+        InsertFree(block);
+    }
+
+    size_t BytesUsed() const { return bytes_used; }
+
+    AllocStats const& Stats() const { return stats; }
+
+private:
+    void* AllocateBlock(size_t size, size_t align){
+        if(size == 0) size = 1;
+        if(size > max_block_size) return nullptr;
+        size = AdjustSize(size);
+
+        if(align <= alignment){
+            Block* block = FindFree(size);
+            if(block == nullptr) return nullptr;
+            return UseBlock(block, size);
+        }
+
+        //over aligned: ask for enough extra that a free block can be split off the front
+        size_t padded = size + align + header_size + min_block_size;
+        if(padded > max_block_size) return nullptr;
+        Block* block = FindFree(AdjustSize(padded));
+        if(block == nullptr) return nullptr;
+
+        uintptr_t payload = (uintptr_t)Payload(block);
+        uintptr_t aligned = (payload + (align - 1)) & ~(uintptr_t)(align - 1);
+        size_t gap = (size_t)(aligned - payload);
+        if(gap != 0 && gap < header_size + min_block_size){
+            //the front piece would be too small to be a block, move along to the next boundary
+            aligned += align;
+            gap += align;
+        }
+        if(gap != 0){
+            //the front piece becomes its own free block, the rest starts at the aligned address
+            Block* front = block;
+            Block* rest = (Block*)(aligned - header_size);
+            rest->size = BlockSize(front) - gap; //rest is also free, not in a list yet
+            rest->prev_physical = front;
+            NextPhysical(rest)->prev_physical = rest;
+            front->size = (gap - header_size) | (front->size & prev_free_bit) | free_bit;
+            rest->size |= free_bit | prev_free_bit;
+            InsertFree(front);
+            block = rest;
+        }
+        return UseBlock(block, size);
+    }
+
+    static constexpr size_t alignment = 16;
+    static constexpr size_t alignment_log2 = 4;
+
+    //second level: 32 classes per power of two
+    static constexpr int sl_count_log2 = 5;
+    static constexpr int sl_count = 1 << sl_count_log2;
+
+    //below 512 bytes the classes are a linear 16 bytes apart instead
+    static constexpr int fl_shift = sl_count_log2 + alignment_log2;
+    static constexpr int fl_max = 38; //biggest block is just under 256 GB
+    static constexpr int fl_count = fl_max - fl_shift + 1;
+    static constexpr size_t small_block_size = (size_t)1 << fl_shift;
+    static constexpr size_t max_block_size = ((size_t)1 << fl_max) - alignment;
+
+    static constexpr size_t free_bit = 1;
+    static constexpr size_t prev_free_bit = 2;
+    static constexpr size_t flag_bits = free_bit | prev_free_bit;
+
+    struct Block {
+        Block* prev_physical; //only meaningful while prev_free_bit is set
+        size_t size; //payload size, the low bits hold the flags
+        //only used while the block is free, otherwise this is where the user data starts
+        Block* next_free;
+        Block* prev_free;
+    };
+
+    static constexpr size_t header_size = offsetof(Block, next_free);
+    static constexpr size_t min_block_size = sizeof(Block) - header_size;
+
+    static_assert(header_size % alignment == 0, "payloads have to stay aligned");
+
+    /* BIT TRICKS */
+
+    // index of the highest set bit
+    static int FindLastSet(size_t value){
+#if defined(_MSC_VER)
+        unsigned long index;
+        _BitScanReverse64(&index, (unsigned long long)value);
+        return (int)index;
+#else
+        return 63 - __builtin_clzll((unsigned long long)value);
+#endif
+    }
+    // index of the lowest set bit
+    static int FindFirstSet(uint32_t value){
+#if defined(_MSC_VER)
+        unsigned long index;
+        _BitScanForward(&index, value);
+        return (int)index;
+#else
+        return __builtin_ctz(value);
+#endif
+    }
+
+    /* BLOCK HELPERS */
+
+    static size_t BlockSize(Block* block) { return block->size & ~flag_bits; }
+    static char* Payload(Block* block) { return (char*)block + header_size; }
+    static Block* NextPhysical(Block* block) {
+        return (Block*)(Payload(block) + BlockSize(block));
+    }
+
+    static size_t AdjustSize(size_t size){
+        size = (size + (alignment - 1)) & ~(alignment - 1);
+        return size < min_block_size ? min_block_size : size;
+    }
+
+    // which free list a block of this size lives in
+    static void Mapping(size_t size, int& fl, int& sl){
+        if(size < small_block_size){
+            fl = 0;
+            sl = (int)(size / (small_block_size / sl_count));
+        } else {
+            int last = FindLastSet(size);
+            sl = (int)(size >> (last - sl_count_log2)) ^ sl_count;
+            fl = last - (fl_shift - 1);
+        }
+    }
+
+    /* FREE LISTS */
+
+    void InsertFree(Block* block){
+        int fl, sl;
+        Mapping(BlockSize(block), fl, sl);
+        Block* head = free_lists[fl][sl];
+        block->next_free = head;
+        block->prev_free = nullptr;
+        if(head != nullptr) head->prev_free = block;
+        free_lists[fl][sl] = block;
+        first_level_bitmap |= 1u << fl;
+        second_level_bitmap[fl] |= 1u << sl;
+        block->size |= free_bit;
+    }
+
+    void RemoveFree(Block* block){
+        int fl, sl;
+        Mapping(BlockSize(block), fl, sl);
+        if(block->prev_free != nullptr) block->prev_free->next_free = block->next_free;
+        if(block->next_free != nullptr) block->next_free->prev_free = block->prev_free;
+        if(free_lists[fl][sl] == block){
+            free_lists[fl][sl] = block->next_free;
+            if(block->next_free == nullptr){
+                second_level_bitmap[fl] &= ~(1u << sl);
+                if(second_level_bitmap[fl] == 0){
+                    first_level_bitmap &= ~(1u << fl);
+                }
+            }
+        }
+    }
+
+    // Takes a free block of at least size bytes out of its list, or nullptr
+    Block* FindFree(size_t size){
+        //round up to the next class boundary, so any block in the class found is big enough
+        if(size >= small_block_size){
+            size_t round = ((size_t)1 << (FindLastSet(size) - sl_count_log2)) - 1;
+            size += round;
+        }
+        int fl, sl;
+        Mapping(size, fl, sl);
+        if(fl >= fl_count) return nullptr;
+
+        uint32_t sl_map = second_level_bitmap[fl] & (~0u << sl);
+        if(sl_map == 0){
+            //nothing in this power of two, take the smallest class of the next one that has any
+            uint32_t fl_map = fl + 1 < 32 ? first_level_bitmap & (~0u << (fl + 1)) : 0;
+            if(fl_map == 0) return nullptr;
+            fl = FindFirstSet(fl_map);
+            sl_map = second_level_bitmap[fl];
+        }
+        sl = FindFirstSet(sl_map);
+
+        Block* block = free_lists[fl][sl];
+        RemoveFree(block);
+        return block;
+    }
+
+    // Splits off what isn't needed as a new free block and marks the rest used
+    void* UseBlock(Block* block, size_t size){
+        size_t block_size = BlockSize(block);
+        if(block_size >= size + header_size + min_block_size){
+            Block* rest = (Block*)(Payload(block) + size);
+            rest->size = block_size - size - header_size;
+            rest->prev_physical = block;
+            NextPhysical(rest)->prev_physical = rest;
+            block->size = size | (block->size & flag_bits);
+            InsertFree(rest);
+        }
+        block->size &= ~free_bit;
+        NextPhysical(block)->size &= ~prev_free_bit;
+        bytes_used += BlockSize(block);
+        stats.RecordAlloc(BlockSize(block));
+        return Payload(block);
+    }
+
+    uint32_t first_level_bitmap;
+    uint32_t second_level_bitmap[fl_count];
+    Block* free_lists[fl_count][sl_count];
+    size_t bytes_used = 0;
+    AllocStats stats;
+};
@@ -0,0 +1,150 @@
+/*
+    -- Virtual Memory --
+
+    A thin wrapper over the OS calls for managing address space directly, used by the allocators
+    with the VirtualGrowth policy (see alloc_policies.h).
+
+    The trick is that reserving and committing are two separate steps. Reserving claims a range
+    of addresses but no actual memory, so reserving 64 GB on a 64 bit machine is fine. Committing
+    a page inside that range makes it usable, and only then does it count towards the process's
+    memory usage. An allocator can therefore reserve for the worst case, commit as it grows, and
+    never has to move anything because the addresses were set aside from the start.
+
+    Huge pages (2 MB instead of 4 KB on x86) mean fewer TLB misses when walking over a lot of memory.
+    On Linux the hint asks for transparent huge pages. On Windows large pages need special
+    privileges and can't be committed piece by piece, so the hint is ignored there.
+
+    MapFile() maps a whole file read-only. Nothing is read up front, each page comes in from the
+    file (or the OS's file cache) the first time it is touched, see arena_snapshot.h.
+*/
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace virtual_memory {
+
+inline size_t PageSize(){
+#if defined(_WIN32)
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return (size_t)info.dwPageSize;
+#else
+    return (size_t)sysconf(_SC_PAGESIZE);
+#endif
+}
+
+inline size_t RoundUpToPage(size_t size){
+    size_t page = PageSize();
+    return (size + page - 1) / page * page;
+}
+
+// Returns the start of the range or nullptr. Nothing in it is usable until committed.
+inline void* Reserve(size_t size, bool huge_pages = false){
+#if defined(_WIN32)
+    (void)huge_pages;
+    return VirtualAlloc(nullptr, size, MEM_RESERVE, PAGE_NOACCESS);
+#else
+    void* mem = mmap(nullptr, size, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if(mem == MAP_FAILED){
+        return nullptr;
+    }
+#if defined(MADV_HUGEPAGE)
+    if(huge_pages){
+        madvise(mem, size, MADV_HUGEPAGE);
+    }
+#else
+    (void)huge_pages;
+#endif
+    return mem;
+#endif
+}
+
+// Makes [mem, mem + size) readable and writable. Both must be page aligned.
+inline bool Commit(void* mem, size_t size){
+#if defined(_WIN32)
+    return VirtualAlloc(mem, size, MEM_COMMIT, PAGE_READWRITE) != nullptr;
+#else
+    return mprotect(mem, size, PROT_READ | PROT_WRITE) == 0;
+#endif
+}
+
+// Gives the physical memory back but keeps the addresses reserved
+inline void Decommit(void* mem, size_t size){
+#if defined(_WIN32)
+    VirtualFree(mem, size, MEM_DECOMMIT);
+#else
+    madvise(mem, size, MADV_DONTNEED);
+    mprotect(mem, size, PROT_NONE);
+#endif
+}
+
+// Gives back the whole range, mem and size must be what Reserve() was called with
+inline void Release(void* mem, size_t size){
+#if defined(_WIN32)
+    (void)size;
+    VirtualFree(mem, 0, MEM_RELEASE);
+#else
+    munmap(mem, size);
+#endif
+}
+
+// Maps the whole file at path read-only, returns its start or nullptr and the size in size.
+// The mapping stays valid after the file is closed, hand it back with UnmapFile().
+inline void* MapFile(const char* path, size_t* size){
+    *size = 0;
+#if defined(_WIN32)
+    HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if(file == INVALID_HANDLE_VALUE){
+        return nullptr;
+    }
+    LARGE_INTEGER file_size;
+    void* mem = nullptr;
+    if(GetFileSizeEx(file, &file_size) && file_size.QuadPart > 0){
+        HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if(mapping != nullptr){
+            mem = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+            CloseHandle(mapping); //the view keeps the mapping alive
+        }
+    }
+    CloseHandle(file);
+    if(mem != nullptr) *size = (size_t)file_size.QuadPart;
+    return mem;
+#else
+    int file = open(path, O_RDONLY);
+    if(file < 0){
+        return nullptr;
+    }
+    struct stat info;
+    void* mem = nullptr;
+    if(fstat(file, &info) == 0 && info.st_size > 0){
+        mem = mmap(nullptr, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, file, 0);
+        if(mem == MAP_FAILED) mem = nullptr;
+    }
+    close(file); //the mapping keeps the file alive
+    if(mem != nullptr) *size = (size_t)info.st_size;
+    return mem;
+#endif
+}
+
+inline void UnmapFile(void* mem, size_t size){
+#if defined(_WIN32)
+    (void)size;
+    UnmapViewOfFile(mem);
+#else
+    munmap(mem, size);
+#endif
+}
+
+} // namespace virtual_memory